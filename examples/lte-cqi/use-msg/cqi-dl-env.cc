@@ -21,6 +21,8 @@
 
 #include "cqi-dl-env.h"
 
+#include <algorithm>
+
 /**
  * \brief Link the shared memory with the id and set the operation lock
  *
@@ -52,35 +54,117 @@ CQIDL::GetTypeId()
     return tid;
 }
 
+std::vector<uint16_t>
+CQIDL::GetRntis(const std::map<uint16_t, uint8_t>& wbCqi,
+                const std::map<uint16_t, SbMeasResult_s>& sbCqi)
+{
+    std::vector<uint16_t> rntis;
+    for (const auto& it : wbCqi)
+    {
+        rntis.push_back(it.first);
+    }
+    for (const auto& it : sbCqi)
+    {
+        if (wbCqi.find(it.first) == wbCqi.end())
+        {
+            rntis.push_back(it.first);
+        }
+    }
+    std::sort(rntis.begin(), rntis.end());
+    return rntis;
+}
+
 /**
- * \brief Set the value of wbcqi.
+ * \brief Send the wbcqi and the sbcqi of several UEs at once.
  *
- * \param[in] cqi  the value of wbcqi to be set
+ * \param[in] wbCqi  the value of wbcqi to be set, indexed by RNTI
+ * \param[in] sbCqi  the value of sbcqi to be set, indexed by RNTI
  */
 void
-CQIDL::SetWbCQI(uint8_t cqi)
+CQIDL::SetCQI(const std::map<uint16_t, uint8_t>& wbCqi,
+              const std::map<uint16_t, SbMeasResult_s>& sbCqi)
 {
+    std::vector<uint16_t> rntis = GetRntis(wbCqi, sbCqi);
+    NS_ABORT_MSG_IF(rntis.size() > MAX_UE_NUM,
+                    "Too many CQI reports (" << rntis.size() << "), maximum " << MAX_UE_NUM);
     Ns3AiMsgInterfaceImpl<CqiFeature, CqiPredicted>* msgInterface =
         Ns3AiMsgInterface::Get()->GetInterface<CqiFeature, CqiPredicted>();
     msgInterface->CppSendBegin();
-    msgInterface->GetCpp2PyStruct()->wbCqi = cqi;
+    CqiFeature* feature = msgInterface->GetCpp2PyStruct();
+    feature->nReports = rntis.size();
+    for (uint16_t i = 0; i < rntis.size(); i++)
+    {
+        CqiReport& report = feature->reports[i];
+        report.rnti = rntis[i];
+        auto wb = wbCqi.find(rntis[i]);
+        report.hasWbCqi = wb != wbCqi.end();
+        report.wbCqi = report.hasWbCqi ? wb->second : 0;
+        report.rbgNum = 0;
+        report.nLayers = 0;
+        auto sb = sbCqi.find(rntis[i]);
+        if (sb == sbCqi.end())
+        {
+            continue;
+        }
+        const std::vector<HigherLayerSelected_s>& rbgs = sb->second.m_higherLayerSelected;
+        NS_ABORT_MSG_IF(rbgs.size() > MAX_RBG_NUM,
+                        "Too many RBGs (" << rbgs.size() << "), maximum " << MAX_RBG_NUM);
+        report.rbgNum = rbgs.size();
+        for (uint8_t rbg = 0; rbg < rbgs.size(); rbg++)
+        {
+            NS_ABORT_MSG_IF(rbgs[rbg].m_sbCqi.size() > MAX_LAYER_NUM,
+                            "Too many layers (" << rbgs[rbg].m_sbCqi.size() << "), maximum "
+                                                << MAX_LAYER_NUM);
+            for (uint8_t layer = 0; layer < MAX_LAYER_NUM; layer++)
+            {
+                feature->sbCqi[i][rbg][layer] =
+                    layer < rbgs[rbg].m_sbCqi.size() ? rbgs[rbg].m_sbCqi[layer] : 0;
+            }
+            report.nLayers = std::max<uint8_t>(report.nLayers, rbgs[rbg].m_sbCqi.size());
+        }
+    }
     msgInterface->CppSendEnd();
 }
 
 /**
- * \brief Get the predictive value of wbcqi.
+ * \brief Get the predictive values of wbcqi and sbcqi of the UEs sent by SetCQI.
  *
- * \returns the predictive value of wbcqi
+ * \param[in,out] wbCqi  the wbcqi sent by SetCQI, whose values are replaced by the
+ *                       predictions
+ * \param[in,out] sbCqi  the sbcqi sent by SetCQI, whose values are replaced by the
+ *                       predictions
  */
-uint8_t
-CQIDL::GetWbCQI()
+void
+CQIDL::GetCQI(std::map<uint16_t, uint8_t>& wbCqi, std::map<uint16_t, SbMeasResult_s>& sbCqi)
 {
+    std::vector<uint16_t> rntis = GetRntis(wbCqi, sbCqi);
     Ns3AiMsgInterfaceImpl<CqiFeature, CqiPredicted>* msgInterface =
         Ns3AiMsgInterface::Get()->GetInterface<CqiFeature, CqiPredicted>();
     msgInterface->CppRecvBegin();
-    uint8_t ret = msgInterface->GetPy2CppStruct()->new_wbCqi;
+    const CqiPredicted* predicted = msgInterface->GetPy2CppStruct();
+    // the predictions are in the order of the reports
+    for (uint16_t i = 0; i < rntis.size(); i++)
+    {
+        auto wb = wbCqi.find(rntis[i]);
+        if (wb != wbCqi.end())
+        {
+            wb->second = predicted->new_wbCqi[i];
+        }
+        auto sb = sbCqi.find(rntis[i]);
+        if (sb == sbCqi.end())
+        {
+            continue;
+        }
+        std::vector<HigherLayerSelected_s>& rbgs = sb->second.m_higherLayerSelected;
+        for (uint8_t rbg = 0; rbg < rbgs.size(); rbg++)
+        {
+            for (uint8_t layer = 0; layer < rbgs[rbg].m_sbCqi.size(); layer++)
+            {
+                rbgs[rbg].m_sbCqi[layer] = predicted->new_sbCqi[i][rbg][layer];
+            }
+        }
+    }
     msgInterface->CppRecvEnd();
-    return ret;
 }
 
 } // namespace ns3
@@ -24,35 +24,55 @@
 #include "ns3/core-module.h"
 #include "ns3/ff-mac-common.h"
 
+#include <map>
+#include <vector>
+
 namespace ns3
 {
 #define MAX_RBG_NUM 32
+#define MAX_LAYER_NUM 2
+#define MAX_UE_NUM 64
+
+/**
+ * \brief The CQI reported by a UE: wideband (P10), subband (A30) or both.
+ */
+struct CqiReport
+{
+    uint16_t rnti;     ///< RNTI of the UE
+    uint8_t hasWbCqi;  ///< whether wbCqi is valid
+    uint8_t wbCqi;     ///< wide band cqi
+    uint8_t rbgNum;    ///< resource block group number, 0 without subband cqi
+    uint8_t nLayers;   ///< number of layers, 0 without subband cqi
+};
 
 /**
  * \brief The feature of cqi.
  *
  * The feature of DL training (in this example, feature of cqi)
  * shared between ns-3 and python with the same shared memory
- * using the ns3-ai model.
+ * using the ns3-ai model. All the P10 and A30 reports received by
+ * the scheduler in one call are sent together, one row per UE: the
+ * subband cqi of reports[i] is sbCqi[i], of fixed stride.
  */
 struct CqiFeature
 {
-    uint8_t wbCqi; ///< wide band cqi
-    //  uint8_t rbgNum;                 ///< resource block group number
-    //  uint8_t nLayers;                ///< number of layers
-    //  uint8_t sbCqi[MAX_RBG_NUM][2];  ///< sub band cqi
+    uint16_t nReports;                                     ///< number of valid reports
+    CqiReport reports[MAX_UE_NUM];                         ///< reports of the UEs
+    uint8_t sbCqi[MAX_UE_NUM][MAX_RBG_NUM][MAX_LAYER_NUM]; ///< sub band cqi [UE][RBG][layer]
 };
 
 /**
  * \brief The prediction of cqi.
  *
  * The prediction of DL training (in this example, prediction of cqi)
- * calculated by python and put back to ns-3 with the shared memory.
+ * calculated by python and put back to ns-3 with the shared memory,
+ * in the order of the reports. Only the entries that were reported
+ * are read back.
  */
 struct CqiPredicted
 {
-    uint8_t new_wbCqi;
-    //  uint8_t new_sbCqi[MAX_RBG_NUM][2];
+    uint8_t new_wbCqi[MAX_UE_NUM];                             ///< wide band cqi
+    uint8_t new_sbCqi[MAX_UE_NUM][MAX_RBG_NUM][MAX_LAYER_NUM]; ///< sub band cqi
 };
 
 /**
@@ -62,6 +82,7 @@ struct CqiPredicted
  * It set data through member function 'Set[xxx]()',
  * and put them into the shared memory, using python to calculate,
  * and got prediction through member function 'Get[xxx]()'.
+ * The CQI of all UEs is exchanged in one round trip.
  */
 class CQIDL : public Object
 {
@@ -70,8 +91,17 @@ class CQIDL : public Object
     ~CQIDL() override;
     static TypeId GetTypeId();
 
-    void SetWbCQI(uint8_t cqi);
-    uint8_t GetWbCQI();
+    void SetCQI(const std::map<uint16_t, uint8_t>& wbCqi,
+                const std::map<uint16_t, SbMeasResult_s>& sbCqi);
+    void GetCQI(std::map<uint16_t, uint8_t>& wbCqi, std::map<uint16_t, SbMeasResult_s>& sbCqi);
+
+  private:
+    /**
+     * \brief Get the RNTIs of the UEs with a wideband or a subband cqi, in the order of
+     * the reports.
+     */
+    static std::vector<uint16_t> GetRntis(const std::map<uint16_t, uint8_t>& wbCqi,
+                                          const std::map<uint16_t, SbMeasResult_s>& sbCqi);
 };
 
 } // namespace ns3
@@ -21,19 +21,115 @@
 
 #include <ns3/ai-module.h>
 
+#include <pybind11/numpy.h>
 #include <pybind11/pybind11.h>
+#include <pybind11/stl.h>
 
 namespace py = pybind11;
 
+/**
+ * \brief Get a [MAX_UE_NUM, MAX_RBG_NUM, MAX_LAYER_NUM] NumPy view of a subband CQI
+ * matrix in the shared memory, kept alive by the owner of the matrix, not a copy.
+ */
+static py::array_t<uint8_t>
+GetSbCqiView(uint8_t (&sbCqi)[MAX_UE_NUM][MAX_RBG_NUM][MAX_LAYER_NUM], py::object owner)
+{
+    return py::array_t<uint8_t>({MAX_UE_NUM, MAX_RBG_NUM, MAX_LAYER_NUM},
+                                {MAX_RBG_NUM * MAX_LAYER_NUM, MAX_LAYER_NUM, 1},
+                                &sbCqi[0][0][0],
+                                owner);
+}
+
+/**
+ * \brief Get a field of the valid reports as a list.
+ */
+template <typename T>
+static std::vector<T>
+GetReportField(const ns3::CqiFeature& feature, T ns3::CqiReport::*field)
+{
+    std::vector<T> values;
+    for (uint16_t i = 0; i < feature.nReports; i++)
+    {
+        values.push_back(feature.reports[i].*field);
+    }
+    return values;
+}
+
 PYBIND11_MODULE(ns3ai_ltecqi_py, m)
 {
+    m.attr("MAX_UE_NUM") = MAX_UE_NUM;
+    m.attr("MAX_RBG_NUM") = MAX_RBG_NUM;
+    m.attr("MAX_LAYER_NUM") = MAX_LAYER_NUM;
+    m.attr("ENV_SIZE") = sizeof(ns3::CqiFeature);
+    m.attr("ACT_SIZE") = sizeof(ns3::CqiPredicted);
+
     py::class_<ns3::CqiFeature>(m, "PyEnvStruct")
         .def(py::init<>())
-        .def_readwrite("wbCqi", &ns3::CqiFeature::wbCqi);
+        .def_readwrite("nReports", &ns3::CqiFeature::nReports)
+        .def(
+            "get_rntis",
+            [](const ns3::CqiFeature& feature) {
+                return GetReportField(feature, &ns3::CqiReport::rnti);
+            },
+            "RNTIs of the UEs that reported, in the order of the predictions")
+        .def(
+            "get_has_wb_cqis",
+            [](const ns3::CqiFeature& feature) {
+                std::vector<bool> hasWbCqis;
+                for (uint8_t hasWbCqi : GetReportField(feature, &ns3::CqiReport::hasWbCqi))
+                {
+                    hasWbCqis.push_back(hasWbCqi);
+                }
+                return hasWbCqis;
+            },
+            "Whether the UEs reported a wideband CQI")
+        .def(
+            "get_wb_cqis",
+            [](const ns3::CqiFeature& feature) {
+                return GetReportField(feature, &ns3::CqiReport::wbCqi);
+            },
+            "Wideband CQIs reported by the UEs (0 without wideband CQI)")
+        .def(
+            "get_rbg_nums",
+            [](const ns3::CqiFeature& feature) {
+                return GetReportField(feature, &ns3::CqiReport::rbgNum);
+            },
+            "Numbers of RBGs of the subband CQIs (0 without subband CQI)")
+        .def(
+            "get_num_layers",
+            [](const ns3::CqiFeature& feature) {
+                return GetReportField(feature, &ns3::CqiReport::nLayers);
+            },
+            "Numbers of layers of the subband CQIs (0 without subband CQI)")
+        .def(
+            "get_sb_cqi_view",
+            [](py::object self) {
+                return GetSbCqiView(self.cast<ns3::CqiFeature&>().sbCqi, self);
+            },
+            "Subband CQIs, as a NumPy view of shape [MAX_UE_NUM, MAX_RBG_NUM, MAX_LAYER_NUM] "
+            "whose rows follow the reports");
 
     py::class_<ns3::CqiPredicted>(m, "PyActStruct")
         .def(py::init<>())
-        .def_readwrite("new_wbCqi", &ns3::CqiPredicted::new_wbCqi);
+        .def(
+            "set_wb_cqis",
+            [](ns3::CqiPredicted& predicted, const std::vector<uint8_t>& wbCqis) {
+                if (wbCqis.size() > MAX_UE_NUM)
+                {
+                    std::cerr << "Too many predicted CQIs (" << wbCqis.size() << "), maximum "
+                              << MAX_UE_NUM << std::endl;
+                    exit(1);
+                }
+                std::copy(wbCqis.begin(), wbCqis.end(), predicted.new_wbCqi);
+            },
+            "Set the predicted wideband CQIs, in the order of the reports")
+        .def(
+            "get_sb_cqi_view",
+            [](py::object self) {
+                return GetSbCqiView(self.cast<ns3::CqiPredicted&>().new_sbCqi, self);
+            },
+            "Predicted subband CQIs, as a writable NumPy view of shape [MAX_UE_NUM, "
+            "MAX_RBG_NUM, MAX_LAYER_NUM] whose rows follow the reports");
 
     py::class_<ns3::Ns3AiMsgInterfaceImpl<ns3::CqiFeature, ns3::CqiPredicted>>(
         m,
@@ -1168,44 +1168,23 @@ MyRrMacScheduler::DoSchedDlCqiInfoReq(
 {
     NS_LOG_FUNCTION(this);
 
-    std::map<uint16_t, uint8_t>::iterator it;
+    // Collect the wideband and subband CQI of all UEs, to get their predictions in one
+    // round trip
+    std::map<uint16_t, uint8_t> wbCqi;
+    std::map<uint16_t, SbMeasResult_s> sbCqi;
     for (unsigned int i = 0; i < params.m_cqiList.size(); i++)
     {
         if (params.m_cqiList.at(i).m_cqiType == CqiListElement_s::P10)
         {
             uint8_t cqi_val = params.m_cqiList.at(i).m_wbCqi.at(0);
             NS_LOG_LOGIC("wideband CQI " << (uint32_t)cqi_val << " reported");
-            std::map<uint16_t, uint8_t>::iterator it;
-            uint16_t rnti = params.m_cqiList.at(i).m_rnti;
-            if (rnti == 1)
-            {
-                m_cqiDl->SetWbCQI(cqi_val);
-                cqi_val = m_cqiDl->GetWbCQI();
-            }
-            it = m_p10CqiRxed.find(rnti);
-            if (it == m_p10CqiRxed.end())
-            {
-                // create the new entry
-                m_p10CqiRxed.insert(
-                    std::pair<uint16_t, uint8_t>(rnti,
-                                                 cqi_val)); // only codeword 0 at this stage (SISO)
-                // generate correspondent timer
-                m_p10CqiTimers.insert(std::pair<uint16_t, uint32_t>(rnti, m_cqiTimersThreshold));
-            }
-            else
-            {
-                // update the CQI value
-                (*it).second = cqi_val;
-                // update correspondent timer
-                std::map<uint16_t, uint32_t>::iterator itTimers;
-                itTimers = m_p10CqiTimers.find(rnti);
-                (*itTimers).second = m_cqiTimersThreshold;
-            }
+            wbCqi[params.m_cqiList.at(i).m_rnti] = cqi_val;
         }
         else if (params.m_cqiList.at(i).m_cqiType == CqiListElement_s::A30)
         {
             // subband CQI reporting high layer configured
-            // Not used by RR Scheduler
+            // Not used by RR Scheduler, only kept for the prediction
+            sbCqi[params.m_cqiList.at(i).m_rnti] = params.m_cqiList.at(i).m_sbMeasResult;
         }
         else
         {
@@ -1213,6 +1192,46 @@ MyRrMacScheduler::DoSchedDlCqiInfoReq(
         }
     }
 
+    if (wbCqi.empty() && sbCqi.empty())
+    {
+        return;
+    }
+    m_cqiDl->SetCQI(wbCqi, sbCqi);
+    m_cqiDl->GetCQI(wbCqi, sbCqi);
+
+    std::map<uint16_t, uint8_t>::iterator it;
+    for (const auto& report : wbCqi)
+    {
+        uint16_t rnti = report.first;
+        uint8_t cqi_val = report.second;
+        it = m_p10CqiRxed.find(rnti);
+        if (it == m_p10CqiRxed.end())
+        {
+            // create the new entry
+            m_p10CqiRxed.insert(
+                std::pair<uint16_t, uint8_t>(rnti,
+                                             cqi_val)); // only codeword 0 at this stage (SISO)
+            // generate correspondent timer
+            m_p10CqiTimers.insert(std::pair<uint16_t, uint32_t>(rnti, m_cqiTimersThreshold));
+        }
+        else
+        {
+            // update the CQI value
+            (*it).second = cqi_val;
+            // update correspondent timer
+            std::map<uint16_t, uint32_t>::iterator itTimers;
+            itTimers = m_p10CqiTimers.find(rnti);
+            (*itTimers).second = m_cqiTimersThreshold;
+        }
+    }
+
+    for (const auto& report : sbCqi)
+    {
+        // store or update the subband CQI and its timer
+        m_a30CqiRxed[report.first] = report.second;
+        m_a30CqiTimers[report.first] = m_cqiTimersThreshold;
+    }
+
     return;
 }
 
@@ -1810,6 +1829,23 @@ MyRrMacScheduler::RefreshDlCqiMaps(void)
         }
     }
 
+    // refresh DL CQI A30 Map
+    std::map<uint16_t, uint32_t>::iterator itA30 = m_a30CqiTimers.begin();
+    while (itA30 != m_a30CqiTimers.end())
+    {
+        if ((*itA30).second == 0)
+        {
+            NS_LOG_INFO(this << " A30-CQI exired for user " << (*itA30).first);
+            m_a30CqiRxed.erase((*itA30).first);
+            itA30 = m_a30CqiTimers.erase(itA30);
+        }
+        else
+        {
+            (*itA30).second--;
+            itA30++;
+        }
+    }
+
     return;
 }
 
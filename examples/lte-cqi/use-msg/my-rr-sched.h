@@ -275,6 +275,16 @@ class MyRrMacScheduler : public FfMacScheduler
      */
     std::map<uint16_t, uint32_t> m_p10CqiTimers;
 
+    /**
+     * Map of UE's DL CQI A30 received, as predicted
+     * (not used by the RR scheduler itself)
+     */
+    std::map<uint16_t, SbMeasResult_s> m_a30CqiRxed;
+    /**
+     * Map of UE's timers on DL CQI A30 received
+     */
+    std::map<uint16_t, uint32_t> m_a30CqiTimers;
+
     /**
      * Map of previous allocated UE per RBG
      * (used to retrieve info from UL-CQI)
@@ -81,19 +81,85 @@ def weighted_MSE(y_pred, y_true):
             len(y_pred)).mean()
 
 
-cqi_queue = []
-prediction = []
-last = []
-right = []
-corrected_predict = []
-target = []
-train_data = []
-is_train = True
-CQI = 0
-delay_queue = []
-
-exp = Experiment("ns3ai_ltecqi_msg", "../../../../../", py_binding, handleFinish=True)
+class UeCqi:
+    """CQI history and prediction statistics of one UE."""
+
+    def __init__(self):
+        self.cqi_queue = []
+        self.prediction = []
+        self.last = []
+        self.right = []
+        self.corrected_predict = []
+        self.target = []
+        self.train_data = []
+        self.delay_queue = []
+
+    def push(self, CQI):
+        # returns the delayed CQI, and the input of the prediction if there is enough history
+        self.delay_queue.append(CQI)
+        if len(self.delay_queue) < delta:
+            CQI = self.delay_queue[-1]
+        else:
+            CQI = self.delay_queue[-delta]
+        if not_train:
+            return CQI, None
+        self.cqi_queue.append(CQI)
+        if len(self.cqi_queue) >= input_len + delta:
+            self.target.append(CQI)
+        if len(self.cqi_queue) < input_len:
+            return CQI, None
+        one_data = self.cqi_queue[-input_len:]
+        self.train_data.append(one_data)
+        return CQI, one_data
+
+    def update(self, rnti, CQI, one_data, _predict_cqi):
+        # checks the prediction against the last reported value, and trains if it is worse
+        self.prediction.append(int(_predict_cqi + 0.49995))
+        self.last.append(one_data[-1])
+        self.corrected_predict.append(int(_predict_cqi + 0.49995))
+        if len(self.train_data) >= pred_len + delta:
+            err_t = weighted_MSE(
+                np.array(self.last[(-pred_len - delta):-delta]),
+                np.array(self.target[-pred_len:]))
+            err_p = weighted_MSE(
+                np.array(self.prediction[(-pred_len - delta):-delta]),
+                np.array(self.target[-pred_len:]))
+            if err_p <= err_t * alpha:
+                if err_t < 1e-6:
+                    self.corrected_predict[-1] = self.last[-1]
+                print(" ")
+                print("OK %d %d %f %f" % (rnti, len(self.cqi_queue), err_t, err_p))
+                self.right.append(1)
+            else:
+                self.corrected_predict[-1] = self.last[-1]
+                if err_t <= 1e-6:
+                    print("set %d: %d" % (rnti, CQI))
+                    return
+                print("train %d %d" % (rnti, len(self.cqi_queue)))
+                self.right.append(0)
+
+                lstm_model_mse.fit(x=np.array(
+                    self.train_data[-delta - batch_size:-delta]).reshape(
+                    batch_size, input_len, 1) / 10,
+                                   y=np.array(self.target[-batch_size:]),
+                                   batch_size=batch_size,
+                                   epochs=1,
+                                   verbose=0)
+        else:
+            self.corrected_predict[-1] = self.last[-1]
+        print("set %d: %d" % (rnti, self.corrected_predict[-1]))
+
+
+# the UEs, by RNTI
+ues = {}
+
+# the subband CQI matrices do not fit in the default shared memory
+exp = Experiment("ns3ai_ltecqi_msg", "../../../../../", py_binding, handleFinish=True,
+                 shmSize=py_binding.ENV_SIZE + py_binding.ACT_SIZE + 4096)
 msgInterface = exp.run(show_output=True)
+# [UE, RBG, layer] views of the subband CQI in the shared memory, rows following the reports
+sb_cqi = msgInterface.GetCpp2PyStruct().get_sb_cqi_view()
+new_sb_cqi = msgInterface.GetPy2CppStruct().get_sb_cqi_view()
 
 try:
     while True:
@@ -101,85 +167,46 @@ try:
         if msgInterface.PyGetFinished():
             break
         gc.collect()
-        # Get CQI
-        CQI = msgInterface.GetCpp2PyStruct().wbCqi
+        # Get the CQI of all the UEs that reported in this TTI
+        rntis = msgInterface.GetCpp2PyStruct().get_rntis()
+        has_cqis = msgInterface.GetCpp2PyStruct().get_has_wb_cqis()
+        cqis = msgInterface.GetCpp2PyStruct().get_wb_cqis()
         msgInterface.PyRecvEnd()
 
-        if CQI > 15:
+        if max(cqis) > 15:
             break
-        old_print("get: %d" % CQI)
-        # CQI = next(get_CQI)
-        delay_queue.append(CQI)
-        if len(delay_queue) < delta:
-            CQI = delay_queue[-1]
-        else:
-            CQI = delay_queue[-delta]
-        if not_train:
-            msgInterface.PySendBegin()
-            msgInterface.GetPy2CppStruct().new_wbCqi = CQI
-            msgInterface.PySendEnd()
-            continue
-        cqi_queue.append(CQI)
-        if len(cqi_queue) >= input_len + delta:
-            target.append(CQI)
-        if len(cqi_queue) >= input_len:
-            one_data = cqi_queue[-input_len:]
-            train_data.append(one_data)
-        else:
-            msgInterface.PySendBegin()
-            msgInterface.GetPy2CppStruct().new_wbCqi = CQI
-            msgInterface.PySendEnd()
-            old_print("set: %d" % CQI)
-            continue
-
-        data_to_pred = np.array(one_data).reshape(-1, input_len, 1) / 10
-        _predict_cqi = lstm_model_mse.predict(data_to_pred)
-        old_print(_predict_cqi)
-        del data_to_pred
-        prediction.append(int(_predict_cqi[0, 0] + 0.49995))
-        last.append(one_data[-1])
-        corrected_predict.append(int(_predict_cqi[0, 0] + 0.49995))
-        del one_data
-        if len(train_data) >= pred_len + delta:
-            err_t = weighted_MSE(
-                np.array(last[(-pred_len - delta):-delta]),
-                np.array(target[-pred_len:]))
-            err_p = weighted_MSE(
-                np.array(prediction[(-pred_len - delta):-delta]),
-                np.array(target[-pred_len:]))
-            if err_p <= err_t * alpha:
-                if err_t < 1e-6:
-                    corrected_predict[-1] = last[-1]
-                print(" ")
-                print("OK %d %f %f" % ((len(cqi_queue)), err_t, err_p))
-                right.append(1)
-                pass
+        reply = []
+        ready = []
+        for rnti, has_cqi, CQI in zip(rntis, has_cqis, cqis):
+            if not has_cqi:
+                # subband report only
+                reply.append(0)
+                continue
+            old_print("get %d: %d" % (rnti, CQI))
+            ue = ues.setdefault(rnti, UeCqi())
+            CQI, one_data = ue.push(CQI)
+            reply.append(CQI)
+            if one_data is None:
+                old_print("set %d: %d" % (rnti, CQI))
             else:
-                corrected_predict[-1] = last[-1]
-                if err_t <= 1e-6:
-                    msgInterface.PySendBegin()
-                    msgInterface.GetPy2CppStruct().new_wbCqi = CQI
-                    msgInterface.PySendEnd()
-                    print("set: %d" % CQI)
-                    continue
-                else:
-                    print("train %d" % (len(cqi_queue)))
-                    right.append(0)
-
-                    lstm_model_mse.fit(x=np.array(
-                        train_data[-delta - batch_size:-delta]).reshape(
-                        batch_size, input_len, 1) / 10,
-                                       y=np.array(target[-batch_size:]),
-                                       batch_size=batch_size,
-                                       epochs=1,
-                                       verbose=0)
-        else:
-            corrected_predict[-1] = last[-1]
-        # sm.Set(corrected_predict[-1])
+                ready.append((rnti, ue, CQI, one_data))
+
+        # one prediction for all the UEs with enough history
+        if ready:
+            data_to_pred = np.array([one_data for _, _, _, one_data in ready]).reshape(
+                -1, input_len, 1) / 10
+            _predict_cqi = lstm_model_mse.predict(data_to_pred, verbose=0)
+            old_print(_predict_cqi)
+            del data_to_pred
+            for (rnti, ue, CQI, one_data), predicted in zip(ready, _predict_cqi[:, 0]):
+                ue.update(rnti, CQI, one_data, predicted)
+
         msgInterface.PySendBegin()
-        msgInterface.GetPy2CppStruct().new_wbCqi = CQI
+        msgInterface.GetPy2CppStruct().set_wb_cqis(reply)
+        # the subband CQI is not predicted yet, its prediction is the last report, copied
+        # in place (the reports are not overwritten by ns-3 before it gets the reply)
+        new_sb_cqi[:len(rntis)] = sb_cqi[:len(rntis)]
         msgInterface.PySendEnd()
-        print("set: %d" % corrected_predict[-1])
 
 except Exception as e:
     exc_type, exc_value, exc_traceback = sys.exc_info()
@@ -190,13 +217,15 @@ except Exception as e:
 
 else:
     with open("log_" + str(delta), "a+") as f:
-        f.write("\n")
-        if len(right):
-            f.write("rate = %f %%\n" % (sum(right) / len(right)))
-        f.write("MSE_T = %f %%\n" %
-                (simple_MSE(np.array(target[delta:]), np.array(target[:-delta]))))
-        f.write("MSE_p = %f %%\n" % (simple_MSE(
-            np.array(corrected_predict[delta:]), np.array(target[:delta]))))
+        for rnti, ue in sorted(ues.items()):
+            f.write("\nUE %d\n" % rnti)
+            if len(ue.right):
+                f.write("rate = %f %%\n" % (sum(ue.right) / len(ue.right)))
+            if len(ue.target) > delta:
+                f.write("MSE_T = %f %%\n" %
+                        (simple_MSE(np.array(ue.target[delta:]), np.array(ue.target[:-delta]))))
+                f.write("MSE_p = %f %%\n" % (simple_MSE(
+                    np.array(ue.corrected_predict[delta:]), np.array(ue.target[:delta]))))
 
 finally:
     print("Finally exiting...")
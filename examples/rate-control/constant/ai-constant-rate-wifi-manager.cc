@@ -22,7 +22,11 @@
 
 #include "ai-constant-rate-wifi-manager.h"
 
+#include "../rate-control-benchmark.h"
+
+#include <ns3/boolean.h>
 #include <ns3/log.h>
+#include <ns3/simulator.h>
 #include <ns3/string.h>
 #include <ns3/wifi-phy.h>
 #include <ns3/wifi-tx-vector.h>
@@ -36,6 +40,16 @@ NS_LOG_COMPONENT_DEFINE("AiConstantRateWifiManager");
 
 NS_OBJECT_ENSURE_REGISTERED(AiConstantRateWifiManager);
 
+/**
+ * Holds the last decision of Python for a station.
+ */
+struct AiConstantRateWifiRemoteStation : public WifiRemoteStation
+{
+    uint8_t m_nss{0};     //!< Number of spatial streams decided by Python
+    uint8_t m_nextMcs{0}; //!< MCS decided by Python
+    Time m_validUntil{0}; //!< The decision is reused until this time (PolicyTable mode)
+};
+
 TypeId
 AiConstantRateWifiManager::GetTypeId()
 {
@@ -53,7 +67,13 @@ AiConstantRateWifiManager::GetTypeId()
                           "The transmission mode to use for every RTS packet transmission.",
                           StringValue("OfdmRate6Mbps"),
                           MakeWifiModeAccessor(&AiConstantRateWifiManager::m_ctlMode),
-                          MakeWifiModeChecker());
+                          MakeWifiModeChecker())
+            .AddAttribute("PolicyTable",
+                          "Reuse the decision of Python for a station during the validity it "
+                          "returned, instead of asking Python for every data frame",
+                          BooleanValue(false),
+                          MakeBooleanAccessor(&AiConstantRateWifiManager::m_policyTable),
+                          MakeBooleanChecker());
     return tid;
 }
 
@@ -75,7 +95,7 @@ WifiRemoteStation*
 AiConstantRateWifiManager::DoCreateStation() const
 {
     NS_LOG_FUNCTION(this);
-    WifiRemoteStation* station = new WifiRemoteStation();
+    AiConstantRateWifiRemoteStation* station = new AiConstantRateWifiRemoteStation();
     return station;
 }
 
@@ -129,13 +149,15 @@ AiConstantRateWifiManager::DoReportFinalDataFailed(WifiRemoteStation* station)
     NS_LOG_FUNCTION(this << station);
 }
 
-WifiTxVector
-AiConstantRateWifiManager::DoGetDataTxVector(WifiRemoteStation* st, uint16_t allowedWidth)
+void
+AiConstantRateWifiManager::AskDecision(WifiRemoteStation* st)
 {
     NS_LOG_FUNCTION(this << st);
+    auto station = static_cast<AiConstantRateWifiRemoteStation*>(st);
     Ns3AiMsgInterfaceImpl<AiConstantRateEnvStruct, AiConstantRateActStruct>* msgInterface =
         Ns3AiMsgInterface::Get()->GetInterface<AiConstantRateEnvStruct, AiConstantRateActStruct>();
 
+    auto begin = RateControlBenchmark::Clock::now();
     msgInterface->CppSendBegin();
     msgInterface->GetCpp2PyStruct()->transmitStreams = GetMaxNumberOfTransmitStreams();
     msgInterface->GetCpp2PyStruct()->supportedStreams = GetNumberOfSupportedStreams(st);
@@ -150,13 +172,28 @@ AiConstantRateWifiManager::DoGetDataTxVector(WifiRemoteStation* st, uint16_t all
     msgInterface->CppSendEnd();
 
     msgInterface->CppRecvBegin();
-    uint8_t nss = msgInterface->GetPy2CppStruct()->nss;
-    uint8_t next_mcs = msgInterface->GetPy2CppStruct()->next_mcs;
-    NS_LOG_FUNCTION(next_mcs);
+    station->m_nss = msgInterface->GetPy2CppStruct()->nss;
+    station->m_nextMcs = msgInterface->GetPy2CppStruct()->next_mcs;
+    station->m_validUntil = Simulator::Now() + Seconds(msgInterface->GetPy2CppStruct()->validity);
     msgInterface->CppRecvEnd();
+    RateControlBenchmark::Get().RecordIpcRound(begin);
+}
+
+WifiTxVector
+AiConstantRateWifiManager::DoGetDataTxVector(WifiRemoteStation* st, uint16_t allowedWidth)
+{
+    NS_LOG_FUNCTION(this << st);
+    auto station = static_cast<AiConstantRateWifiRemoteStation*>(st);
+    // Python is only asked again when its last decision expired
+    if (!m_policyTable || Simulator::Now() >= station->m_validUntil)
+    {
+        AskDecision(st);
+    }
+    uint8_t nss = station->m_nss;
+    NS_LOG_FUNCTION(+station->m_nextMcs);
 
     // uncomment to specify arbitrary MCS
-    // m_dataMode = GetMcsSupported (st, next_mcs);
+    // m_dataMode = GetMcsSupported (st, station->m_nextMcs);
 
     return WifiTxVector(
         m_dataMode,
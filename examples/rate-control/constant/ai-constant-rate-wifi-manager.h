@@ -47,10 +47,12 @@ struct AiConstantRateActStruct
 {
     uint8_t nss;
     uint8_t next_mcs;
+    double validity; //!< seconds during which the decision is reused (PolicyTable mode)
 
     AiConstantRateActStruct()
         : nss(0),
-          next_mcs(0)
+          next_mcs(0),
+          validity(0)
     {
     }
 };
@@ -93,8 +95,16 @@ class AiConstantRateWifiManager : public WifiRemoteStationManager
     WifiTxVector DoGetDataTxVector(WifiRemoteStation* station, uint16_t allowedWidth) override;
     WifiTxVector DoGetRtsTxVector(WifiRemoteStation* station) override;
 
+    /**
+     * Asks Python for the number of spatial streams and the MCS of a station.
+     *
+     * \param station Station for which the decision is asked.
+     */
+    void AskDecision(WifiRemoteStation* station);
+
     WifiMode m_dataMode; //!< Wifi mode for unicast Data frames
     WifiMode m_ctlMode;  //!< Wifi mode for RTS frames
+    bool m_policyTable;  //!< Reuse the decisions of Python until they expire
 };
 
 } // namespace ns3
@@ -18,6 +18,7 @@
 #         Muyuan Shen <muyuan_shen@hust.edu.cn>
 
 
+import argparse
 import ns3ai_ratecontrol_constant_py as py_binding
 from ns3ai_utils import Experiment
 import sys
@@ -35,11 +36,22 @@ def get_action(env):
     return nss, next_mcs
 
 
+parser = argparse.ArgumentParser()
+parser.add_argument('--policy_table', action='store_true',
+                    help='let ns-3 reuse each decision until it expires')
+parser.add_argument('--table_validity', type=float, default=0.05,
+                    help='lifetime of a decision (s)')
+parser.add_argument('--ns3_setting', action='append', default=[], metavar='KEY=VALUE',
+                    help='extra command line argument of the simulation, e.g. nWifi=50')
+args = parser.parse_args()
+
 ns3Settings = {
     'raa': 'AiConstantRate',
     'nWifi': 3,
     'standard': '11ac',
-    'duration': 5}
+    'duration': 5,
+    'policyTable': 'true' if args.policy_table else 'false'}
+ns3Settings.update(setting.split('=', 1) for setting in args.ns3_setting)
 
 exp = Experiment("ns3ai_ratecontrol_constant", "../../../../../", py_binding, handleFinish=True)
 msgInterface = exp.run(setting=ns3Settings, show_output=True)
@@ -52,6 +64,7 @@ try:
             break
         msgInterface.GetPy2CppStruct().nss, msgInterface.GetPy2CppStruct().next_mcs = (
             get_action(msgInterface.GetCpp2PyStruct()))
+        msgInterface.GetPy2CppStruct().validity = args.table_validity
         msgInterface.PyRecvEnd()
         msgInterface.PySendEnd()
 
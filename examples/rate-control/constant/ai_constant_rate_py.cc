@@ -36,7 +36,8 @@ PYBIND11_MODULE(ns3ai_ratecontrol_constant_py, m)
     py::class_<ns3::AiConstantRateActStruct>(m, "PyActStruct")
         .def(py::init<>())
         .def_readwrite("nss", &ns3::AiConstantRateActStruct::nss)
-        .def_readwrite("next_mcs", &ns3::AiConstantRateActStruct::next_mcs);
+        .def_readwrite("next_mcs", &ns3::AiConstantRateActStruct::next_mcs)
+        .def_readwrite("validity", &ns3::AiConstantRateActStruct::validity);
 
     py::class_<
         ns3::Ns3AiMsgInterfaceImpl<ns3::AiConstantRateEnvStruct, ns3::AiConstantRateActStruct>>(
@@ -0,0 +1,125 @@
+/*
+ * Copyright (c) 2023 Huazhong University of Science and Technology
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef NS3_RATE_CONTROL_BENCHMARK_H
+#define NS3_RATE_CONTROL_BENCHMARK_H
+
+#include <ns3/simulator.h>
+
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <string>
+
+/**
+ * \brief Performance counters of a rate control run, shared by the built-in and the
+ * AI Wi-Fi managers so that the cost of an out-of-process rate control can be
+ * quantified.
+ *
+ * The AI managers time every C++-Python round trip with RecordIpcRound(), and the
+ * main program counts the transmitted frames with RecordFrame(). Only the rounds and
+ * frames between Begin() and End(), which bracket Simulator::Run(), are counted.
+ * Report() prints one machine-readable line.
+ */
+class RateControlBenchmark
+{
+  public:
+    typedef std::chrono::steady_clock Clock;
+
+    static RateControlBenchmark& Get()
+    {
+        static RateControlBenchmark benchmark;
+        return benchmark;
+    }
+
+    void Begin()
+    {
+        m_running = true;
+        m_frames = 0;
+        m_ipcRounds = 0;
+        m_ipcSeconds = 0;
+        m_events = ns3::Simulator::GetEventCount();
+        m_begin = Clock::now();
+    }
+
+    void End()
+    {
+        m_wallSeconds = std::chrono::duration<double>(Clock::now() - m_begin).count();
+        m_events = ns3::Simulator::GetEventCount() - m_events;
+        m_running = false;
+    }
+
+    /**
+     * \brief Record one transmitted frame.
+     */
+    void RecordFrame()
+    {
+        m_frames += m_running;
+    }
+
+    /**
+     * \brief Record one C++-Python round trip.
+     * \param begin When the round trip started.
+     */
+    void RecordIpcRound(Clock::time_point begin)
+    {
+        if (m_running)
+        {
+            m_ipcSeconds += std::chrono::duration<double>(Clock::now() - begin).count();
+            m_ipcRounds++;
+        }
+    }
+
+    /**
+     * \brief Print the counters as one line of space separated key=value pairs.
+     */
+    void Report(const std::string& manager,
+                const std::string& standard,
+                const std::string& dataMode,
+                uint32_t stations,
+                double simSeconds,
+                double throughputMbps) const
+    {
+        std::cout << "BENCHMARK manager=" << manager << " standard=" << standard
+                  << " data_mode=" << dataMode << " stations=" << stations
+                  << " sim_s=" << simSeconds << " wall_s=" << m_wallSeconds
+                  << " wall_per_sim_s=" << (simSeconds > 0 ? m_wallSeconds / simSeconds : 0)
+                  << " events=" << m_events << " frames=" << m_frames
+                  << " frames_per_s=" << PerWallSecond(m_frames) << " ipc_rounds=" << m_ipcRounds
+                  << " ipc_rounds_per_s=" << PerWallSecond(m_ipcRounds)
+                  << " ipc_share=" << (m_wallSeconds > 0 ? m_ipcSeconds / m_wallSeconds : 0)
+                  << " throughput_mbps=" << throughputMbps << std::endl;
+    }
+
+  private:
+    RateControlBenchmark() = default;
+
+    double PerWallSecond(uint64_t count) const
+    {
+        return m_wallSeconds > 0 ? count / m_wallSeconds : 0;
+    }
+
+    Clock::time_point m_begin;
+    bool m_running{false};  //!< whether Simulator::Run() is in progress
+    double m_wallSeconds{0}; //!< wall-clock time of the run
+    uint64_t m_events{0};    //!< events executed by the run
+    uint64_t m_frames{0};    //!< frames transmitted by the PHYs
+    uint64_t m_ipcRounds{0}; //!< C++-Python round trips
+    double m_ipcSeconds{0};  //!< wall-clock time spent in round trips
+};
+
+#endif // NS3_RATE_CONTROL_BENCHMARK_H
@@ -0,0 +1,136 @@
+/*
+ * Copyright (c) 2023 Huazhong University of Science and Technology
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef NS3_RATE_CONTROL_PROBE_H
+#define NS3_RATE_CONTROL_PROBE_H
+
+#include <ns3/inet-socket-address.h>
+#include <ns3/packet-sink.h>
+#include <ns3/seq-ts-size-header.h>
+#include <ns3/simulator.h>
+
+#include <cstdint>
+#include <iostream>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * \brief Throughput and delay probe hooked on the application sinks only, a lightweight
+ * alternative to FlowMonitor, which probes every IP packet of every node.
+ *
+ * The sources and the sinks must enable their SeqTsSizeHeader: a flow is identified by
+ * the IPv4 address of its source and its counters are kept in a flat array, indexed in
+ * the order the flows are first seen. The delay is the application-level one, from
+ * the sending of a chunk to its complete reception. Every interval, the throughput and
+ * the delay of the interval over all flows are printed.
+ */
+class RateControlProbe
+{
+  public:
+    /**
+     * \brief Counters of a flow since the beginning of the simulation.
+     */
+    struct FlowCounters
+    {
+        uint64_t rxBytes{0};   //!< bytes received
+        uint32_t rxPackets{0}; //!< chunks received
+        double delaySum{0};    //!< sum of the delays of the chunks (ns)
+    };
+
+    /**
+     * \brief Count the chunks received by a sink.
+     */
+    void Install(ns3::Ptr<ns3::PacketSink> sink)
+    {
+        sink->TraceConnectWithoutContext("RxWithSeqTsSize",
+                                         ns3::MakeCallback(&RateControlProbe::Receive, this));
+    }
+
+    /**
+     * \brief Print the throughput and the delay every interval, from a given time.
+     */
+    void Start(ns3::Time start, ns3::Time interval)
+    {
+        m_interval = interval;
+        ns3::Simulator::Schedule(start, &RateControlProbe::Report, this);
+    }
+
+    /**
+     * \brief Average delay of all flows since the beginning (ms).
+     */
+    double AverageDelay() const
+    {
+        return m_rxPackets ? m_delaySum / m_rxPackets / 1000000 : 0;
+    }
+
+    const std::vector<FlowCounters>& GetFlows() const
+    {
+        return m_flows;
+    }
+
+  private:
+    void Receive(ns3::Ptr<const ns3::Packet> packet,
+                 const ns3::Address& from,
+                 const ns3::Address& localAddress,
+                 const ns3::SeqTsSizeHeader& header)
+    {
+        uint32_t source = ns3::InetSocketAddress::ConvertFrom(from).GetIpv4().Get();
+        auto it = m_flowIndex.find(source);
+        if (it == m_flowIndex.end())
+        {
+            it = m_flowIndex.emplace(source, m_flows.size()).first;
+            m_flows.emplace_back();
+        }
+        FlowCounters& flow = m_flows[it->second];
+        flow.rxBytes += header.GetSize();
+        flow.rxPackets++;
+        flow.delaySum += (ns3::Simulator::Now() - header.GetTs()).GetDouble();
+    }
+
+    void Report()
+    {
+        uint64_t rxBytes = 0;
+        uint32_t rxPackets = 0;
+        double delaySum = 0;
+        for (const FlowCounters& flow : m_flows)
+        {
+            rxBytes += flow.rxBytes;
+            rxPackets += flow.rxPackets;
+            delaySum += flow.delaySum;
+        }
+        uint64_t rxBytesDiff = rxBytes - m_rxBytes;
+        uint32_t rxPacketsDiff = rxPackets - m_rxPackets;
+        double delayDiff = delaySum - m_delaySum;
+        m_rxBytes = rxBytes;
+        m_rxPackets = rxPackets;
+        m_delaySum = delaySum;
+
+        double delay = rxPacketsDiff ? delayDiff / rxPacketsDiff / 1000000 : 0; // ms
+        double tpt = 8.0 * rxBytesDiff / m_interval.GetSeconds() / (1024 * 1024); // Mbps
+        std::cout << "Delay: " << delay << "ms, Throughput: " << tpt << "Mbps" << std::endl;
+        ns3::Simulator::Schedule(m_interval, &RateControlProbe::Report, this);
+    }
+
+    std::unordered_map<uint32_t, uint32_t> m_flowIndex; //!< source address to flow index
+    std::vector<FlowCounters> m_flows;                  //!< counters of the flows
+    ns3::Time m_interval;                               //!< output interval
+    uint64_t m_rxBytes{0};                              //!< bytes at the last output
+    uint32_t m_rxPackets{0};                            //!< chunks at the last output
+    double m_delaySum{0};                               //!< delay sum at the last output (ns)
+};
+
+#endif // NS3_RATE_CONTROL_PROBE_H
@@ -18,6 +18,9 @@
  *         Muyuan Shen <muyuan_shen@hust.edu.cn>
  */
 
+#include "rate-control-benchmark.h"
+#include "rate-control-probe.h"
+
 #include "ns3/applications-module.h"
 #include "ns3/core-module.h"
 #include "ns3/csma-module.h"
@@ -31,6 +34,7 @@
 #include "ns3/ssid.h"
 #include "ns3/yans-wifi-helper.h"
 
+#include <cmath>
 #include <fstream>
 #include <iostream>
 
@@ -60,6 +64,8 @@ struct DataForThpt
     }
 } data; // data is a structure variable which will store all these global variables.
 
+RateControlProbe sinkProbe; // Lightweight alternative to FlowMonitor, see rate-control-probe.h
+
 double duration = 5.0;     // Duration of simulation (s)
 double statInterval = 0.1; // Time interval of calling function Throughput
 
@@ -104,6 +110,13 @@ Throughput()
     Simulator::Schedule(Seconds(statInterval), &Throughput);
 }
 
+// Counts the frames transmitted by the PHYs in benchmark mode
+static void
+CountPhyTx(Ptr<const Packet> packet, double txPowerW)
+{
+    RateControlBenchmark::Get().RecordFrame();
+}
+
 int
 setWifiStandard(WifiHelper& wifi, const std::string standard)
 {
@@ -146,6 +159,11 @@ main(int argc, char* argv[])
     std::string errorModelType = "ns3::NistErrorRateModel"; // Error Model
     std::string raaAlgo = "MinstrelHt";                     // RAA algorithm (WifiManager Class)
     std::string standard = "11ac";
+    bool policyTable = false;
+    bool prefetch = false;
+    bool benchmark = false;
+    std::string probe = "flowmon";
+    std::string dataMode = "";
 
     // Variables to set rates of various channels in topology, Refer base topology structure.
     uint32_t csmaRate = 150;
@@ -167,20 +185,41 @@ main(int argc, char* argv[])
     cmd.AddValue("csmaDelay", "NanoSeconds", csmaDelay);
     cmd.AddValue("csmaRate", "Mbps", csmaRate);
     cmd.AddValue("standard", "WiFi standard", standard);
+    cmd.AddValue("policyTable",
+                 "AI managers: sample the rate decisions locally from tables pushed by Python",
+                 policyTable);
+    cmd.AddValue("prefetch",
+                 "AiThompsonSampling: request the next MCS ahead of time, without waiting",
+                 prefetch);
+    cmd.AddValue("dataMode",
+                 "Constant managers: data mode, e.g., VhtMcs7 (default: the manager's default)",
+                 dataMode);
+    cmd.AddValue("benchmark",
+                 "Skip the periodic throughput output and print a line of performance counters",
+                 benchmark);
+    cmd.AddValue("probe",
+                 "Throughput and delay probe: flowmon (FlowMonitor) or sink (application sinks)",
+                 probe);
     cmd.Parse(argc, argv);
+    NS_ABORT_MSG_IF(probe != "flowmon" && probe != "sink", "Unknown probe " << probe);
     std::cout << "nWifi: " << nWifi << ", RAA Algorithm: " << raaAlgo << ", duration: " << duration
               << std::endl;
 
+    std::string raaName = raaAlgo;
     raaAlgo = "ns3::" + raaAlgo + "WifiManager";
 
-    // The underlying restriction of 18 is due to the grid position
-    // allocator's configuration; the grid layout will exceed the
-    // bounding box if more than 18 nodes are provided.
-    if (nWifi > 18)
+    // Only one of the AI managers is linked with this program
+    Config::SetDefaultFailSafe("ns3::AiConstantRateWifiManager::PolicyTable",
+                               BooleanValue(policyTable));
+    Config::SetDefaultFailSafe("ns3::AiThompsonSamplingWifiManager::PolicyTable",
+                               BooleanValue(policyTable));
+    Config::SetDefaultFailSafe("ns3::AiThompsonSamplingWifiManager::Prefetch",
+                               BooleanValue(prefetch));
+    if (!dataMode.empty())
     {
-        std::cout << "nWifi should be 18 or less; otherwise grid layout exceeds the bounding box"
-                  << std::endl;
-        return 1;
+        Config::SetDefault("ns3::ConstantRateWifiManager::DataMode", StringValue(dataMode));
+        Config::SetDefaultFailSafe("ns3::AiConstantRateWifiManager::DataMode",
+                                   StringValue(dataMode));
     }
 
     NodeContainer p2pNodes;
@@ -246,28 +285,39 @@ main(int argc, char* argv[])
     NetDeviceContainer apDevices;
     apDevices = wifi.Install(phy, mac, wifiApNode);
 
-    if (raaAlgo == "ns3::ThompsonSamplingWifiManager")
+    if (raaAlgo == "ns3::ThompsonSamplingWifiManager" ||
+        raaAlgo == "ns3::AiThompsonSamplingWifiManager")
     {
         IntegerValue ival;
         gThompsonSamplingStream.GetValue(ival);
-        NS_LOG_UNCOND("ThompsonSamplingWifiManager stream " << ival.Get());
+        NS_LOG_UNCOND(raaAlgo << " stream " << ival.Get());
         wifi.AssignStreams(apDevices, ival.Get());
         wifi.AssignStreams(staDevices, ival.Get());
     }
 
     MobilityHelper mobility;
 
+    // Up to 18 stations, 3 per row; beyond, a square grid that stays within the bounding
+    // box of the random walk
+    uint32_t gridWidth = 3;
+    double deltaX = 5.0;
+    double deltaY = 10.0;
+    if (nWifi > 18)
+    {
+        gridWidth = std::ceil(std::sqrt(nWifi));
+        deltaX = deltaY = 90.0 / gridWidth;
+    }
     mobility.SetPositionAllocator("ns3::GridPositionAllocator",
                                   "MinX",
                                   DoubleValue(0.0),
                                   "MinY",
                                   DoubleValue(0.0),
                                   "DeltaX",
-                                  DoubleValue(5.0),
+                                  DoubleValue(deltaX),
                                   "DeltaY",
-                                  DoubleValue(10.0),
+                                  DoubleValue(deltaY),
                                   "GridWidth",
-                                  UintegerValue(3),
+                                  UintegerValue(gridWidth),
                                   "LayoutType",
                                   StringValue("RowFirst"));
 
@@ -315,6 +365,8 @@ main(int argc, char* argv[])
     // Set the amount of data to send in bytes.  Zero is unlimited.
     source.SetAttribute("MaxBytes", UintegerValue(maxBytes));
     source.SetAttribute("SendSize", UintegerValue(packetSize));
+    // The sink probe gets the sending time of each chunk from its header
+    source.SetAttribute("EnableSeqTsSizeHeader", BooleanValue(probe == "sink"));
     ApplicationContainer sourceApps;
     for (int i = 0; i < int(nWifi); i++)
     {
@@ -326,18 +378,33 @@ main(int argc, char* argv[])
     // Creating a PacketSinkApplication and install it on one of the CSMA nodes
     PacketSinkHelper sink("ns3::TcpSocketFactory",
                           InetSocketAddress(csmaInterfaces.GetAddress(nCsma), port));
+    sink.SetAttribute("EnableSeqTsSizeHeader", BooleanValue(probe == "sink"));
     ApplicationContainer sinkApps = sink.Install(csmaNodes.Get(nCsma));
     sinkApps.Start(Seconds(2.0 - 1.0));
     sinkApps.Stop(Seconds(2.0 + duration));
 
     Ipv4GlobalRoutingHelper::PopulateRoutingTables();
 
-    // Initialisation of global variable which are used for Throughput and Delay Calculation.
-    data.monitor = data.flowmon.InstallAll();
-    data.totalDelaySum = 0;
-    data.totalRxBytes = 0;
-    data.totalRxPackets = 0;
-    Simulator::Schedule(Seconds(2.0 - 1.0), &Throughput);
+    if (benchmark)
+    {
+        Config::ConnectWithoutContext(
+            "/NodeList/*/DeviceList/*/$ns3::WifiNetDevice/Phy/PhyTxBegin",
+            MakeCallback(&CountPhyTx));
+    }
+    else if (probe == "sink")
+    {
+        sinkProbe.Install(DynamicCast<PacketSink>(sinkApps.Get(0)));
+        sinkProbe.Start(Seconds(2.0 - 1.0), Seconds(statInterval));
+    }
+    else
+    {
+        // Initialisation of global variable which are used for Throughput and Delay Calculation.
+        data.monitor = data.flowmon.InstallAll();
+        data.totalDelaySum = 0;
+        data.totalRxBytes = 0;
+        data.totalRxPackets = 0;
+        Simulator::Schedule(Seconds(2.0 - 1.0), &Throughput);
+    }
 
     Simulator::Stop(Seconds(2.0 + duration + 1.0));
 
@@ -348,13 +415,34 @@ main(int argc, char* argv[])
         csma.EnablePcap("third_csma", csmaDevices.Get(0), true);
     }
 
+    if (benchmark)
+    {
+        RateControlBenchmark::Get().Begin();
+    }
     Simulator::Run();
+    if (benchmark)
+    {
+        RateControlBenchmark::Get().End();
+    }
 
     Ptr<PacketSink> sink1 = DynamicCast<PacketSink>(sinkApps.Get(0));
+    double throughput = sink1->GetTotalRx() * 8.0 / duration / (1024 * 1024);
     std::cout << "Total Bytes Received: " << sink1->GetTotalRx() << std::endl;
-    std::cout << "Average Throughput: " << sink1->GetTotalRx() * 8.0 / duration / (1024 * 1024)
-              << "Mbps" << std::endl;
-    std::cout << "Average Delay: " << data.averageDelay() << "ms" << std::endl;
+    std::cout << "Average Throughput: " << throughput << "Mbps" << std::endl;
+    if (benchmark)
+    {
+        RateControlBenchmark::Get().Report(raaName,
+                                           standard,
+                                           dataMode.empty() ? "default" : dataMode,
+                                           nWifi,
+                                           Simulator::Now().GetSeconds(),
+                                           throughput);
+    }
+    else
+    {
+        double averageDelay = probe == "sink" ? sinkProbe.AverageDelay() : data.averageDelay();
+        std::cout << "Average Delay: " << averageDelay << "ms" << std::endl;
+    }
 
     Simulator::Destroy();
     return 0;
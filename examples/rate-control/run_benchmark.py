@@ -0,0 +1,118 @@
+# Copyright (c) 2023 Huazhong University of Science and Technology
+#
+# This program is free software; you can redistribute it and/or modify
+# it under the terms of the GNU General Public License version 2 as
+# published by the Free Software Foundation;
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program; if not, write to the Free Software
+# Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+# Runs the rate control scenario with an increasing number of stations, for each
+# Wi-Fi standard, data mode and manager (built-in or AI), and prints the benchmark
+# counters side by side. The C++ executables and the Python bindings must be built
+# beforehand.
+
+import os
+import sys
+import csv
+import argparse
+import subprocess
+
+EXAMPLE_DIR = os.path.dirname(os.path.abspath(__file__))
+NS3_DIR = os.path.abspath(os.path.join(EXAMPLE_DIR, '../../../..'))
+COLUMNS = ['manager', 'standard', 'data_mode', 'stations', 'sim_s', 'wall_s',
+           'wall_per_sim_s', 'events', 'frames', 'frames_per_s', 'ipc_rounds',
+           'ipc_rounds_per_s', 'ipc_share', 'throughput_mbps']
+# AI managers are run by their Python script, built-in ones directly
+AI_SCRIPTS = {
+    'AiConstantRate': ('constant', 'ai_constant_rate.py'),
+    'AiThompsonSampling': ('thompson-sampling', 'ai_thompson_sampling.py')}
+CONSTANT_MANAGERS = ('ConstantRate', 'AiConstantRate')
+MCS_PREFIX = {'11n': 'HtMcs', '11ac': 'VhtMcs', '11ax': 'HeMcs'}
+
+parser = argparse.ArgumentParser()
+parser.add_argument('--stations', type=str, default='10,50,100,200',
+                    help='comma separated numbers of Wi-Fi stations')
+parser.add_argument('--standards', type=str, default='11ac',
+                    help='comma separated standards among 11a, 11n, 11ac and 11ax')
+parser.add_argument('--mcs', type=str, default='',
+                    help='comma separated MCS indices of the constant managers, e.g. 0,4,7 '
+                         '(empty: the default data mode of the managers)')
+parser.add_argument('--managers', type=str,
+                    default='ConstantRate,ThompsonSampling,AiConstantRate,AiThompsonSampling',
+                    help='comma separated managers')
+parser.add_argument('--duration', type=float, default=5,
+                    help='duration of the traffic (seconds)')
+parser.add_argument('--policy_table', action='store_true',
+                    help='AI managers sample their decisions locally from tables pushed by Python')
+parser.add_argument('--prefetch', action='store_true',
+                    help='AI Thompson sampling requests the next MCS ahead of time')
+parser.add_argument('--csv', type=str, help='also write the results to this CSV file')
+args = parser.parse_args()
+
+
+def data_modes(manager, standard):
+    # the MCS range only applies to the constant managers, and to HT/VHT/HE standards
+    if manager not in CONSTANT_MANAGERS or not args.mcs or standard not in MCS_PREFIX:
+        return ['']
+    return [MCS_PREFIX[standard] + mcs for mcs in args.mcs.split(',')]
+
+
+def command(manager, standard, data_mode, stations):
+    settings = {'raa': manager, 'standard': standard, 'nWifi': stations,
+                'duration': args.duration, 'benchmark': 'true'}
+    if data_mode:
+        settings['dataMode'] = data_mode
+    if manager in AI_SCRIPTS:
+        # the Python scripts start the simulation themselves
+        directory, script = AI_SCRIPTS[manager]
+        cmd = [sys.executable, script]
+        cmd += ['--ns3_setting={}={}'.format(key, value) for key, value in settings.items()]
+        if args.policy_table:
+            cmd.append('--policy_table')
+        if args.prefetch and manager == 'AiThompsonSampling':
+            cmd.append('--prefetch')
+        return cmd, os.path.join(EXAMPLE_DIR, directory)
+    program = 'ns3ai_ratecontrol_constant' + ''.join(
+        ' --{}={}'.format(key, value) for key, value in settings.items())
+    return [os.path.join(NS3_DIR, 'ns3'), 'run', program], NS3_DIR
+
+
+def run(manager, standard, data_mode, stations):
+    cmd, cwd = command(manager, standard, data_mode, stations)
+    proc = subprocess.run(cmd, cwd=cwd, text=True, stdout=subprocess.PIPE,
+                          stderr=subprocess.DEVNULL)
+    for line in proc.stdout.splitlines():
+        if line.startswith('BENCHMARK '):
+            return dict(item.split('=', 1) for item in line.split()[1:])
+    print('{} failed (exit code {})'.format(manager, proc.returncode))
+    return None
+
+
+results = []
+for stations in [int(n) for n in args.stations.split(',')]:
+    for standard in args.standards.split(','):
+        for manager in args.managers.split(','):
+            for data_mode in data_modes(manager, standard):
+                print('Running {} ({} {}) with {} stations...'.format(
+                    manager, standard, data_mode or 'default', stations), flush=True)
+                result = run(manager, standard, data_mode, stations)
+                if result:
+                    results.append(result)
+
+print()
+print(''.join('{:>17}'.format(column) for column in COLUMNS))
+for result in results:
+    print(''.join('{:>17}'.format(result.get(column, '-')) for column in COLUMNS))
+
+if args.csv:
+    with open(args.csv, 'w', newline='') as f:
+        writer = csv.DictWriter(f, fieldnames=COLUMNS, extrasaction='ignore')
+        writer.writeheader()
+        writer.writerows(results)
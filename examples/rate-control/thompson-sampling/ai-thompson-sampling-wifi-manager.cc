@@ -22,12 +22,16 @@
 
 #include "ai-thompson-sampling-wifi-manager.h"
 
+#include "../rate-control-benchmark.h"
+
 #include <ns3/core-module.h>
 #include <ns3/double.h>
 #include <ns3/log.h>
+#include <ns3/ns3-ai-policy-table.h>
 #include <ns3/packet.h>
 #include <ns3/wifi-phy.h>
 
+#include <cmath>
 #include <iostream>
 #include <vector>
 
@@ -47,6 +51,9 @@ struct AiRateStats
     WifiMode mode;         ///< MCS
     uint16_t channelWidth; ///< channel width in MHz
     uint8_t nss;           ///< Number of spatial streams
+    double success{0};     ///< averaged number of successful frames
+    double fails{0};       ///< averaged number of failed frames
+    Time lastDecay{0};     ///< last time exponential decay was applied
 };
 
 /**
@@ -57,10 +64,98 @@ struct AiRateStats
  */
 struct AiThompsonSamplingWifiRemoteStation : public WifiRemoteStation
 {
-    int8_t m_ns3ai_station_id;
+    int16_t m_ns3ai_station_id;
+    size_t m_nextMode{0};                //!< Mode to use for the next frames
+    size_t m_lastMode{0};                //!< Mode used for the last frame
+    bool m_feedbackPending{false};       //!< Feedback received since the last decision
+    bool m_queued{false};                //!< Queued to be sampled with another request
     std::vector<AiRateStats> m_mcsStats; //!< Collected statistics
+    Ns3AiPolicyTable m_table;            //!< Decision table (PolicyTable mode)
+
+    ~AiThompsonSamplingWifiRemoteStation() override;
+};
+
+/// Live stations, indexed by their dense IDs, so that queued IDs of deleted stations are skipped
+static std::array<AiThompsonSamplingWifiRemoteStation*, TS_ARENA_STATIONS> g_stations{};
+
+AiThompsonSamplingWifiRemoteStation::~AiThompsonSamplingWifiRemoteStation()
+{
+    g_stations[m_ns3ai_station_id] = nullptr;
+}
+
+/**
+ * The UpdateNextMode request in flight (Prefetch mode). There is at most one, shared
+ * by all the managers since they share the message interface.
+ */
+struct AiThompsonSamplingPrefetch
+{
+    AiThompsonSamplingWifiRemoteStation* station{nullptr}; //!< Station of the request
 };
 
+static AiThompsonSamplingPrefetch g_prefetch;
+
+/**
+ * Receives the reply to the request in flight, if any, and sets the next mode of
+ * its station. The synchronous exchanges wait for it before sending.
+ *
+ * \param wait Whether to wait for the reply.
+ * \return Whether no request is in flight anymore.
+ */
+static bool
+CollectPrefetch(bool wait)
+{
+    if (!g_prefetch.station)
+    {
+        return true;
+    }
+    Ns3AiMsgInterfaceImpl<AiThompsonSamplingEnvStruct, AiThompsonSamplingActStruct>* msgInterface =
+        Ns3AiMsgInterface::Get()
+            ->GetInterface<AiThompsonSamplingEnvStruct, AiThompsonSamplingActStruct>();
+
+    // only the time blocked here is accounted, the rest overlapped with the simulation
+    auto begin = RateControlBenchmark::Clock::now();
+    if (wait)
+    {
+        msgInterface->CppRecvBegin();
+    }
+    else if (!msgInterface->CppTryRecvBegin())
+    {
+        return false;
+    }
+    AiThompsonSamplingWifiRemoteStation* station = g_prefetch.station;
+    NS_ASSERT_MSG(msgInterface->GetPy2CppStruct()->stationId == station->m_ns3ai_station_id,
+                  "Error 0x0a");
+    station->m_nextMode = msgInterface->GetPy2CppStruct()->res;
+    msgInterface->CppRecvEnd();
+    RateControlBenchmark::Get().RecordIpcRound(begin);
+
+    NS_ASSERT_MSG(station->m_nextMode < station->m_mcsStats.size(), "Invalid mode from Python");
+    g_prefetch.station = nullptr;
+    return true;
+}
+
+/// Number of managers created, which gives the next dense manager ID
+static int16_t g_nManagers = 0;
+/// Number of stations created, which gives the next dense station ID (arena index)
+static int16_t g_nStations = 0;
+
+/**
+ * Copies the statistics of a station into its record in the shared arena.
+ *
+ * \param station Station whose statistics are copied.
+ * \param env Structure shared with Python.
+ */
+static void
+CopyStats(const AiThompsonSamplingWifiRemoteStation* station, AiThompsonSamplingEnvStruct* env)
+{
+    auto& s = env->stations[station->m_ns3ai_station_id].stats;
+    for (size_t i = 0; i < station->m_mcsStats.size(); i++)
+    {
+        s[i].success = station->m_mcsStats[i].success;
+        s[i].fails = station->m_mcsStats[i].fails;
+    }
+}
+
 TypeId
 AiThompsonSamplingWifiManager::GetTypeId()
 {
@@ -75,6 +170,30 @@ AiThompsonSamplingWifiManager::GetTypeId()
                 DoubleValue(1.0),
                 MakeDoubleAccessor(&AiThompsonSamplingWifiManager::m_decay),
                 MakeDoubleChecker<double>(0.0))
+            .AddAttribute("PolicyTable",
+                          "Draw the modes locally from a decision table pushed by Python, "
+                          "which is only asked again when the table expires or drifts",
+                          BooleanValue(false),
+                          MakeBooleanAccessor(&AiThompsonSamplingWifiManager::m_policyTable),
+                          MakeBooleanChecker())
+            .AddAttribute("Prefetch",
+                          "Request the next mode as soon as feedback arrives, without waiting "
+                          "for the reply, which is used by a later transmission if it arrived "
+                          "by then. Ignored in PolicyTable mode",
+                          BooleanValue(false),
+                          MakeBooleanAccessor(&AiThompsonSamplingWifiManager::m_prefetch),
+                          MakeBooleanChecker())
+            .AddAttribute("DriftThreshold",
+                          "Difference between the observed and the expected success rates of "
+                          "the frames sent with a table that expires it; zero disables it",
+                          DoubleValue(0.2),
+                          MakeDoubleAccessor(&AiThompsonSamplingWifiManager::m_driftThreshold),
+                          MakeDoubleChecker<double>(0.0, 1.0))
+            .AddAttribute("DriftMinFrames",
+                          "Number of frames sent with a table before its drift is checked",
+                          UintegerValue(20),
+                          MakeUintegerAccessor(&AiThompsonSamplingWifiManager::m_driftMinFrames),
+                          MakeUintegerChecker<uint32_t>())
             .AddTraceSource("Rate",
                             "Traced value for rate changes (b/s)",
                             MakeTraceSourceAccessor(&AiThompsonSamplingWifiManager::m_currentRate),
@@ -86,20 +205,14 @@ AiThompsonSamplingWifiManager::AiThompsonSamplingWifiManager()
     : m_currentRate{0}
 {
     NS_LOG_FUNCTION(this);
+    m_tableRandom = CreateObject<UniformRandomVariable>();
     auto interface = Ns3AiMsgInterface::Get();
     interface->SetIsMemoryCreator(false);
     interface->SetUseVector(false);
     interface->SetHandleFinish(true);
-    Ns3AiMsgInterfaceImpl<AiThompsonSamplingEnvStruct, AiThompsonSamplingActStruct>* msgInterface =
-        interface->GetInterface<AiThompsonSamplingEnvStruct, AiThompsonSamplingActStruct>();
-
-    msgInterface->CppSendBegin();
-    msgInterface->GetCpp2PyStruct()->type = 0x01;
-    msgInterface->CppSendEnd();
-
-    msgInterface->CppRecvBegin();
-    m_ns3ai_manager_id = msgInterface->GetPy2CppStruct()->managerId;
-    msgInterface->CppRecvEnd();
+    interface->GetInterface<AiThompsonSamplingEnvStruct, AiThompsonSamplingActStruct>();
+    // Python creates the state of a manager when it first sees its ID
+    m_ns3ai_manager_id = g_nManagers++;
 }
 
 AiThompsonSamplingWifiManager::~AiThompsonSamplingWifiManager()
@@ -107,23 +220,33 @@ AiThompsonSamplingWifiManager::~AiThompsonSamplingWifiManager()
     NS_LOG_FUNCTION(this);
 }
 
+void
+AiThompsonSamplingWifiManager::DoDispose()
+{
+    NS_LOG_FUNCTION(this);
+    // the station of the request in flight may be deleted with the others
+    CollectPrefetch(true);
+    WifiRemoteStationManager::DoDispose();
+}
+
+int64_t
+AiThompsonSamplingWifiManager::AssignStreams(int64_t stream)
+{
+    NS_LOG_FUNCTION(this << stream);
+    m_tableRandom->SetStream(stream);
+    return 1;
+}
+
 WifiRemoteStation*
 AiThompsonSamplingWifiManager::DoCreateStation() const
 {
     NS_LOG_FUNCTION(this);
+    NS_ABORT_MSG_IF(g_nStations >= static_cast<int32_t>(TS_ARENA_STATIONS),
+                    "Station arena full, increase TS_ARENA_STATIONS");
     AiThompsonSamplingWifiRemoteStation* station = new AiThompsonSamplingWifiRemoteStation();
-    Ns3AiMsgInterfaceImpl<AiThompsonSamplingEnvStruct, AiThompsonSamplingActStruct>* msgInterface =
-        Ns3AiMsgInterface::Get()
-            ->GetInterface<AiThompsonSamplingEnvStruct, AiThompsonSamplingActStruct>();
-
-    msgInterface->CppSendBegin();
-    msgInterface->GetCpp2PyStruct()->type = 0x02;
-    msgInterface->CppSendEnd();
-
-    msgInterface->CppRecvBegin();
-    station->m_ns3ai_station_id = msgInterface->GetPy2CppStruct()->stationId;
-    msgInterface->CppRecvEnd();
-
+    // the record of the station is written when it is initialized
+    station->m_ns3ai_station_id = g_nStations++;
+    g_stations[station->m_ns3ai_station_id] = station;
     return station;
 }
 
@@ -194,14 +317,14 @@ AiThompsonSamplingWifiManager::InitializeStation(WifiRemoteStation* st) const
         Ns3AiMsgInterface::Get()
             ->GetInterface<AiThompsonSamplingEnvStruct, AiThompsonSamplingActStruct>();
 
-    msgInterface->CppSendBegin();
-    msgInterface->GetCpp2PyStruct()->type = 0x03;
-    msgInterface->GetCpp2PyStruct()->managerId = m_ns3ai_manager_id;
-    msgInterface->GetCpp2PyStruct()->stationId = station->m_ns3ai_station_id;
-
-    NS_ASSERT_MSG(station->m_mcsStats.size() <= 64, "m_mcsStats too long");
+    NS_ASSERT_MSG(station->m_mcsStats.size() <= TS_MAX_MODES, "m_mcsStats too long");
 
-    auto& s = msgInterface->GetCpp2PyStruct()->data.stats;
+    // Python reads the rate table from the record at the first request of the station,
+    // whose own record is never read before, so no round trip is needed
+    ThompsonSamplingStationRecord& record =
+        msgInterface->GetCpp2PyStruct()->stations[station->m_ns3ai_station_id];
+    record.managerId = m_ns3ai_manager_id;
+    auto& s = record.modes;
     for (size_t i = 0; i < station->m_mcsStats.size(); i++)
     {
         const WifiMode mode{station->m_mcsStats.at(i).mode};
@@ -211,16 +334,23 @@ AiThompsonSamplingWifiManager::InitializeStation(WifiRemoteStation* st) const
         s.at(i).dataRate =
             mode.GetDataRate(s.at(i).channelWidth, s.at(i).guardInterval, s.at(i).nss);
     }
-    s[station->m_mcsStats.size()].lastDecay = -1.0;
-    msgInterface->CppSendEnd();
+    record.nModes = station->m_mcsStats.size();
 
-    msgInterface->CppRecvBegin();
-    NS_ASSERT_MSG(msgInterface->GetPy2CppStruct()->stationId ==
-                      msgInterface->GetCpp2PyStruct()->stationId,
-                  "Error 0x03");
-    msgInterface->CppRecvEnd();
+    // the first mode is drawn at the first transmission
+    SetFeedbackPending(st);
+}
 
-    UpdateNextMode(st);
+void
+AiThompsonSamplingWifiManager::SetFeedbackPending(WifiRemoteStation* st) const
+{
+    auto station = static_cast<AiThompsonSamplingWifiRemoteStation*>(st);
+    station->m_feedbackPending = true;
+    // only the synchronous requests carry a batch
+    if (!station->m_queued && !m_policyTable && !m_prefetch)
+    {
+        station->m_queued = true;
+        m_pendingStations.push_back(station->m_ns3ai_station_id);
+    }
 }
 
 void
@@ -243,23 +373,15 @@ AiThompsonSamplingWifiManager::DoReportDataFailed(WifiRemoteStation* st)
     NS_LOG_FUNCTION(this << st);
     InitializeStation(st);
     auto station = static_cast<AiThompsonSamplingWifiRemoteStation*>(st);
-    Ns3AiMsgInterfaceImpl<AiThompsonSamplingEnvStruct, AiThompsonSamplingActStruct>* msgInterface =
-        Ns3AiMsgInterface::Get()
-            ->GetInterface<AiThompsonSamplingEnvStruct, AiThompsonSamplingActStruct>();
-
-    msgInterface->CppSendBegin();
-    msgInterface->GetCpp2PyStruct()->type = 0x05;
-    msgInterface->GetCpp2PyStruct()->managerId = m_ns3ai_manager_id;
-    msgInterface->GetCpp2PyStruct()->stationId = station->m_ns3ai_station_id;
-    msgInterface->GetCpp2PyStruct()->data.decay.decay = m_decay;
-    msgInterface->GetCpp2PyStruct()->data.decay.now = Simulator::Now().GetSeconds();
-    msgInterface->CppSendEnd();
-
-    msgInterface->CppRecvBegin();
-    NS_ASSERT_MSG(msgInterface->GetPy2CppStruct()->stationId ==
-                      msgInterface->GetCpp2PyStruct()->stationId,
-                  "Error 0x05");
-    msgInterface->CppRecvEnd();
+    AiRateStats& stats = station->m_mcsStats.at(station->m_lastMode);
+    Decay(stats);
+    stats.fails++;
+    station->m_table.ReportOutcome(station->m_lastMode, 0, 1);
+    SetFeedbackPending(st);
+    if (m_prefetch && !m_policyTable)
+    {
+        Prefetch(st);
+    }
 }
 
 void
@@ -271,6 +393,20 @@ AiThompsonSamplingWifiManager::DoReportRtsOk(WifiRemoteStation* st,
     NS_LOG_FUNCTION(this << st << ctsSnr << ctsMode.GetUniqueName() << rtsSnr);
 }
 
+void
+AiThompsonSamplingWifiManager::Decay(AiRateStats& stats) const
+{
+    Time now = Simulator::Now();
+    if (now > stats.lastDecay)
+    {
+        const double coefficient = std::exp(m_decay * (stats.lastDecay - now).GetSeconds());
+
+        stats.success *= coefficient;
+        stats.fails *= coefficient;
+        stats.lastDecay = now;
+    }
+}
+
 void
 AiThompsonSamplingWifiManager::UpdateNextMode(WifiRemoteStation* st) const
 {
@@ -281,81 +417,191 @@ AiThompsonSamplingWifiManager::UpdateNextMode(WifiRemoteStation* st) const
         Ns3AiMsgInterface::Get()
             ->GetInterface<AiThompsonSamplingEnvStruct, AiThompsonSamplingActStruct>();
 
+    // the statistics are decayed here, Python only samples from them
+    CollectPrefetch(true);
+    auto begin = RateControlBenchmark::Clock::now();
     msgInterface->CppSendBegin();
-    msgInterface->GetCpp2PyStruct()->type = 0x0a;
-    msgInterface->GetCpp2PyStruct()->managerId = m_ns3ai_manager_id;
-    msgInterface->GetCpp2PyStruct()->stationId = station->m_ns3ai_station_id;
-    msgInterface->GetCpp2PyStruct()->data.decay.decay = m_decay;
-    msgInterface->GetCpp2PyStruct()->data.decay.now = Simulator::Now().GetSeconds();
+    AiThompsonSamplingEnvStruct* env = msgInterface->GetCpp2PyStruct();
+    env->type = 0x0a;
+    env->managerId = m_ns3ai_manager_id;
+    env->stationId = station->m_ns3ai_station_id;
+    for (auto& stats : station->m_mcsStats)
+    {
+        Decay(stats);
+    }
+    CopyStats(station, env);
+
+    // the other stations with feedback since their last decision are sampled in the
+    // same call, and use their new mode at their next transmission without a request
+    std::vector<AiThompsonSamplingWifiRemoteStation*> batch;
+    std::size_t kept = 0;
+    for (int16_t id : m_pendingStations)
+    {
+        AiThompsonSamplingWifiRemoteStation* other = g_stations[id];
+        if (!other)
+        {
+            continue;
+        }
+        if (other != station && other->m_feedbackPending && batch.size() == TS_MAX_BATCH)
+        {
+            m_pendingStations[kept++] = id;
+            continue;
+        }
+        other->m_queued = false;
+        if (other == station || !other->m_feedbackPending)
+        {
+            continue;
+        }
+        for (auto& stats : other->m_mcsStats)
+        {
+            Decay(stats);
+        }
+        CopyStats(other, env);
+        env->batch[batch.size()] = id;
+        batch.push_back(other);
+    }
+    m_pendingStations.resize(kept);
+    env->nBatch = batch.size();
     msgInterface->CppSendEnd();
 
     msgInterface->CppRecvBegin();
-    NS_ASSERT_MSG(msgInterface->GetPy2CppStruct()->stationId ==
-                      msgInterface->GetCpp2PyStruct()->stationId,
-                  "Error 0x0a");
+    const AiThompsonSamplingActStruct* act = msgInterface->GetPy2CppStruct();
+    NS_ASSERT_MSG(act->stationId == env->stationId, "Error 0x0a");
+    station->m_nextMode = act->res;
+    for (std::size_t i = 0; i < batch.size(); i++)
+    {
+        batch[i]->m_nextMode = act->batchModes[i];
+    }
     msgInterface->CppRecvEnd();
+    RateControlBenchmark::Get().RecordIpcRound(begin);
+    NS_LOG_DEBUG("Station " << station->m_ns3ai_station_id << " sampled with " << batch.size()
+                            << " pending stations");
+
+    NS_ASSERT_MSG(station->m_nextMode < station->m_mcsStats.size(), "Invalid mode from Python");
+    station->m_feedbackPending = false;
+    for (auto other : batch)
+    {
+        NS_ASSERT_MSG(other->m_nextMode < other->m_mcsStats.size(), "Invalid mode from Python");
+        other->m_feedbackPending = false;
+    }
 }
 
 void
-AiThompsonSamplingWifiManager::DoReportDataOk(WifiRemoteStation* st,
-                                              double ackSnr,
-                                              WifiMode ackMode,
-                                              double dataSnr,
-                                              uint16_t dataChannelWidth,
-                                              uint8_t dataNss)
+AiThompsonSamplingWifiManager::Prefetch(WifiRemoteStation* st) const
 {
-    NS_LOG_FUNCTION(this << st << ackSnr << ackMode.GetUniqueName() << dataSnr);
     InitializeStation(st);
     auto station = static_cast<AiThompsonSamplingWifiRemoteStation*>(st);
+    if (!CollectPrefetch(false))
+    {
+        NS_LOG_DEBUG("Request of another station in flight, station "
+                     << station->m_ns3ai_station_id << " is asked later");
+        return;
+    }
     Ns3AiMsgInterfaceImpl<AiThompsonSamplingEnvStruct, AiThompsonSamplingActStruct>* msgInterface =
         Ns3AiMsgInterface::Get()
             ->GetInterface<AiThompsonSamplingEnvStruct, AiThompsonSamplingActStruct>();
 
+    // same request as UpdateNextMode, whose reply is received by CollectPrefetch
     msgInterface->CppSendBegin();
-    msgInterface->GetCpp2PyStruct()->type = 0x06;
+    msgInterface->GetCpp2PyStruct()->type = 0x0a;
     msgInterface->GetCpp2PyStruct()->managerId = m_ns3ai_manager_id;
     msgInterface->GetCpp2PyStruct()->stationId = station->m_ns3ai_station_id;
-    msgInterface->GetCpp2PyStruct()->data.decay.decay = m_decay;
-    msgInterface->GetCpp2PyStruct()->data.decay.now = Simulator::Now().GetSeconds();
+    msgInterface->GetCpp2PyStruct()->nBatch = 0;
+    for (auto& stats : station->m_mcsStats)
+    {
+        Decay(stats);
+    }
+    CopyStats(station, msgInterface->GetCpp2PyStruct());
     msgInterface->CppSendEnd();
 
-    msgInterface->CppRecvBegin();
-    NS_ASSERT_MSG(msgInterface->GetPy2CppStruct()->stationId ==
-                      msgInterface->GetCpp2PyStruct()->stationId,
-                  "Error 0x06");
-    msgInterface->CppRecvEnd();
+    g_prefetch.station = station;
+    // the feedback received from now on is sent with the next request
+    station->m_feedbackPending = false;
 }
 
 void
-AiThompsonSamplingWifiManager::DoReportAmpduTxStatus(WifiRemoteStation* st,
-                                                     uint16_t nSuccessfulMpdus,
-                                                     uint16_t nFailedMpdus,
-                                                     double rxSnr,
-                                                     double dataSnr,
-                                                     uint16_t dataChannelWidth,
-                                                     uint8_t dataNss)
+AiThompsonSamplingWifiManager::UpdatePolicyTable(WifiRemoteStation* st) const
 {
-    NS_LOG_FUNCTION(this << st << nSuccessfulMpdus << nFailedMpdus << rxSnr << dataSnr);
     InitializeStation(st);
     auto station = static_cast<AiThompsonSamplingWifiRemoteStation*>(st);
     Ns3AiMsgInterfaceImpl<AiThompsonSamplingEnvStruct, AiThompsonSamplingActStruct>* msgInterface =
         Ns3AiMsgInterface::Get()
             ->GetInterface<AiThompsonSamplingEnvStruct, AiThompsonSamplingActStruct>();
 
+    CollectPrefetch(true);
+    auto begin = RateControlBenchmark::Clock::now();
     msgInterface->CppSendBegin();
-    msgInterface->GetCpp2PyStruct()->type = 0x07;
+    msgInterface->GetCpp2PyStruct()->type = 0x0b;
     msgInterface->GetCpp2PyStruct()->managerId = m_ns3ai_manager_id;
     msgInterface->GetCpp2PyStruct()->stationId = station->m_ns3ai_station_id;
-    msgInterface->GetCpp2PyStruct()->var = (uint64_t)nSuccessfulMpdus << 32 | nFailedMpdus;
-    msgInterface->GetCpp2PyStruct()->data.decay.decay = m_decay;
-    msgInterface->GetCpp2PyStruct()->data.decay.now = Simulator::Now().GetSeconds();
+    msgInterface->GetCpp2PyStruct()->nBatch = 0;
+    for (auto& stats : station->m_mcsStats)
+    {
+        Decay(stats);
+    }
+    CopyStats(station, msgInterface->GetCpp2PyStruct());
     msgInterface->CppSendEnd();
 
     msgInterface->CppRecvBegin();
     NS_ASSERT_MSG(msgInterface->GetPy2CppStruct()->stationId ==
                       msgInterface->GetCpp2PyStruct()->stationId,
-                  "Error 0x07");
+                  "Error 0x0b");
+    const ThompsonSamplingPolicyTable& table = msgInterface->GetPy2CppStruct()->table;
+    station->m_table.Set(table.probability.data(),
+                         table.successRate.data(),
+                         station->m_mcsStats.size(),
+                         Seconds(table.validity));
     msgInterface->CppRecvEnd();
+    RateControlBenchmark::Get().RecordIpcRound(begin);
+
+    station->m_table.SetDriftDetection(m_driftThreshold, m_driftMinFrames);
+    station->m_feedbackPending = false;
+}
+
+void
+AiThompsonSamplingWifiManager::DoReportDataOk(WifiRemoteStation* st,
+                                              double ackSnr,
+                                              WifiMode ackMode,
+                                              double dataSnr,
+                                              uint16_t dataChannelWidth,
+                                              uint8_t dataNss)
+{
+    NS_LOG_FUNCTION(this << st << ackSnr << ackMode.GetUniqueName() << dataSnr);
+    InitializeStation(st);
+    auto station = static_cast<AiThompsonSamplingWifiRemoteStation*>(st);
+    AiRateStats& stats = station->m_mcsStats.at(station->m_lastMode);
+    Decay(stats);
+    stats.success++;
+    station->m_table.ReportOutcome(station->m_lastMode, 1, 0);
+    SetFeedbackPending(st);
+    if (m_prefetch && !m_policyTable)
+    {
+        Prefetch(st);
+    }
+}
+
+void
+AiThompsonSamplingWifiManager::DoReportAmpduTxStatus(WifiRemoteStation* st,
+                                                     uint16_t nSuccessfulMpdus,
+                                                     uint16_t nFailedMpdus,
+                                                     double rxSnr,
+                                                     double dataSnr,
+                                                     uint16_t dataChannelWidth,
+                                                     uint8_t dataNss)
+{
+    NS_LOG_FUNCTION(this << st << nSuccessfulMpdus << nFailedMpdus << rxSnr << dataSnr);
+    InitializeStation(st);
+    auto station = static_cast<AiThompsonSamplingWifiRemoteStation*>(st);
+    AiRateStats& stats = station->m_mcsStats.at(station->m_lastMode);
+    Decay(stats);
+    stats.success += nSuccessfulMpdus;
+    stats.fails += nFailedMpdus;
+    station->m_table.ReportOutcome(station->m_lastMode, nSuccessfulMpdus, nFailedMpdus);
+    SetFeedbackPending(st);
+    if (m_prefetch && !m_policyTable)
+    {
+        Prefetch(st);
+    }
 }
 
 void
@@ -395,23 +641,36 @@ AiThompsonSamplingWifiManager::DoGetDataTxVector(WifiRemoteStation* st, uint16_t
     NS_LOG_FUNCTION(this << st);
     InitializeStation(st);
     auto station = static_cast<AiThompsonSamplingWifiRemoteStation*>(st);
-    Ns3AiMsgInterfaceImpl<AiThompsonSamplingEnvStruct, AiThompsonSamplingActStruct>* msgInterface =
-        Ns3AiMsgInterface::Get()
-            ->GetInterface<AiThompsonSamplingEnvStruct, AiThompsonSamplingActStruct>();
-
-    msgInterface->CppSendBegin();
-    msgInterface->GetCpp2PyStruct()->type = 0x08;
-    msgInterface->GetCpp2PyStruct()->managerId = m_ns3ai_manager_id;
-    msgInterface->GetCpp2PyStruct()->stationId = station->m_ns3ai_station_id;
-    msgInterface->CppSendEnd();
+    if (m_policyTable)
+    {
+        // Python is only asked for a new table when the current one expired or drifted
+        if (!station->m_table.IsValid())
+        {
+            UpdatePolicyTable(st);
+        }
+        station->m_nextMode = station->m_table.Sample(m_tableRandom->GetValue());
+    }
+    else if (m_prefetch)
+    {
+        // the reply of an earlier request is used if it arrived, the last mode otherwise
+        CollectPrefetch(false);
+        if (station->m_feedbackPending)
+        {
+            Prefetch(st);
+        }
+    }
+    // Python is only asked for a new mode when feedback arrived since the last decision
+    else if (station->m_feedbackPending)
+    {
+        UpdateNextMode(st);
+    }
+    station->m_lastMode = station->m_nextMode;
 
-    msgInterface->CppRecvBegin();
-    WifiMode mode = station->m_mcsStats.at(msgInterface->GetPy2CppStruct()->res).mode;
-    uint8_t nss = msgInterface->GetPy2CppStruct()->stats.nss;
-    uint16_t channelWidth =
-        std::min(msgInterface->GetPy2CppStruct()->stats.channelWidth, GetPhy()->GetChannelWidth());
-    uint16_t guardInterval = msgInterface->GetPy2CppStruct()->stats.guardInterval;
-    msgInterface->CppRecvEnd();
+    const AiRateStats& stats = station->m_mcsStats.at(station->m_nextMode);
+    WifiMode mode = stats.mode;
+    uint8_t nss = stats.nss;
+    uint16_t channelWidth = std::min(stats.channelWidth, GetPhy()->GetChannelWidth());
+    uint16_t guardInterval = GetModeGuardInterval(st, mode);
 
     uint64_t rate = mode.GetDataRate(channelWidth, guardInterval, nss);
     if (m_currentRate != rate)
@@ -439,23 +698,13 @@ AiThompsonSamplingWifiManager::DoGetRtsTxVector(WifiRemoteStation* st)
     NS_LOG_FUNCTION(this << st);
     InitializeStation(st);
     auto station = static_cast<AiThompsonSamplingWifiRemoteStation*>(st);
-    Ns3AiMsgInterfaceImpl<AiThompsonSamplingEnvStruct, AiThompsonSamplingActStruct>* msgInterface =
-        Ns3AiMsgInterface::Get()
-            ->GetInterface<AiThompsonSamplingEnvStruct, AiThompsonSamplingActStruct>();
 
-    msgInterface->CppSendBegin();
-    msgInterface->GetCpp2PyStruct()->type = 0x09;
-    msgInterface->GetCpp2PyStruct()->managerId = m_ns3ai_manager_id;
-    msgInterface->GetCpp2PyStruct()->stationId = station->m_ns3ai_station_id;
-    msgInterface->CppSendEnd();
-
-    msgInterface->CppRecvBegin();
-    WifiMode mode = station->m_mcsStats.at(msgInterface->GetPy2CppStruct()->res).mode;
-    uint8_t nss = msgInterface->GetPy2CppStruct()->stats.nss;
-    uint16_t channelWidth =
-        std::min(msgInterface->GetPy2CppStruct()->stats.channelWidth, GetPhy()->GetChannelWidth());
-    uint16_t guardInterval = msgInterface->GetPy2CppStruct()->stats.guardInterval;
-    msgInterface->CppRecvEnd();
+    // Use the most robust MCS for the control frames
+    const AiRateStats& stats = station->m_mcsStats.at(0);
+    WifiMode mode = stats.mode;
+    uint8_t nss = stats.nss;
+    uint16_t channelWidth = std::min(stats.channelWidth, GetPhy()->GetChannelWidth());
+    uint16_t guardInterval = GetModeGuardInterval(st, mode);
 
     // Make sure control frames are sent using 1 spatial stream.
     NS_ASSERT(nss == 1);
@@ -29,88 +29,117 @@
 #include <ns3/wifi-remote-station-manager.h>
 
 #include <array>
+#include <vector>
 
 namespace ns3
 {
 
-struct ThompsonSamplingRateStats
+struct AiRateStats;
+
+/// Capacity of the station arena shared with Python
+constexpr uint32_t TS_ARENA_STATIONS = 1024;
+/// Maximum number of entries of the rate table of a station
+constexpr uint32_t TS_MAX_MODES = 64;
+/// Maximum number of pending stations sampled along with the station of a request
+constexpr uint32_t TS_MAX_BATCH = 256;
+
+/**
+ * \brief Mode of an entry of the rate table of a station, written once when the
+ * station is initialized.
+ */
+struct ThompsonSamplingModeInfo
 {
-    uint8_t nss;
-    uint16_t channelWidth;
-    uint16_t guardInterval;
-    uint64_t dataRate;
-    double success;
-    double fails;
-    double lastDecay;
-
-    ThompsonSamplingRateStats()
-        : nss(0),
-          channelWidth(0),
-          guardInterval(0),
-          dataRate(0),
-          success(0),
-          fails(0),
-          lastDecay(0)
-    {
-    }
+    uint64_t dataRate;      //!< data rate of the mode, in b/s
+    uint16_t channelWidth;  //!< channel width, in MHz
+    uint16_t guardInterval; //!< guard interval, in ns
+    uint8_t nss;            //!< number of spatial streams
 };
 
-struct ThompsonSamplingEnvDecay
+/**
+ * \brief Statistics of an entry of the rate table of a station, decayed up to the
+ * time of the last request of the station (messages 0x0a and 0x0b).
+ */
+struct ThompsonSamplingStatsEntry
 {
-    int8_t decayIdx;
-    double decay;
-    double now;
-
-    ThompsonSamplingEnvDecay()
-        : decayIdx(0),
-          decay(0),
-          now(0)
-    {
-    }
+    double success; //!< averaged number of successful frames
+    double fails;   //!< averaged number of failed frames
 };
 
-struct ThompsonSamplingEnvPayloadStruct
+/**
+ * \brief Record of a station in the arena shared with Python.
+ *
+ * The statistics are written by C++ just before each request of the station, and
+ * are not written while the request is in flight, so that Python can read them in
+ * place. Unused entries stay zero.
+ */
+struct ThompsonSamplingStationRecord
 {
-    std::array<ThompsonSamplingRateStats, 64> stats;
-    ThompsonSamplingEnvDecay decay;
-
-    ThompsonSamplingEnvPayloadStruct()
-        : stats(),
-          decay()
-    {
-    }
+    int16_t managerId;                                          //!< manager of the station
+    uint8_t nModes;                                             //!< 0 until initialized
+    std::array<ThompsonSamplingStatsEntry, TS_MAX_MODES> stats; //!< statistics of the modes
+    std::array<ThompsonSamplingModeInfo, TS_MAX_MODES> modes;   //!< rate table
 };
 
+/**
+ * \brief Shared C++ to Python structure: the header of the current message and the
+ * arena of station records.
+ *
+ * Managers and stations get dense IDs in C++, without any round trip, and a station
+ * ID indexes its record at a fixed stride. A message only carries its type and IDs;
+ * Python reads the rate table and the statistics of the station from its record.
+ * An UpdateNextMode request (0x0a) also lists the other stations of the manager that
+ * received feedback since their last decision, whose next modes are sampled in the
+ * same call.
+ */
 struct AiThompsonSamplingEnvStruct
 {
-    int8_t type;
-    int8_t managerId;
-    int8_t stationId;
-    uint64_t var;
-    ThompsonSamplingEnvPayloadStruct data;
+    int8_t type;                             //!< message type
+    int16_t managerId;                       //!< manager of the message
+    int16_t stationId;                       //!< station of the message
+    uint16_t nBatch;                         //!< number of stations in batch
+    std::array<int16_t, TS_MAX_BATCH> batch; //!< other stations to sample (0x0a)
+    std::array<ThompsonSamplingStationRecord, TS_ARENA_STATIONS> stations; //!< station arena
 
     AiThompsonSamplingEnvStruct()
         : type(0),
           managerId(0),
           stationId(0),
-          var(0),
-          data()
+          nBatch(0),
+          batch(),
+          stations()
+    {
+    }
+};
+
+/// Decision table of a station, sampled in C++ (PolicyTable mode)
+struct ThompsonSamplingPolicyTable
+{
+    std::array<float, TS_MAX_MODES> probability; //!< probability of drawing each MCS
+    std::array<float, TS_MAX_MODES> successRate; //!< expected success rate of each MCS
+    double validity;                             //!< lifetime of the table, in seconds
+
+    ThompsonSamplingPolicyTable()
+        : probability(),
+          successRate(),
+          validity(0)
     {
     }
 };
 
 struct AiThompsonSamplingActStruct
 {
-    int8_t managerId;
-    int8_t stationId;
+    int16_t managerId;
+    int16_t stationId;
     uint64_t res;
-    ThompsonSamplingRateStats stats;
+    std::array<uint8_t, TS_MAX_BATCH> batchModes; //!< next modes of the batch stations (0x0a)
+    ThompsonSamplingPolicyTable table;
 
     AiThompsonSamplingActStruct()
         : managerId(0),
           stationId(0),
           res(0),
-          stats()
+          batchModes(),
+          table()
     {
     }
 };
@@ -131,6 +160,11 @@ class AiThompsonSamplingWifiManager : public WifiRemoteStationManager
     AiThompsonSamplingWifiManager();
     ~AiThompsonSamplingWifiManager() override;
 
+    int64_t AssignStreams(int64_t stream) override;
+
+  protected:
+    void DoDispose() override;
+
   private:
     WifiRemoteStation* DoCreateStation() const override;
     void DoReportRxOk(WifiRemoteStation* station, double rxSnr, WifiMode txMode) override;
@@ -175,10 +209,49 @@ class AiThompsonSamplingWifiManager : public WifiRemoteStationManager
      * to tell which mode was used for succeeded/failed frame when
      * feedback is received.
      *
+     * The statistics accumulated in C++ since the last decision are
+     * decayed and sent to Python, which samples the new mode. This is
+     * the only message exchanged per transmitted frame. The other stations
+     * of this manager with pending feedback are sampled in the same message,
+     * so that their next transmission needs no round trip.
+     *
      * \param station Station for which a new mode should be drawn.
      */
     void UpdateNextMode(WifiRemoteStation* station) const;
 
+    /**
+     * Sends the statistics of this station to Python without waiting for the
+     * reply, which is picked up at a later transmission (Prefetch mode). Nothing
+     * is sent if the request of another station is still in flight; this station
+     * is then asked later.
+     *
+     * \param station Station for which a new mode should be drawn.
+     */
+    void Prefetch(WifiRemoteStation* station) const;
+
+    /**
+     * Marks that feedback arrived for this station since its last decision, and
+     * queues it to be sampled with the next request of this manager.
+     *
+     * \param station Station which received feedback.
+     */
+    void SetFeedbackPending(WifiRemoteStation* station) const;
+
+    /**
+     * Asks Python for a new decision table of this station, from which the
+     * next modes are drawn locally until it expires or drifts.
+     *
+     * \param station Station whose table should be replaced.
+     */
+    void UpdatePolicyTable(WifiRemoteStation* station) const;
+
+    /**
+     * Applies exponential decay to MCS statistics, up to the current time.
+     *
+     * \param stats MCS statistics.
+     */
+    void Decay(AiRateStats& stats) const;
+
     /**
      * Returns guard interval in nanoseconds for the given mode.
      *
@@ -190,9 +263,17 @@ class AiThompsonSamplingWifiManager : public WifiRemoteStationManager
 
     double m_decay; //!< Exponential decay coefficient, Hz
 
+    bool m_policyTable;                       //!< Draw the modes from a table pushed by Python
+    bool m_prefetch;                          //!< Request the next mode ahead of time
+    double m_driftThreshold;                  //!< Success rate drift that expires a table
+    uint32_t m_driftMinFrames;                //!< Frames before the drift is checked
+    Ptr<UniformRandomVariable> m_tableRandom; //!< Random stream of the table sampling
+
+    mutable std::vector<int16_t> m_pendingStations; //!< Stations to sample with the next request
+
     TracedValue<uint64_t> m_currentRate; //!< Trace rate changes
 
-    int8_t m_ns3ai_manager_id;
+    int16_t m_ns3ai_manager_id;
 };
 
 } // namespace ns3
@@ -18,8 +18,8 @@
 #         Muyuan Shen <muyuan_shen@hust.edu.cn>
 
 
-import copy
-from typing import List
+import argparse
+from typing import Dict
 import numpy as np
 import ns3ai_ratecontrol_ts_py as py_binding
 from ns3ai_utils import Experiment
@@ -27,44 +27,30 @@ import sys
 import traceback
 
 
-class AiThompsonSamplingStation:
-    _id = -1
-    m_nextMode: int = 0
-    m_lastMode: int = 0
-    m_mcsStats: List[py_binding.ThompsonSamplingRateStats]
+class AiThompsonSamplingStations:
+    """Rate tables of all stations, as [stations, mcs] arrays indexed by the dense
+    station IDs of C++.
 
-    def __init__(self, id=-1) -> None:
-        self._id = id
-        self.m_mcsStats = []
-
-    def Decay(self, decayIdx, decay, now) -> None:
-        if decayIdx >= len(self.m_mcsStats):
-            print('Invalid mscStats[{}] @ {}'.format(decayIdx, self._id))
-            return
-        stats = self.m_mcsStats[decayIdx]
-        if now > stats.lastDecay:
-            coefficient = np.exp(decay * (stats.lastDecay - now))
-            stats.success = coefficient * stats.success
-            stats.fails = coefficient * stats.fails
-            stats.lastDecay = now
-
-    def DoReportDataFailed(self, decay, now) -> None:
-        idx = self.m_lastMode
-        self.Decay(idx, decay, now)
-        self.m_mcsStats[idx].fails = self.m_mcsStats[idx].fails + 1
-
-    def DoReportDataOk(self, decay, now) -> None:
-        idx = self.m_lastMode
-        self.Decay(idx, decay, now)
-        self.m_mcsStats[idx].success = self.m_mcsStats[idx].success + 1
-
-    def DoReportAmpduTxStatus(self, decay, now, successful, failed) -> None:
-        idx = self.m_lastMode
-        self.Decay(idx, decay, now)
-        self.m_mcsStats[idx].fails = self.m_mcsStats[idx].fails + failed
-        self.m_mcsStats[idx].success = self.m_mcsStats[idx].success + successful
+    The success and fails arrays are views of the station arena in shared memory, kept
+    up to date by C++, so they are never copied. Unused entries (beyond the number of
+    modes of a station) have a zero data rate, so that they are never drawn.
+    """
+    MAX_MCS = py_binding.MAX_MODES
 
-    pass
+    def __init__(self, env: py_binding.PyEnvStruct) -> None:
+        capacity = py_binding.ARENA_STATIONS
+        stats = env.get_stats_view()
+        self.m_success = stats[:, :, 0]
+        self.m_fails = stats[:, :, 1]
+        self.m_nMcs = np.zeros(capacity, dtype=np.int64)
+        self.m_rate = np.zeros((capacity, self.MAX_MCS))
+        self.m_nextMode = np.zeros(capacity, dtype=np.int64)
+
+    def Load(self, ids, env: py_binding.PyEnvStruct) -> None:
+        # the rate table is written once by C++, before the first request of the station
+        for station in ids[self.m_nMcs[ids] == 0]:
+            self.m_nMcs[station] = env.get_num_modes(station)
+            self.m_rate[station, :self.m_nMcs[station]] = env.get_data_rates(station)
 
 
 class AiThompsonSamplingManager:
@@ -75,119 +61,95 @@ class AiThompsonSamplingManager:
         self._id = id
         self.m_gammaRandomVariable = np.random.RandomState(seed=stream)
 
-    def SampleBetaVariable(self, alpha, beta):
+    def SampleBetaVariables(self, alpha, beta):
         X = self.m_gammaRandomVariable.gamma(alpha, 1.0)
         Y = self.m_gammaRandomVariable.gamma(beta, 1.0)
         return X / (X + Y)
 
-    def UpdateNextMode(self, station: AiThompsonSamplingStation, decay, now):
-        maxThroughput = 0.0
-        frameSuccessRate = 1.0
-        station.m_nextMode = 0
-        for i in range(len(station.m_mcsStats)):
-            station.Decay(i, decay, now)
-            frameSuccessRate = self.SampleBetaVariable(
-                1.0 + station.m_mcsStats[i].success,
-                1.0 + station.m_mcsStats[i].fails
-            )
-            rate = station.m_mcsStats[i].dataRate
-            if (frameSuccessRate * rate > maxThroughput):
-                maxThroughput = frameSuccessRate * rate
-                station.m_nextMode = i
-        pass
+    def GetPolicyTables(self, stations: AiThompsonSamplingStations, ids, draws=64):
+        # probability of each mode being the best one, estimated over a batch of draws
+        alpha = 1.0 + stations.m_success[ids]
+        beta = 1.0 + stations.m_fails[ids]
+        samples = self.m_gammaRandomVariable.beta(alpha, beta, size=(draws,) + alpha.shape)
+        best = np.argmax(samples * stations.m_rate[ids], axis=-1)
+        probability = np.stack([np.bincount(best[:, k], minlength=stations.MAX_MCS)
+                                for k in range(len(ids))]) / draws
+        return probability, alpha / (alpha + beta)
+
+    def UpdateNextModes(self, stations: AiThompsonSamplingStations, ids):
+        # one Beta draw per station and mode, and the mode of maximum expected throughput
+        frameSuccessRate = self.SampleBetaVariables(1.0 + stations.m_success[ids],
+                                                    1.0 + stations.m_fails[ids])
+        stations.m_nextMode[ids] = np.argmax(frameSuccessRate * stations.m_rate[ids], axis=-1)
 
 
 class AiThompsonSamplingContainer:
-    wifiManager: List[AiThompsonSamplingManager] = []
-    wifiStation: List[AiThompsonSamplingStation] = []
+    wifiManager: Dict[int, AiThompsonSamplingManager]
+    wifiStation: AiThompsonSamplingStations
 
     def __init__(self, msgInterface=None, stream=1) -> None:
         self.msgInterface = msgInterface
         self.default_stream = stream
+        self.wifiManager = {}
+        self.wifiStation = AiThompsonSamplingStations(msgInterface.GetCpp2PyStruct())
         pass
 
-    def do(self, env: py_binding.PyEnvStruct, act: py_binding.PyActStruct):
-        if env.type == 0x01:  # AiThompsonSamplingWifiManager
-            n_manager = len(self.wifiManager)
-            self.wifiManager.append(AiThompsonSamplingManager(id=n_manager, stream=self.default_stream))
-            act.managerId = n_manager
-
-        elif env.type == 0x02:  # DoCreateStation
-            n_station = len(self.wifiStation)
-            # print('{} > {} new sta {}'.format(env.managerId, env.type, n_station))
-            self.wifiStation.append(AiThompsonSamplingStation(id=n_station))
-            act.stationId = n_station
-
-        elif env.type == 0x03:  # InitializeStation
-            sta = self.wifiStation[env.stationId]
-            for i in range(64):
-                if env.data.stats[i].lastDecay < 0:
-                    break
-                sta.m_mcsStats.append(copy.copy(env.data.stats[i]))
-            # print('{} > {} sta {} msc {}'.format(env.managerId, env.type, env.stationId, len(sta.m_mcsStats)))
-            act.stationId = env.stationId  # only for check
+    def GetManager(self, managerId) -> AiThompsonSamplingManager:
+        # managers and stations get their IDs in C++, without any message
+        if managerId not in self.wifiManager:
+            self.wifiManager[managerId] = AiThompsonSamplingManager(id=managerId,
+                                                                    stream=self.default_stream)
+        return self.wifiManager[managerId]
 
-        elif env.type == 0x04:  # Decay
-            # print('{} > {} sta {}/{}'.format(env.managerId, env.type, env.stationId, len(self.wifiStation)))
-            sta = self.wifiStation[env.stationId]
-            sta.Decay(env.data.decay.decayIdx, env.data.decay.decay, env.data.decay.now)
-            act.stationId = env.stationId  # only for check
-
-        elif env.type == 0x05:  # DoReportDataFailed
-            # print('{} > {} sta {} failed'.format(env.managerId, env.type, env.stationId))
-            man = self.wifiManager[env.managerId]
-            sta = self.wifiStation[env.stationId]
-            sta.DoReportDataFailed(env.data.decay.decay, env.data.decay.now)
-            man.UpdateNextMode(sta, env.data.decay.decay, env.data.decay.now)
-            act.stationId = env.stationId  # only for check
-
-        elif env.type == 0x06:  # DoReportDataOk
-            # print('{} > {} sta {} ok'.format(env.managerId, env.type, env.stationId))
-            man = self.wifiManager[env.managerId]
-            sta = self.wifiStation[env.stationId]
-            sta.DoReportDataOk(env.data.decay.decay, env.data.decay.now)
-            man.UpdateNextMode(sta, env.data.decay.decay, env.data.decay.now)
+    def do(self, env: py_binding.PyEnvStruct, act: py_binding.PyActStruct):
+        man = self.GetManager(env.managerId)
+        self.wifiStation.Load(np.array([env.stationId]), env)
+
+        # the feedback (DataFailed, DataOk, AmpduTxStatus) is accumulated by C++ and
+        # only sent when a new mode is needed
+        if env.type == 0x0a:  # UpdateNextMode
+            # print('{} > {} sta {} up'.format(env.managerId, env.type, env.stationId))
+            # the other stations of the manager with pending feedback are sampled in the
+            # same call, their modes are replied in the order of the batch
+            batch = env.get_batch()
+            self.wifiStation.Load(batch, env)
+            ids = np.concatenate(([env.stationId], batch))
+            man.UpdateNextModes(self.wifiStation, ids)
+            act.res = int(self.wifiStation.m_nextMode[env.stationId])
+            act.set_batch_modes(self.wifiStation.m_nextMode[batch].tolist())
             act.stationId = env.stationId  # only for check
 
-        elif env.type == 0x07:  # DoReportAmpduTxStatus
-            man = self.wifiManager[env.managerId]
-            sta = self.wifiStation[env.stationId]
-            successful = env.var >> 32
-            failed = env.var & 0xffffffff
-            # print('{} > {} sta {} ampdu {}/{}'.format(env.managerId, env.type, env.stationId, successful, failed))
-            sta.DoReportAmpduTxStatus(env.data.decay.decay, env.data.decay.now, successful, failed)
-            man.UpdateNextMode(sta, env.data.decay.decay, env.data.decay.now)
+        elif env.type == 0x0b:  # UpdatePolicyTable
+            probability, successRate = man.GetPolicyTables(self.wifiStation, [env.stationId])
+            n = self.wifiStation.m_nMcs[env.stationId]
+            act.table.set(probability[0, :n].tolist(), successRate[0, :n].tolist(),
+                          args.table_validity)
             act.stationId = env.stationId  # only for check
 
-        elif env.type == 0x08:  # DoGetDataTxVector
-            sta = self.wifiStation[env.stationId]
-            act.res = sta.m_nextMode
-            act.stats = sta.m_mcsStats[sta.m_nextMode]
-            sta.m_lastMode = sta.m_nextMode
-            # print('{} > {} sta {} dv {}/{}'.
-            #       format(env.managerId, env.type, env.stationId, act.res, len(sta.m_mcsStats)))
-
-        elif env.type == 0x09:  # DoGetRtsTxVector
-            sta = self.wifiStation[env.stationId]
-            act.res = 0
-            act.stats = sta.m_mcsStats[0]
-
-        elif env.type == 0x0a:  # UpdateNextMode
-            # print('{} > {} sta {} up {}, {}'.
-            #       format(env.managerId, env.type, env.stationId, env.data.decay.decay, env.data.decay.now))
-            man = self.wifiManager[env.managerId]
-            sta = self.wifiStation[env.stationId]
-            man.UpdateNextMode(sta, env.data.decay.decay, env.data.decay.now)
-            act.stationId = env.stationId  # only for check
 
+parser = argparse.ArgumentParser()
+parser.add_argument('--policy_table', action='store_true',
+                    help='push decision tables that ns-3 samples locally')
+parser.add_argument('--table_validity', type=float, default=0.05,
+                    help='lifetime of a decision table (s)')
+parser.add_argument('--prefetch', action='store_true',
+                    help='let ns-3 request the next mode ahead of time, without waiting')
+parser.add_argument('--ns3_setting', action='append', default=[], metavar='KEY=VALUE',
+                    help='extra command line argument of the simulation, e.g. nWifi=50')
+args = parser.parse_args()
 
 ns3Settings = {
     'raa': 'AiThompsonSampling',
     'nWifi': 3,
     'standard': '11ac',
-    'duration': 5}
-
-exp = Experiment("ns3ai_ratecontrol_ts", "../../../../../", py_binding, handleFinish=True)
+    'duration': 5,
+    'policyTable': 'true' if args.policy_table else 'false',
+    'prefetch': 'true' if args.prefetch else 'false'}
+ns3Settings.update(setting.split('=', 1) for setting in args.ns3_setting)
+
+# the station arena is in the shared memory, with some room for its bookkeeping
+exp = Experiment("ns3ai_ratecontrol_ts", "../../../../../", py_binding, handleFinish=True,
+                 shmSize=py_binding.ENV_SIZE + py_binding.ACT_SIZE + 65536)
 msgInterface = exp.run(setting=ns3Settings, show_output=True)
 random_stream = 100
 c = AiThompsonSamplingContainer(msgInterface=msgInterface, stream=random_stream)
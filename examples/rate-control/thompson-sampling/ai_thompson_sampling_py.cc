@@ -21,69 +21,142 @@
 
 #include <ns3/ai-module.h>
 
+#include <pybind11/numpy.h>
 #include <pybind11/pybind11.h>
-#include <pybind11/stl_bind.h>
+#include <pybind11/stl.h>
 
 namespace py = pybind11;
 
-PYBIND11_MAKE_OPAQUE(std::array<ns3::ThompsonSamplingRateStats, 64>);
+/**
+ * \brief Get the record of a station in the arena, exiting on an invalid ID.
+ */
+static const ns3::ThompsonSamplingStationRecord&
+GetRecord(const ns3::AiThompsonSamplingEnvStruct& env, uint32_t station)
+{
+    if (station >= env.stations.size())
+    {
+        std::cerr << "Invalid station " << station << " for the arena, whose size is "
+                  << env.stations.size() << std::endl;
+        exit(1);
+    }
+    return env.stations[station];
+}
 
 PYBIND11_MODULE(ns3ai_ratecontrol_ts_py, m)
 {
-    py::class_<ns3::ThompsonSamplingRateStats>(m, "ThompsonSamplingRateStats")
-        .def(py::init<>())
-        .def_readwrite("nss", &ns3::ThompsonSamplingRateStats::nss)
-        .def_readwrite("channelWidth", &ns3::ThompsonSamplingRateStats::channelWidth)
-        .def_readwrite("guardInterval", &ns3::ThompsonSamplingRateStats::guardInterval)
-        .def_readwrite("dataRate", &ns3::ThompsonSamplingRateStats::dataRate)
-        .def_readwrite("success", &ns3::ThompsonSamplingRateStats::success)
-        .def_readwrite("fails", &ns3::ThompsonSamplingRateStats::fails)
-        .def_readwrite("lastDecay", &ns3::ThompsonSamplingRateStats::lastDecay)
-        .def("__copy__", [](const ns3::ThompsonSamplingRateStats& self) {
-            return ns3::ThompsonSamplingRateStats(self);
-        });
-
-    py::class_<std::array<ns3::ThompsonSamplingRateStats, 64>>(m, "ThompsonSamplingRateStatsArray")
-        .def(py::init<>())
-        .def("size", &std::array<ns3::ThompsonSamplingRateStats, 64>::size)
-        .def("__len__",
-             [](const std::array<ns3::ThompsonSamplingRateStats, 64>& arr) { return arr.size(); })
-        .def("__getitem__",
-             [](const std::array<ns3::ThompsonSamplingRateStats, 64>& arr, uint32_t i) {
-                 if (i >= arr.size())
-                 {
-                     std::cerr << "Invalid index " << i << " for std::array, whose size is "
-                               << arr.size() << std::endl;
-                     exit(1);
-                 }
-                 return arr.at(i);
-             });
-
-    py::class_<ns3::ThompsonSamplingEnvDecay>(m, "ThompsonSamplingEnvDecay")
-        .def(py::init<>())
-        .def_readwrite("decayIdx", &ns3::ThompsonSamplingEnvDecay::decayIdx)
-        .def_readwrite("decay", &ns3::ThompsonSamplingEnvDecay::decay)
-        .def_readwrite("now", &ns3::ThompsonSamplingEnvDecay::now);
-
-    py::class_<ns3::ThompsonSamplingEnvPayloadStruct>(m, "ThompsonSamplingEnvPayloadStruct")
-        .def(py::init<>())
-        .def_readwrite("stats", &ns3::ThompsonSamplingEnvPayloadStruct::stats)
-        .def_readwrite("decay", &ns3::ThompsonSamplingEnvPayloadStruct::decay);
+    m.attr("ARENA_STATIONS") = ns3::TS_ARENA_STATIONS;
+    m.attr("MAX_MODES") = ns3::TS_MAX_MODES;
+    m.attr("MAX_BATCH") = ns3::TS_MAX_BATCH;
+    m.attr("ENV_SIZE") = sizeof(ns3::AiThompsonSamplingEnvStruct);
+    m.attr("ACT_SIZE") = sizeof(ns3::AiThompsonSamplingActStruct);
 
     py::class_<ns3::AiThompsonSamplingEnvStruct>(m, "PyEnvStruct")
         .def(py::init<>())
         .def_readwrite("type", &ns3::AiThompsonSamplingEnvStruct::type)
         .def_readwrite("managerId", &ns3::AiThompsonSamplingEnvStruct::managerId)
         .def_readwrite("stationId", &ns3::AiThompsonSamplingEnvStruct::stationId)
-        .def_readwrite("var", &ns3::AiThompsonSamplingEnvStruct::var)
-        .def_readwrite("data", &ns3::AiThompsonSamplingEnvStruct::data);
+        .def_readwrite("nBatch", &ns3::AiThompsonSamplingEnvStruct::nBatch)
+        .def(
+            "get_batch",
+            [](const ns3::AiThompsonSamplingEnvStruct& env) {
+                if (env.nBatch > env.batch.size())
+                {
+                    std::cerr << "Invalid batch of " << env.nBatch << " stations, whose "
+                              << "capacity is " << env.batch.size() << std::endl;
+                    exit(1);
+                }
+                py::array_t<int64_t> ids(env.nBatch);
+                auto r = ids.mutable_unchecked<1>();
+                for (uint16_t i = 0; i < env.nBatch; i++)
+                {
+                    r(i) = env.batch[i];
+                }
+                return ids;
+            },
+            "Other stations whose next mode is sampled with this request (0x0a), as a "
+            "NumPy array")
+        .def(
+            "get_num_modes",
+            [](const ns3::AiThompsonSamplingEnvStruct& env, uint32_t station) {
+                return GetRecord(env, station).nModes;
+            },
+            "Number of entries of the rate table of a station, 0 until initialized")
+        .def(
+            "get_data_rates",
+            [](const ns3::AiThompsonSamplingEnvStruct& env, uint32_t station) {
+                const ns3::ThompsonSamplingStationRecord& record = GetRecord(env, station);
+                py::array_t<double> rates(record.nModes);
+                auto r = rates.mutable_unchecked<1>();
+                for (uint8_t i = 0; i < record.nModes; i++)
+                {
+                    r(i) = record.modes[i].dataRate;
+                }
+                return rates;
+            },
+            "Data rates of the rate table of a station, as a NumPy array")
+        .def(
+            "get_stats_view",
+            [](py::object self) {
+                static_assert(sizeof(ns3::ThompsonSamplingStatsEntry) == 2 * sizeof(double),
+                              "ThompsonSamplingStatsEntry is not two packed doubles");
+                auto& env = self.cast<ns3::AiThompsonSamplingEnvStruct&>();
+                // a view of the shared memory, kept alive by the env, not a copy
+                return py::array_t<double>(
+                    {static_cast<py::ssize_t>(ns3::TS_ARENA_STATIONS),
+                     static_cast<py::ssize_t>(ns3::TS_MAX_MODES),
+                     static_cast<py::ssize_t>(2)},
+                    {static_cast<py::ssize_t>(sizeof(ns3::ThompsonSamplingStationRecord)),
+                     static_cast<py::ssize_t>(sizeof(ns3::ThompsonSamplingStatsEntry)),
+                     static_cast<py::ssize_t>(sizeof(double))},
+                    reinterpret_cast<double*>(env.stations[0].stats.data()),
+                    self);
+            },
+            "Success and fails of all the stations, as a NumPy view of the arena of shape "
+            "[ARENA_STATIONS, MAX_MODES, 2]");
+
+    py::class_<ns3::ThompsonSamplingPolicyTable>(m, "ThompsonSamplingPolicyTable")
+        .def(py::init<>())
+        .def_readwrite("validity", &ns3::ThompsonSamplingPolicyTable::validity)
+        .def(
+            "set",
+            [](ns3::ThompsonSamplingPolicyTable& table,
+               const std::vector<float>& probability,
+               const std::vector<float>& successRate,
+               double validity) {
+                if (probability.size() > table.probability.size() ||
+                    successRate.size() != probability.size())
+                {
+                    std::cerr << "Invalid policy table of " << probability.size()
+                              << " probabilities and " << successRate.size()
+                              << " success rates" << std::endl;
+                    exit(1);
+                }
+                std::copy(probability.begin(), probability.end(), table.probability.begin());
+                std::copy(successRate.begin(), successRate.end(), table.successRate.begin());
+                table.validity = validity;
+            },
+            "Set the probability and the expected success rate of each MCS, and the "
+            "validity (s)");
 
     py::class_<ns3::AiThompsonSamplingActStruct>(m, "PyActStruct")
         .def(py::init<>())
         .def_readwrite("managerId", &ns3::AiThompsonSamplingActStruct::managerId)
         .def_readwrite("stationId", &ns3::AiThompsonSamplingActStruct::stationId)
         .def_readwrite("res", &ns3::AiThompsonSamplingActStruct::res)
-        .def_readwrite("stats", &ns3::AiThompsonSamplingActStruct::stats);
+        .def(
+            "set_batch_modes",
+            [](ns3::AiThompsonSamplingActStruct& act, const std::vector<uint8_t>& modes) {
+                if (modes.size() > act.batchModes.size())
+                {
+                    std::cerr << "Invalid batch of " << modes.size()
+                              << " modes, whose capacity is " << act.batchModes.size()
+                              << std::endl;
+                    exit(1);
+                }
+                std::copy(modes.begin(), modes.end(), act.batchModes.begin());
+            },
+            "Set the next modes of the stations of get_batch(), in the same order")
+        .def_readwrite("table", &ns3::AiThompsonSamplingActStruct::table);
 
     py::class_<ns3::Ns3AiMsgInterfaceImpl<ns3::AiThompsonSamplingEnvStruct,
                                           ns3::AiThompsonSamplingActStruct>>(
@@ -20,10 +20,24 @@
 #ifndef NS3_RLTCP_AGENT_H
 #define NS3_RLTCP_AGENT_H
 
+#include "replay-storage.h"
+#include "sum-tree.h"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
 #include <cmath>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <mutex>
 #include <random>
+#include <string>
+#include <thread>
 #include <torch/torch.h>
 #include <tuple>
+#include <unordered_map>
 #include <vector>
 
 #define REPLAY_LENGTH 2000
@@ -31,16 +45,19 @@
 #define OBS_SHAPE 5
 #define ACTION_NUM 4
 #define LEARNING_RATE 0.0001
+#define TRANSITION_QUEUE_LENGTH 4096 // power of two
+#define SNAPSHOT_INTERVAL 10         // optimization steps between policy snapshots
+#define REPLAY_FILE_VERSION 1
 
 class NetImpl : public torch::nn::Module
 {
   public:
-    NetImpl(int in, int out)
+    NetImpl(int in, int out, int hidden = 20)
         : in_features(in),
           out_features(out),
-          layers(torch::nn::Linear(in_features, 20),
-                 torch::nn::Linear(20, 20),
-                 torch::nn::Linear(20, out_features))
+          layers(torch::nn::Linear(in_features, hidden),
+                 torch::nn::Linear(hidden, hidden),
+                 torch::nn::Linear(hidden, out_features))
     {
         register_module("layers", layers);
     }
@@ -57,6 +74,43 @@ class NetImpl : public torch::nn::Module
 
 TORCH_MODULE(Net);
 
+/**
+ * \brief Copy the parameters and buffers of a network into another network of the
+ * same architecture, in memory.
+ */
+inline void
+CopyNetParameters(const Net& from, Net& to)
+{
+    torch::NoGradGuard no_grad;
+    auto src = from->parameters();
+    auto dst = to->parameters();
+    for (size_t i = 0; i < src.size(); ++i)
+    {
+        dst[i].copy_(src[i]);
+    }
+    auto srcBuffers = from->buffers();
+    auto dstBuffers = to->buffers();
+    for (size_t i = 0; i < srcBuffers.size(); ++i)
+    {
+        dstBuffers[i].copy_(srcBuffers[i]);
+    }
+}
+
+/**
+ * \brief Soft (Polyak) update: to = tau * from + (1 - tau) * to.
+ */
+inline void
+PolyakUpdate(const Net& from, Net& to, double tau)
+{
+    torch::NoGradGuard no_grad;
+    auto src = from->parameters();
+    auto dst = to->parameters();
+    for (size_t i = 0; i < src.size(); ++i)
+    {
+        dst[i].lerp_(src[i], tau);
+    }
+}
+
 struct Transition
 {
     std::array<float, OBS_SHAPE> state;
@@ -65,72 +119,399 @@ struct Transition
     int64_t reward;
 };
 
+/**
+ * \brief Lock-free single-producer single-consumer queue of transitions.
+ *
+ * The simulation thread pushes and the learner thread pops. When the queue is
+ * full, Push() fails instead of blocking the simulation.
+ */
+class TransitionQueue
+{
+  public:
+    bool Push(const Transition& trans)
+    {
+        size_t tail = write_index.load(std::memory_order_relaxed);
+        if (tail - read_index.load(std::memory_order_acquire) == TRANSITION_QUEUE_LENGTH)
+        {
+            return false;
+        }
+        buffer[tail & (TRANSITION_QUEUE_LENGTH - 1)] = trans;
+        write_index.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool Pop(Transition& trans)
+    {
+        size_t head = read_index.load(std::memory_order_relaxed);
+        if (head == write_index.load(std::memory_order_acquire))
+        {
+            return false;
+        }
+        trans = buffer[head & (TRANSITION_QUEUE_LENGTH - 1)];
+        read_index.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+  private:
+    std::array<Transition, TRANSITION_QUEUE_LENGTH> buffer;
+    // on separate cache lines, as they are written by different threads
+    alignas(64) std::atomic<size_t> write_index{0};
+    alignas(64) std::atomic<size_t> read_index{0};
+};
+
+/**
+ * \brief Header of a replay memory file.
+ *
+ * The file is the in-memory layout of ReplayMemory: the header, then the columns
+ * states (float[capacity][OBS_SHAPE]), actions (int64[capacity]), next states
+ * (float[capacity][OBS_SHAPE]) and rewards (int64[capacity]), each starting at a
+ * multiple of 64 bytes. With prioritized replay, the sum tree leaves
+ * (double[capacity]) follow. Values are in host byte order.
+ */
+struct ReplayFileHeader
+{
+    char magic[8];         // "NS3AIRPL"
+    uint32_t version;      // REPLAY_FILE_VERSION
+    uint32_t obs_shape;    // OBS_SHAPE
+    uint32_t capacity;     // transitions
+    uint32_t head;         // next slot to write
+    uint32_t size;         // number of stored transitions
+    uint32_t prioritized;  // whether the sum tree leaves follow the columns
+    double max_priority;   // max TD error seen
+    double priority_alpha; // exponent of the stored leaves
+};
+
+/// Sampled (states, actions, next states, rewards, importance-sampling weights)
+using ReplayBatch =
+    std::tuple<torch::Tensor, torch::Tensor, torch::Tensor, torch::Tensor, torch::Tensor>;
+
+/**
+ * \brief Fixed-capacity circular replay buffer.
+ *
+ * Transitions are stored column by column (structure of arrays), so adding a
+ * transition is O(1) and a sampled batch is gathered into contiguous buffers
+ * that torch::from_blob wraps without copying.
+ *
+ * The columns live in one buffer laid out as a replay file (see
+ * ReplayFileHeader), so Save() writes the buffer as is and Load() maps the file
+ * with mmap instead of reading it.
+ *
+ * With prioritized replay, transitions are sampled with probability
+ * p_i^alpha / sum_k p_k^alpha through a sum tree, where p_i is the last TD error
+ * of the transition (new transitions get the max priority seen so far). The
+ * importance-sampling weights (N * P(i))^-beta are normalized by the max weight
+ * of the batch.
+ */
 class ReplayMemory
 {
   public:
-    ReplayMemory()
-        : capacity(REPLAY_LENGTH),
-          rng(std::random_device()())
+    explicit ReplayMemory(uint32_t capacity = REPLAY_LENGTH)
+        : rng(std::random_device()())
+    {
+        SetCapacity(capacity);
+    }
+
+    /**
+     * \brief Set the capacity. Stored transitions are dropped.
+     */
+    void SetCapacity(uint32_t cap)
     {
+        capacity = cap;
+        head = 0;
+        size = 0;
+        storage.Allocate(ColumnsEnd(capacity));
+        SetColumns();
+        priorities.Resize(prioritized ? capacity : 0);
+        max_priority = 1.0;
     }
 
-    void Add(Transition& experience)
+    /**
+     * \brief Write the stored transitions (and priorities) to a replay file.
+     * \return false on failure.
+     */
+    bool Save(const std::string& filename)
     {
-        if (memory.size() >= capacity)
+        auto header = reinterpret_cast<ReplayFileHeader*>(storage.Data());
+        std::memcpy(header->magic, "NS3AIRPL", sizeof(header->magic));
+        header->version = REPLAY_FILE_VERSION;
+        header->obs_shape = OBS_SHAPE;
+        header->capacity = capacity;
+        header->head = head;
+        header->size = size;
+        header->prioritized = prioritized;
+        header->max_priority = max_priority;
+        header->priority_alpha = priority_alpha;
+
+        std::ofstream ofs(filename, std::ios::binary | std::ios::trunc);
+        ofs.write(reinterpret_cast<const char*>(storage.Data()), ColumnsEnd(capacity));
+        if (prioritized)
         {
-            memory.erase(memory.begin());
+            std::vector<double> leaves(capacity);
+            for (uint32_t i = 0; i < capacity; ++i)
+            {
+                leaves[i] = priorities.Get(i);
+            }
+            ofs.write(reinterpret_cast<const char*>(leaves.data()), capacity * sizeof(double));
         }
-        memory.push_back(experience);
+        return ofs.good();
     }
 
-    void Sample(std::tuple<torch::Tensor, torch::Tensor, torch::Tensor, torch::Tensor>& sample)
+    /**
+     * \brief Replace the stored transitions by those of a replay file, mapped with mmap.
+     *
+     * The capacity becomes that of the file. Without priorities in the file,
+     * prioritized replay starts with the same priority for all transitions.
+     *
+     * \return false if the file cannot be mapped or is not a replay file of this agent.
+     */
+    bool Load(const std::string& filename)
     {
-        // these should be static because torch::from_blob does not take ownership
-        static std::array<float, OBS_SHAPE * BATCH_SIZE> states;
-        static std::array<int64_t, BATCH_SIZE> actions;
-        static std::array<float, OBS_SHAPE * BATCH_SIZE> next_states;
-        static std::array<int64_t, BATCH_SIZE> rewards;
+        ReplayStorage file;
+        if (!file.Map(filename) || file.Size() < sizeof(ReplayFileHeader))
+        {
+            return false;
+        }
+        auto header = reinterpret_cast<const ReplayFileHeader*>(file.Data());
+        size_t end = ColumnsEnd(header->capacity);
+        if (std::memcmp(header->magic, "NS3AIRPL", sizeof(header->magic)) != 0 ||
+            header->version != REPLAY_FILE_VERSION || header->obs_shape != OBS_SHAPE ||
+            header->capacity == 0 || header->head >= header->capacity ||
+            header->size > header->capacity ||
+            file.Size() < end + (header->prioritized ? header->capacity * sizeof(double) : 0))
+        {
+            return false;
+        }
 
-        // get sampled batch
-        std::uniform_int_distribution<> randomIndex(0, memory.size() - 1);
-        for (uint32_t i = 0; i < BATCH_SIZE; ++i)
+        capacity = header->capacity;
+        head = header->head;
+        size = header->size;
+        max_priority = header->max_priority;
+        if (prioritized)
         {
-            uint32_t index = randomIndex(rng);
-            actions[i] = memory[index].action;
-            rewards[i] = memory[index].reward;
-            uint32_t state_base = OBS_SHAPE * i;
-            for (uint32_t j = 0; j < OBS_SHAPE; ++j)
+            std::vector<double> leaves(size, std::pow(max_priority, priority_alpha));
+            if (header->prioritized)
             {
-                states[state_base + j] = memory[index].state[j];
-                next_states[state_base + j] = memory[index].next_state[j];
+                auto stored = reinterpret_cast<const double*>(file.Data() + end);
+                double exponent = priority_alpha / header->priority_alpha;
+                for (uint32_t i = 0; i < size; ++i)
+                {
+                    leaves[i] = exponent == 1 ? stored[i] : std::pow(stored[i], exponent);
+                }
             }
+            priorities.Resize(capacity);
+            // transitions occupy the slots [0, size), see Add()
+            priorities.Build(leaves.data(), size);
+        }
+        storage.Swap(file);
+        SetColumns();
+        return true;
+    }
+
+    /**
+     * \brief Enable or disable prioritized replay. Stored transitions are dropped.
+     * \param alpha How much prioritization is used, 0 is uniform.
+     * \param beta Importance-sampling correction, 1 is full correction.
+     */
+    void SetPrioritized(bool enable, double alpha = 0.6, double beta = 0.4)
+    {
+        prioritized = enable;
+        priority_alpha = alpha;
+        priority_beta = beta;
+        SetCapacity(capacity);
+    }
+
+    bool IsPrioritized() const
+    {
+        return prioritized;
+    }
+
+    void Add(const Transition& experience)
+    {
+        size_t base = (size_t)head * OBS_SHAPE;
+        std::copy(experience.state.begin(), experience.state.end(), states + base);
+        std::copy(experience.next_state.begin(), experience.next_state.end(), next_states + base);
+        actions[head] = experience.action;
+        rewards[head] = experience.reward;
+        if (prioritized)
+        {
+            priorities.Update(head, std::pow(max_priority, priority_alpha));
+        }
+
+        // overwrite the oldest transition once full
+        head = (head + 1) % capacity;
+        if (size < capacity)
+        {
+            size++;
+        }
+    }
+
+    /**
+     * \brief Sample a batch of (states, actions, next states, rewards, IS weights).
+     */
+    void Sample(ReplayBatch& sample)
+    {
+        // get sampled batch; the buffers are members because torch::from_blob does not take
+        // ownership
+        if (prioritized)
+        {
+            SamplePrioritizedIndices();
+        }
+        else
+        {
+            std::uniform_int_distribution<uint32_t> randomIndex(0, size - 1);
+            for (uint32_t i = 0; i < BATCH_SIZE; ++i)
+            {
+                batch_indices[i] = randomIndex(rng);
+            }
+            batch_weights.fill(1);
+        }
+        for (uint32_t i = 0; i < BATCH_SIZE; ++i)
+        {
+            uint32_t index = batch_indices[i];
+            batch_actions[i] = actions[index];
+            batch_rewards[i] = rewards[index];
+            size_t src = (size_t)index * OBS_SHAPE;
+            std::copy_n(states + src, OBS_SHAPE, batch_states.begin() + OBS_SHAPE * i);
+            std::copy_n(next_states + src, OBS_SHAPE, batch_next_states.begin() + OBS_SHAPE * i);
         }
 
         // save samples to tuple
-        std::get<0>(sample) = torch::from_blob(states.data(), {BATCH_SIZE, OBS_SHAPE}, at::kFloat);
-        std::get<1>(sample) = torch::from_blob(actions.data(), {BATCH_SIZE, 1}, at::kLong);
+        std::get<0>(sample) =
+            torch::from_blob(batch_states.data(), {BATCH_SIZE, OBS_SHAPE}, at::kFloat);
+        std::get<1>(sample) = torch::from_blob(batch_actions.data(), {BATCH_SIZE, 1}, at::kLong);
         std::get<2>(sample) =
-            torch::from_blob(next_states.data(), {BATCH_SIZE, OBS_SHAPE}, at::kFloat);
-        std::get<3>(sample) = torch::from_blob(rewards.data(), {BATCH_SIZE, 1}, at::kLong);
+            torch::from_blob(batch_next_states.data(), {BATCH_SIZE, OBS_SHAPE}, at::kFloat);
+        std::get<3>(sample) = torch::from_blob(batch_rewards.data(), {BATCH_SIZE, 1}, at::kLong);
+        std::get<4>(sample) = torch::from_blob(batch_weights.data(), {BATCH_SIZE, 1}, at::kFloat);
     }
 
-    const uint32_t capacity;
+    /**
+     * \brief Update the priorities of the last sampled batch.
+     * \param td_errors TD errors of the batch, BATCH_SIZE values.
+     */
+    void UpdatePriorities(const float* td_errors)
+    {
+        if (!prioritized)
+        {
+            return;
+        }
+        for (uint32_t i = 0; i < BATCH_SIZE; ++i)
+        {
+            double priority = std::abs(td_errors[i]) + PRIORITY_EPS;
+            max_priority = std::max(max_priority, priority);
+            priorities.Update(batch_indices[i], std::pow(priority, priority_alpha));
+        }
+    }
+
+    uint32_t GetSize() const
+    {
+        return size;
+    }
+
+    uint32_t capacity;
 
   private:
-    std::vector<Transition> memory;
+    static size_t Align64(size_t bytes)
+    {
+        return (bytes + 63) & ~(size_t)63;
+    }
+
+    // offsets of the columns in the storage, the header being at 0
+    static size_t StatesOffset()
+    {
+        return Align64(sizeof(ReplayFileHeader));
+    }
+
+    static size_t ActionsOffset(uint32_t cap)
+    {
+        return StatesOffset() + Align64((size_t)cap * OBS_SHAPE * sizeof(float));
+    }
+
+    static size_t NextStatesOffset(uint32_t cap)
+    {
+        return ActionsOffset(cap) + Align64((size_t)cap * sizeof(int64_t));
+    }
+
+    static size_t RewardsOffset(uint32_t cap)
+    {
+        return NextStatesOffset(cap) + Align64((size_t)cap * OBS_SHAPE * sizeof(float));
+    }
+
+    static size_t ColumnsEnd(uint32_t cap)
+    {
+        return RewardsOffset(cap) + Align64((size_t)cap * sizeof(int64_t));
+    }
+
+    void SetColumns()
+    {
+        uint8_t* base = storage.Data();
+        states = reinterpret_cast<float*>(base + StatesOffset());
+        actions = reinterpret_cast<int64_t*>(base + ActionsOffset(capacity));
+        next_states = reinterpret_cast<float*>(base + NextStatesOffset(capacity));
+        rewards = reinterpret_cast<int64_t*>(base + RewardsOffset(capacity));
+    }
+
+    // stratified sampling: one index from each of BATCH_SIZE equal ranges of the total priority
+    void SamplePrioritizedIndices()
+    {
+        std::uniform_real_distribution<double> uniform(0.0, 1.0);
+        double total = priorities.Total();
+        double segment = total / BATCH_SIZE;
+        double max_weight = 0;
+        for (uint32_t i = 0; i < BATCH_SIZE; ++i)
+        {
+            uint32_t index = priorities.Find((i + uniform(rng)) * segment);
+            double prob = priorities.Get(index) / total;
+            batch_indices[i] = index;
+            batch_weights[i] = std::pow(size * prob, -priority_beta);
+            max_weight = std::max(max_weight, (double)batch_weights[i]);
+        }
+        for (uint32_t i = 0; i < BATCH_SIZE; ++i)
+        {
+            batch_weights[i] /= max_weight;
+        }
+    }
+
+    static constexpr double PRIORITY_EPS = 1e-6; // keeps zero-error transitions samplable
+
+    uint32_t head; // next slot to write
+    uint32_t size; // number of stored transitions
+
+    bool prioritized{false};
+    double priority_alpha{0.6};
+    double priority_beta{0.4};
+    double max_priority{1.0};
+    SumTree priorities;
+
+    // columns in storage, OBS_SHAPE values per transition for states
+    ReplayStorage storage;
+    float* states;
+    int64_t* actions;
+    float* next_states;
+    int64_t* rewards;
+
+    // sampled batch
+    std::array<float, OBS_SHAPE * BATCH_SIZE> batch_states;
+    std::array<int64_t, BATCH_SIZE> batch_actions;
+    std::array<float, OBS_SHAPE * BATCH_SIZE> batch_next_states;
+    std::array<int64_t, BATCH_SIZE> batch_rewards;
+    std::array<float, BATCH_SIZE> batch_weights;
+    std::array<uint32_t, BATCH_SIZE> batch_indices;
+
     std::default_random_engine rng;
 };
 
 class DQN
 {
   public:
-    DQN()
+    explicit DQN(uint32_t replayCapacity = REPLAY_LENGTH)
         : memory_counter(0),
           policy_net(OBS_SHAPE, ACTION_NUM),
           target_net(OBS_SHAPE, ACTION_NUM),
           step(0),
           target_update_interval(100),
-          memory(),
+          target_update_tau(0),
+          memory(replayCapacity),
           rng(std::random_device()()),
           dist(0.0, 1.0),
           optim(policy_net->parameters(), torch::optim::AdamOptions(LEARNING_RATE)),
@@ -140,12 +521,21 @@ class DQN
 
     uint32_t ChooseAction(std::array<float, OBS_SHAPE> obs)
     {
+        return ChooseAction(obs, policy_net);
+    }
+
+    /**
+     * \brief Choose an action with the given network, e.g., a policy snapshot.
+     */
+    uint32_t ChooseAction(std::array<float, OBS_SHAPE> obs, Net& net)
+    {
+        torch::NoGradGuard no_grad;
         torch::Tensor x = torch::from_blob(obs.data(), {OBS_SHAPE});
         torch::Tensor q_value;
         uint32_t action;
-        if (dist(rng) > pow(0.99, memory.capacity))
+        if (dist(rng) > pow(0.99, REPLAY_LENGTH))
         {
-            q_value = policy_net->forward(x);
+            q_value = net->forward(x);
             action = torch::argmax(q_value, 0).item().toInt();
         }
         else
@@ -155,7 +545,172 @@ class DQN
         return action;
     }
 
-    void SaveTransition(Transition& trans)
+    /**
+     * \brief Choose the actions of a batch of observations with one forward pass.
+     * \param obs n observations of OBS_SHAPE values, row by row.
+     * \param n Number of observations.
+     * \param net Network used for inference, e.g., the policy network or a snapshot.
+     * \param actions Output, n actions.
+     */
+    void ChooseActions(float* obs, uint32_t n, Net& net, uint32_t* actions)
+    {
+        torch::NoGradGuard no_grad;
+        bool anyGreedy = false;
+        for (uint32_t i = 0; i < n; ++i)
+        {
+            if (dist(rng) > pow(0.99, REPLAY_LENGTH))
+            {
+                actions[i] = ACTION_NUM; // greedy, filled below
+                anyGreedy = true;
+            }
+            else
+            {
+                actions[i] = std::floor(dist(rng) * ACTION_NUM);
+            }
+        }
+        if (!anyGreedy)
+        {
+            return;
+        }
+        torch::Tensor x = torch::from_blob(obs, {n, OBS_SHAPE});
+        torch::Tensor greedy = torch::argmax(net->forward(x), 1).contiguous();
+        auto greedyActions = greedy.accessor<int64_t, 1>();
+        for (uint32_t i = 0; i < n; ++i)
+        {
+            if (actions[i] == ACTION_NUM)
+            {
+                actions[i] = greedyActions[i];
+            }
+        }
+    }
+
+    void ChooseActions(float* obs, uint32_t n, uint32_t* actions)
+    {
+        ChooseActions(obs, n, policy_net, actions);
+    }
+
+    void SetReplayCapacity(uint32_t capacity)
+    {
+        memory.SetCapacity(capacity);
+    }
+
+    /**
+     * \brief Set the target network update: a soft update with this tau at every step,
+     * or a copy every target_update_interval steps if tau is 0.
+     */
+    void SetTargetUpdateTau(double tau)
+    {
+        target_update_tau = tau;
+    }
+
+    double GetTargetUpdateTau() const
+    {
+        return target_update_tau;
+    }
+
+    uint32_t GetReplayCapacity() const
+    {
+        return memory.capacity;
+    }
+
+    void SetPrioritizedReplay(bool enable)
+    {
+        memory.SetPrioritized(enable);
+    }
+
+    bool IsPrioritizedReplay() const
+    {
+        return memory.IsPrioritized();
+    }
+
+    /**
+     * \brief Copy the policy network into a new network, without serialization.
+     */
+    std::shared_ptr<Net> SnapshotPolicy()
+    {
+        auto snapshot = std::make_shared<Net>(OBS_SHAPE, ACTION_NUM);
+        CopyNetParameters(policy_net, *snapshot);
+        return snapshot;
+    }
+
+    /**
+     * \brief Save the policy and target networks, the optimizer state and the step count.
+     * \return false on failure.
+     */
+    bool SaveCheckpoint(const std::string& filename)
+    {
+        try
+        {
+            torch::serialize::OutputArchive archive;
+            torch::serialize::OutputArchive policy;
+            torch::serialize::OutputArchive target;
+            torch::serialize::OutputArchive optimizer;
+            policy_net->save(policy);
+            target_net->save(target);
+            optim.save(optimizer);
+            archive.write("policy", policy);
+            archive.write("target", target);
+            archive.write("optimizer", optimizer);
+            archive.write("step", torch::tensor((int64_t)step));
+            archive.save_to(filename);
+        }
+        catch (const std::exception&)
+        {
+            return false;
+        }
+        return true;
+    }
+
+    /**
+     * \brief Restore a checkpoint written by SaveCheckpoint().
+     * \return false on failure.
+     */
+    bool LoadCheckpoint(const std::string& filename)
+    {
+        try
+        {
+            torch::serialize::InputArchive archive;
+            torch::serialize::InputArchive policy;
+            torch::serialize::InputArchive target;
+            torch::serialize::InputArchive optimizer;
+            archive.load_from(filename);
+            archive.read("policy", policy);
+            archive.read("target", target);
+            archive.read("optimizer", optimizer);
+            // parameters are loaded in place, so the optimizer still refers to them
+            policy_net->load(policy);
+            target_net->load(target);
+            optim.load(optimizer);
+            torch::Tensor savedStep;
+            archive.read("step", savedStep);
+            step = savedStep.item<int64_t>();
+        }
+        catch (const std::exception&)
+        {
+            return false;
+        }
+        return true;
+    }
+
+    bool SaveReplay(const std::string& filename)
+    {
+        return memory.Save(filename);
+    }
+
+    /**
+     * \brief Load a replay file; the agent is warmed up if it holds enough transitions.
+     */
+    bool LoadReplay(const std::string& filename)
+    {
+        if (!memory.Load(filename))
+        {
+            return false;
+        }
+        memory_counter = std::max(memory_counter, memory.GetSize());
+        return true;
+    }
+
+    void SaveTransition(const Transition& trans)
     {
         memory.Add(trans);
         memory_counter += 1;
@@ -163,13 +718,14 @@ class DQN
 
     void OptimizeModel()
     {
-        static std::tuple<torch::Tensor, torch::Tensor, torch::Tensor, torch::Tensor> sample;
         step += 1;
-        if (step % target_update_interval == 0)
+        if (target_update_tau > 0)
         {
-            std::stringstream stream;
-            torch::save(policy_net, stream);
-            torch::load(target_net, stream);
+            PolyakUpdate(policy_net, target_net, target_update_tau);
+        }
+        else if (step % target_update_interval == 0)
+        {
+            CopyNetParameters(policy_net, target_net);
         }
 
         memory.Sample(sample);
@@ -177,14 +733,30 @@ class DQN
         auto& a = std::get<1>(sample);
         auto& s_ = std::get<2>(sample);
         auto& r = std::get<3>(sample);
+        auto& w = std::get<4>(sample);
         auto q_eval = policy_net->forward(s).gather(1, a);
         auto q_next = target_net->forward(s_).detach();
         auto q_target = r + 0.8 * std::get<0>(q_next.max(1, true));
 
-        auto loss = loss_model(q_eval, q_target);
+        torch::Tensor loss;
+        if (memory.IsPrioritized())
+        {
+            // importance-sampling weighted MSE
+            loss = (w * (q_eval - q_target).pow(2)).mean();
+        }
+        else
+        {
+            loss = loss_model(q_eval, q_target);
+        }
         optim.zero_grad();
         loss.backward();
         optim.step();
+
+        if (memory.IsPrioritized())
+        {
+            auto td_errors = (q_target - q_eval).detach().to(at::kFloat).contiguous();
+            memory.UpdatePriorities(td_errors.data_ptr<float>());
+        }
     }
 
     uint32_t memory_counter;
@@ -194,19 +766,145 @@ class DQN
     Net target_net;
     uint32_t step;
     uint32_t target_update_interval;
+    double target_update_tau;
     ReplayMemory memory;
     std::default_random_engine rng;
     std::uniform_real_distribution<double> dist;
     torch::optim::Adam optim;
     torch::nn::MSELoss loss_model;
+    ReplayBatch sample;
 };
 
+/// Observation of one flow
+struct TcpObservation
+{
+    uint32_t flowId;
+    float ssThresh;
+    float cWnd;
+    float segmentsAcked;
+    float segmentSize;
+    float bytesInFlight;
+};
+
+/// (new_cWnd, new_ssThresh)
+typedef std::tuple<uint32_t, uint32_t> TcpAction;
+
 class TcpDeepQAgent
 {
   public:
-    TcpDeepQAgent()
-        : dqn()
+    explicit TcpDeepQAgent(uint32_t replayCapacity = REPLAY_LENGTH)
+        : dqn(replayCapacity)
+    {
+    }
+
+    ~TcpDeepQAgent()
+    {
+        StopLearner();
+    }
+
+    TcpDeepQAgent(const TcpDeepQAgent&) = delete;
+    TcpDeepQAgent& operator=(const TcpDeepQAgent&) = delete;
+
+    /**
+     * \brief Train in a background learner thread instead of in GetAction().
+     *
+     * GetAction() then only runs inference with the latest policy snapshot
+     * published by the learner, and pushes transitions to a lock-free queue. The
+     * learner trains continuously once warmed up, so results are no longer
+     * reproducible. Must be called before the first GetAction().
+     */
+    void SetAsyncLearning(bool enable)
+    {
+        async_learning = enable;
+    }
+
+    bool IsAsyncLearning() const
+    {
+        return async_learning;
+    }
+
+    /**
+     * \brief Number of transitions dropped because the learner could not keep up.
+     */
+    uint64_t GetDroppedTransitions() const
+    {
+        return dropped_transitions;
+    }
+
+    /**
+     * \brief Set the replay memory capacity. Must be called before the first transition.
+     */
+    void SetReplayCapacity(uint32_t capacity)
+    {
+        dqn.SetReplayCapacity(capacity);
+    }
+
+    uint32_t GetReplayCapacity() const
+    {
+        return dqn.GetReplayCapacity();
+    }
+
+    /**
+     * \brief Use a soft target network update with this tau (0: periodic copy).
+     */
+    void SetTargetUpdateTau(double tau)
+    {
+        dqn.SetTargetUpdateTau(tau);
+    }
+
+    double GetTargetUpdateTau() const
+    {
+        return dqn.GetTargetUpdateTau();
+    }
+
+    /**
+     * \brief Enable prioritized replay. Must be called before the first transition.
+     */
+    void SetPrioritizedReplay(bool enable)
+    {
+        dqn.SetPrioritizedReplay(enable);
+    }
+
+    bool IsPrioritizedReplay() const
+    {
+        return dqn.IsPrioritizedReplay();
+    }
+
+    /**
+     * \brief Save the networks and the optimizer state. The learner thread, if any, is
+     * stopped first and restarted by the next GetActions().
+     */
+    bool SaveCheckpoint(const std::string& filename)
+    {
+        StopLearner();
+        return dqn.SaveCheckpoint(filename);
+    }
+
+    /**
+     * \brief Restore the networks and the optimizer state. Must be called before the
+     * first GetAction().
+     */
+    bool LoadCheckpoint(const std::string& filename)
     {
+        return dqn.LoadCheckpoint(filename);
+    }
+
+    /**
+     * \brief Save the replay memory. The learner thread, if any, is stopped first.
+     */
+    bool SaveReplay(const std::string& filename)
+    {
+        StopLearner();
+        return dqn.SaveReplay(filename);
+    }
+
+    /**
+     * \brief Load the replay memory from a file written by SaveReplay(). Must be called
+     * after SetPrioritizedReplay() and before the first GetAction().
+     */
+    bool LoadReplay(const std::string& filename)
+    {
+        return dqn.LoadReplay(filename);
     }
 
     std::tuple<uint32_t, uint32_t> GetAction(float ssThresh,
@@ -215,26 +913,163 @@ class TcpDeepQAgent
                                              float segmentSize,
                                              float bytesInFlight)
     {
-        trans.state = trans.next_state;
-        trans.next_state = {ssThresh, cWnd, segmentsAcked, segmentSize, bytesInFlight};
+        single_obs[0] = {0, ssThresh, cWnd, segmentsAcked, segmentSize, bytesInFlight};
+        GetActions(single_obs, single_action);
+        return single_action[0];
+    }
+
+    /**
+     * \brief Get the actions of several flows with one batched forward pass.
+     *
+     * Each flow keeps its own transition, identified by flowId. The model is
+     * optimized once per call.
+     *
+     * \param obs Observations of the flows.
+     * \param actions Output, (new_cWnd, new_ssThresh) of each flow.
+     */
+    void GetActions(const std::vector<TcpObservation>& obs, std::vector<TcpAction>& actions)
+    {
+        uint32_t n = obs.size();
+        if (async_learning && !learner.joinable())
+        {
+            policy_snapshot = dqn.SnapshotPolicy();
+            actor_snapshot = policy_snapshot;
+            learner = std::thread(&TcpDeepQAgent::RunLearner, this);
+        }
+
+        batch_flows.resize(n);
+        batch_states.resize((size_t)n * OBS_SHAPE);
+        batch_actions.resize(n);
+        actions.resize(n);
+        for (uint32_t i = 0; i < n; ++i)
+        {
+            const TcpObservation& o = obs[i];
+            batch_flows[i] = &flows[o.flowId];
+            Transition& trans = batch_flows[i]->trans;
+            trans.state = trans.next_state;
+            trans.next_state = {o.ssThresh,
+                                o.cWnd,
+                                o.segmentsAcked,
+                                o.segmentSize,
+                                o.bytesInFlight};
+
+            if (trans.state[3] != 0) // not the first time calling GetAction
+            {
+                trans.reward = o.segmentsAcked - o.bytesInFlight - o.cWnd;
+                if (!async_learning)
+                {
+                    dqn.SaveTransition(trans);
+                }
+                else if (!transition_queue.Push(trans))
+                {
+                    dropped_transitions++;
+                }
+            }
+            std::copy(trans.next_state.begin(),
+                      trans.next_state.end(),
+                      batch_states.begin() + (size_t)OBS_SHAPE * i);
+        }
 
         // update model
-        if (trans.state[3] != 0) // not the first time calling GetAction
+        if (!async_learning && IsWarmedUp())
         {
-            trans.reward = segmentsAcked - bytesInFlight - cWnd;
-            dqn.SaveTransition(trans);
-            if (dqn.memory_counter > REPLAY_LENGTH)
+            dqn.OptimizeModel();
+        }
+
+        // choose actions
+        if (async_learning)
+        {
+            // pick up the latest snapshot; the lock is only taken when a new one was published
+            uint64_t version = snapshot_version.load(std::memory_order_acquire);
+            if (version != actor_snapshot_version)
+            {
+                std::lock_guard<std::mutex> lock(snapshot_mutex);
+                actor_snapshot = policy_snapshot;
+                actor_snapshot_version = version;
+            }
+            dqn.ChooseActions(batch_states.data(), n, *actor_snapshot, batch_actions.data());
+        }
+        else
+        {
+            dqn.ChooseActions(batch_states.data(), n, batch_actions.data());
+        }
+        for (uint32_t i = 0; i < n; ++i)
+        {
+            batch_flows[i]->trans.action = batch_actions[i];
+            actions[i] = ApplyAction(*batch_flows[i], obs[i]);
+        }
+    }
+
+  private:
+    /// State of one flow
+    struct FlowState
+    {
+        Transition trans = {{0, 0, 0, 0, 0}, 0, {0, 0, 0, 0, 0}, 0};
+        TcpAction action_tup = {0, 0};
+    };
+
+    bool IsWarmedUp() const
+    {
+        return dqn.memory_counter > std::min<uint32_t>(REPLAY_LENGTH, dqn.GetReplayCapacity());
+    }
+
+    /// Stop the learner thread and move the transitions left in the queue to the replay memory
+    void StopLearner()
+    {
+        if (!learner.joinable())
+        {
+            return;
+        }
+        stop_learner.store(true);
+        learner.join();
+        stop_learner.store(false);
+        Transition queued;
+        while (transition_queue.Pop(queued))
+        {
+            dqn.SaveTransition(queued);
+        }
+    }
+
+    /// Learner thread: move queued transitions to the replay memory, train, and publish
+    void RunLearner()
+    {
+        uint64_t steps = 0;
+        Transition queued;
+        while (!stop_learner.load(std::memory_order_relaxed))
+        {
+            bool received = false;
+            while (transition_queue.Pop(queued))
             {
-                dqn.OptimizeModel();
+                dqn.SaveTransition(queued);
+                received = true;
+            }
+            if (!IsWarmedUp())
+            {
+                if (!received)
+                {
+                    std::this_thread::sleep_for(std::chrono::microseconds(100));
+                }
+                continue;
+            }
+            dqn.OptimizeModel();
+            if (++steps % SNAPSHOT_INTERVAL == 0)
+            {
+                auto snapshot = dqn.SnapshotPolicy();
+                std::lock_guard<std::mutex> lock(snapshot_mutex);
+                policy_snapshot = snapshot;
+                snapshot_version.fetch_add(1, std::memory_order_release);
             }
         }
+    }
 
-        // choose action
-        trans.action = dqn.ChooseAction(trans.next_state);
-        auto& new_cWnd = std::get<0>(action_tup);
-        auto& new_ssThresh = std::get<1>(action_tup);
+    const TcpAction& ApplyAction(FlowState& flow, const TcpObservation& obs)
+    {
+        auto& new_cWnd = std::get<0>(flow.action_tup);
+        auto& new_ssThresh = std::get<1>(flow.action_tup);
+        float cWnd = obs.cWnd;
+        float segmentSize = obs.segmentSize;
 
-        if (trans.action & 1)
+        if (flow.trans.action & 1)
         {
             new_cWnd = cWnd + segmentSize;
         }
@@ -243,22 +1078,39 @@ class TcpDeepQAgent
             new_cWnd =
                 cWnd + std::floor(std::max((double)1, (double)segmentSize * segmentSize / cWnd));
         }
-        if (trans.action < 3)
+        if (flow.trans.action < 3)
         {
             new_ssThresh = 2 * segmentSize;
         }
         else
         {
-            new_ssThresh = std::floor((double)bytesInFlight / 2);
+            new_ssThresh = std::floor((double)obs.bytesInFlight / 2);
         }
 
-        return action_tup;
+        return flow.action_tup;
     }
 
-  private:
     DQN dqn;
-    Transition trans = {{0, 0, 0, 0, 0}, 0, {0, 0, 0, 0, 0}, 0};
-    std::tuple<uint32_t, uint32_t> action_tup = {0, 0};
+    std::unordered_map<uint32_t, FlowState> flows;
+
+    // buffers of the current batch
+    std::vector<FlowState*> batch_flows;
+    std::vector<float> batch_states;
+    std::vector<uint32_t> batch_actions;
+    std::vector<TcpObservation> single_obs = std::vector<TcpObservation>(1);
+    std::vector<TcpAction> single_action = std::vector<TcpAction>(1);
+
+    // actor/learner split
+    bool async_learning{false};
+    std::thread learner;
+    std::atomic<bool> stop_learner{false};
+    TransitionQueue transition_queue;
+    uint64_t dropped_transitions{0};
+    std::mutex snapshot_mutex;                 // guards policy_snapshot
+    std::shared_ptr<Net> policy_snapshot;      // latest snapshot published by the learner
+    std::atomic<uint64_t> snapshot_version{0}; // incremented on each publication
+    std::shared_ptr<Net> actor_snapshot;       // snapshot used by GetAction()
+    uint64_t actor_snapshot_version{0};        // version of actor_snapshot
 };
 
 #endif // NS3_RLTCP_AGENT_H
@@ -0,0 +1,128 @@
+/*
+ * Copyright (c) 2023 Huazhong University of Science and Technology
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Throughput of the prioritized replay sum tree: insertions, stratified batch
+ * sampling and batch priority updates, compared with uniform sampling.
+ *
+ * Usage: ./ns3 run "ns3ai_rltcp_replay_benchmark --capacity=1000000"
+ */
+
+#include "sum-tree.h"
+
+#include <ns3/core-module.h>
+
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <random>
+#include <vector>
+
+using namespace ns3;
+
+namespace
+{
+
+using Clock = std::chrono::steady_clock;
+
+double
+ElapsedSeconds(Clock::time_point start)
+{
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+void
+Report(const std::string& name, uint64_t ops, double seconds)
+{
+    std::cout << name << ": " << ops << " ops in " << seconds << " s, " << ops / seconds / 1e6
+              << " Mops/s, " << seconds / ops * 1e9 << " ns/op" << std::endl;
+}
+
+} // namespace
+
+int
+main(int argc, char* argv[])
+{
+    uint32_t capacity = 1000000;
+    uint32_t batchSize = 32;
+    uint32_t batches = 100000;
+    double alpha = 0.6;
+
+    CommandLine cmd;
+    cmd.AddValue("capacity", "Replay memory capacity", capacity);
+    cmd.AddValue("batchSize", "Transitions per sampled batch", batchSize);
+    cmd.AddValue("batches", "Number of batches sampled and updated", batches);
+    cmd.AddValue("alpha", "Prioritization exponent", alpha);
+    cmd.Parse(argc, argv);
+
+    std::mt19937 rng(1);
+    std::uniform_real_distribution<double> uniform(0.0, 1.0);
+    std::vector<uint32_t> indices(batchSize);
+    // accumulate results so the loops are not optimized away
+    uint64_t checksum = 0;
+
+    // fill the tree, as ReplayMemory::Add does with random priorities
+    SumTree tree(capacity);
+    auto start = Clock::now();
+    for (uint32_t i = 0; i < capacity; i++)
+    {
+        tree.Update(i, std::pow(uniform(rng) + 1e-6, alpha));
+    }
+    Report("insert", capacity, ElapsedSeconds(start));
+
+    // stratified sampling of batches
+    start = Clock::now();
+    for (uint32_t b = 0; b < batches; b++)
+    {
+        double segment = tree.Total() / batchSize;
+        for (uint32_t i = 0; i < batchSize; i++)
+        {
+            indices[i] = tree.Find((i + uniform(rng)) * segment);
+            checksum += indices[i];
+        }
+    }
+    Report("prioritized sample", (uint64_t)batches * batchSize, ElapsedSeconds(start));
+
+    // sample and update the priorities of the batch, as after each OptimizeModel
+    start = Clock::now();
+    for (uint32_t b = 0; b < batches; b++)
+    {
+        double segment = tree.Total() / batchSize;
+        for (uint32_t i = 0; i < batchSize; i++)
+        {
+            indices[i] = tree.Find((i + uniform(rng)) * segment);
+        }
+        for (uint32_t i = 0; i < batchSize; i++)
+        {
+            tree.Update(indices[i], std::pow(uniform(rng) + 1e-6, alpha));
+        }
+    }
+    Report("prioritized sample + update", (uint64_t)batches * batchSize, ElapsedSeconds(start));
+
+    // baseline: uniform sampling
+    std::uniform_int_distribution<uint32_t> randomIndex(0, capacity - 1);
+    start = Clock::now();
+    for (uint32_t b = 0; b < batches; b++)
+    {
+        for (uint32_t i = 0; i < batchSize; i++)
+        {
+            checksum += randomIndex(rng);
+        }
+    }
+    Report("uniform sample", (uint64_t)batches * batchSize, ElapsedSeconds(start));
+
+    std::cout << "checksum: " << checksum << std::endl;
+    return 0;
+}
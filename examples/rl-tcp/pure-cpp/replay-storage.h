@@ -0,0 +1,131 @@
+/*
+ * Copyright (c) 2023 Huazhong University of Science and Technology
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef NS3_RLTCP_REPLAY_STORAGE_H
+#define NS3_RLTCP_REPLAY_STORAGE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <fcntl.h>
+#include <string>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <utility>
+#include <vector>
+
+/**
+ * \brief Byte buffer backing a replay memory: zeroed heap memory, or a file mapped
+ * with mmap.
+ *
+ * The mapping is private (copy on write), so a loaded replay file is never modified
+ * and its pages are only read from disk when first touched. Loading a buffer of
+ * millions of transitions is therefore O(1).
+ */
+class ReplayStorage
+{
+  public:
+    ReplayStorage() = default;
+
+    ~ReplayStorage()
+    {
+        Release();
+    }
+
+    ReplayStorage(const ReplayStorage&) = delete;
+    ReplayStorage& operator=(const ReplayStorage&) = delete;
+
+    /**
+     * \brief Allocate bytes of zeroed memory, 8-byte aligned.
+     */
+    void Allocate(size_t bytes)
+    {
+        Release();
+        heap.assign((bytes + sizeof(uint64_t) - 1) / sizeof(uint64_t), 0);
+        data = reinterpret_cast<uint8_t*>(heap.data());
+        size = bytes;
+    }
+
+    /**
+     * \brief Map a whole file, readable and privately writable.
+     * \return false if the file cannot be opened or mapped; the storage is then empty.
+     */
+    bool Map(const std::string& filename)
+    {
+        Release();
+        int fd = open(filename.c_str(), O_RDONLY);
+        if (fd < 0)
+        {
+            return false;
+        }
+        struct stat st;
+        if (fstat(fd, &st) != 0 || st.st_size == 0)
+        {
+            close(fd);
+            return false;
+        }
+        void* addr = mmap(nullptr, st.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+        close(fd); // the mapping stays valid
+        if (addr == MAP_FAILED)
+        {
+            return false;
+        }
+        data = static_cast<uint8_t*>(addr);
+        size = st.st_size;
+        mapped = true;
+        return true;
+    }
+
+    void Swap(ReplayStorage& other)
+    {
+        heap.swap(other.heap);
+        std::swap(data, other.data);
+        std::swap(size, other.size);
+        std::swap(mapped, other.mapped);
+    }
+
+    uint8_t* Data() const
+    {
+        return data;
+    }
+
+    size_t Size() const
+    {
+        return size;
+    }
+
+  private:
+    void Release()
+    {
+        if (mapped)
+        {
+            munmap(data, size);
+            mapped = false;
+        }
+        heap.clear();
+        heap.shrink_to_fit();
+        data = nullptr;
+        size = 0;
+    }
+
+    std::vector<uint64_t> heap; // heap memory, if not mapped
+    uint8_t* data{nullptr};
+    size_t size{0};
+    bool mapped{false};
+};
+
+#endif // NS3_RLTCP_REPLAY_STORAGE_H
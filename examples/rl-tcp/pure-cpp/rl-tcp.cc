@@ -30,6 +30,8 @@
  *
  */
 
+#include "../rl-tcp-benchmark.h"
+
 #include "ns3/ai-module.h"
 #include "ns3/applications-module.h"
 #include "ns3/core-module.h"
@@ -88,9 +90,19 @@ main(int argc, char* argv[])
     double duration = 1000.0;
     uint32_t run = 0;
     bool flow_monitor = false;
+    bool benchmark = false;
     bool sack = true;
     std::string queue_disc_type = "ns3::PfifoFastQueueDisc";
     std::string recovery = "ns3::TcpClassicRecovery";
+    uint32_t replayCapacity = 2000;
+    bool prioritizedReplay = false;
+    bool asyncLearning = false;
+    double targetUpdateTau = 0;
+    bool batchInference = false;
+    std::string checkpointLoadFile;
+    std::string checkpointSaveFile;
+    std::string replayLoadFile;
+    std::string replaySaveFile;
 
     CommandLine cmd;
     // seed related
@@ -115,11 +127,29 @@ main(int argc, char* argv[])
     cmd.AddValue("mtu", "Size of IP packets to send in bytes", mtu_bytes);
     cmd.AddValue("duration", "Time to allow flows to run in seconds", duration);
     cmd.AddValue("flow_monitor", "Enable flow monitor", flow_monitor);
+    cmd.AddValue("benchmark",
+                 "Print events/s, wall-clock time, IPC rounds and agent time",
+                 benchmark);
     cmd.AddValue("queue_disc_type",
                  "Queue disc type for gateway (e.g. ns3::CoDelQueueDisc)",
                  queue_disc_type);
     cmd.AddValue("sack", "Enable or disable SACK option", sack);
     cmd.AddValue("recovery", "Recovery algorithm type to use (e.g., ns3::TcpPrrRecovery", recovery);
+    cmd.AddValue("replayCapacity",
+                 "Capacity of the DQN replay memory. Default: 2000",
+                 replayCapacity);
+    cmd.AddValue("prioritizedReplay", "Enable prioritized experience replay", prioritizedReplay);
+    cmd.AddValue("asyncLearning", "Train the DQN in a background thread", asyncLearning);
+    cmd.AddValue("targetUpdateTau",
+                 "Soft update rate of the DQN target network. Default: 0 (periodic copy)",
+                 targetUpdateTau);
+    cmd.AddValue("batchInference",
+                 "Share one DQN agent among the TcpRlTimeBased sockets, with batched inference",
+                 batchInference);
+    cmd.AddValue("checkpointLoad", "DQN checkpoint to start from", checkpointLoadFile);
+    cmd.AddValue("checkpointSave", "File to save the DQN checkpoint to", checkpointSaveFile);
+    cmd.AddValue("replayLoad", "Replay memory file to start from", replayLoadFile);
+    cmd.AddValue("replaySave", "File to save the replay memory to", replaySaveFile);
     cmd.Parse(argc, argv);
 
     // There are two kinds of Tcp congestion control algorithm using RL:
@@ -130,6 +160,26 @@ main(int argc, char* argv[])
     {
         Config::SetDefault("ns3::TcpTimeStepEnv::StepTime", TimeValue(Seconds(tcpEnvTimeStep)));
     }
+    Config::SetDefault("ns3::TcpTimeStepEnv::ReplayCapacity", UintegerValue(replayCapacity));
+    Config::SetDefault("ns3::TcpEventBasedEnv::ReplayCapacity", UintegerValue(replayCapacity));
+    Config::SetDefault("ns3::TcpTimeStepEnv::PrioritizedReplay", BooleanValue(prioritizedReplay));
+    Config::SetDefault("ns3::TcpEventBasedEnv::PrioritizedReplay",
+                       BooleanValue(prioritizedReplay));
+    Config::SetDefault("ns3::TcpTimeStepEnv::AsyncLearning", BooleanValue(asyncLearning));
+    Config::SetDefault("ns3::TcpEventBasedEnv::AsyncLearning", BooleanValue(asyncLearning));
+    Config::SetDefault("ns3::TcpTimeStepEnv::TargetUpdateTau", DoubleValue(targetUpdateTau));
+    Config::SetDefault("ns3::TcpEventBasedEnv::TargetUpdateTau", DoubleValue(targetUpdateTau));
+    Config::SetDefault("ns3::TcpTimeStepEnv::BatchInference", BooleanValue(batchInference));
+    Config::SetDefault("ns3::TcpTimeStepEnv::CheckpointLoadFile", StringValue(checkpointLoadFile));
+    Config::SetDefault("ns3::TcpTimeStepEnv::CheckpointSaveFile", StringValue(checkpointSaveFile));
+    Config::SetDefault("ns3::TcpTimeStepEnv::ReplayLoadFile", StringValue(replayLoadFile));
+    Config::SetDefault("ns3::TcpTimeStepEnv::ReplaySaveFile", StringValue(replaySaveFile));
+    Config::SetDefault("ns3::TcpEventBasedEnv::CheckpointLoadFile",
+                       StringValue(checkpointLoadFile));
+    Config::SetDefault("ns3::TcpEventBasedEnv::CheckpointSaveFile",
+                       StringValue(checkpointSaveFile));
+    Config::SetDefault("ns3::TcpEventBasedEnv::ReplayLoadFile", StringValue(replayLoadFile));
+    Config::SetDefault("ns3::TcpEventBasedEnv::ReplaySaveFile", StringValue(replaySaveFile));
 
     transport_prot = std::string("ns3::") + transport_prot;
     Config::SetDefault("ns3::TcpL4Protocol::SocketType",
@@ -279,7 +329,9 @@ main(int argc, char* argv[])
     }
 
     Simulator::Stop(Seconds(stop_time));
+    RlTcpBenchmark::Get().Begin();
     Simulator::Run();
+    RlTcpBenchmark::Get().End();
 
     if (flow_monitor)
     {
@@ -287,6 +339,10 @@ main(int argc, char* argv[])
     }
 
     PrintRxCount();
+    if (benchmark)
+    {
+        RlTcpBenchmark::Get().Report("pure-cpp", nLeaf, Simulator::Now().GetSeconds());
+    }
     Simulator::Destroy();
     return 0;
 }
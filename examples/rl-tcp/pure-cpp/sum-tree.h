@@ -0,0 +1,120 @@
+/*
+ * Copyright (c) 2023 Huazhong University of Science and Technology
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef NS3_RLTCP_SUM_TREE_H
+#define NS3_RLTCP_SUM_TREE_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/**
+ * \brief Sum tree over the priorities of a replay memory.
+ *
+ * The tree is stored in a flat array: node i has children 2i and 2i+1, the root
+ * is node 1 and the leaves start at the first power of two not less than the
+ * capacity. Updating a priority and finding the leaf of a prefix sum are both
+ * O(log n).
+ */
+class SumTree
+{
+  public:
+    explicit SumTree(uint32_t capacity = 0)
+    {
+        Resize(capacity);
+    }
+
+    /**
+     * \brief Resize the tree. All priorities are reset to zero.
+     */
+    void Resize(uint32_t capacity)
+    {
+        leaves = 1;
+        while (leaves < capacity)
+        {
+            leaves <<= 1;
+        }
+        tree.assign(2 * (size_t)leaves, 0.0);
+    }
+
+    void Update(uint32_t index, double priority)
+    {
+        size_t i = index + (size_t)leaves;
+        tree[i] = priority;
+        // recompute the sums rather than adding the difference, so errors do not accumulate
+        for (i >>= 1; i > 0; i >>= 1)
+        {
+            tree[i] = tree[2 * i] + tree[2 * i + 1];
+        }
+    }
+
+    /**
+     * \brief Set the first n priorities at once (the others are zero) in O(capacity).
+     */
+    void Build(const double* priorities, uint32_t n)
+    {
+        std::fill(tree.begin(), tree.end(), 0.0);
+        std::copy(priorities, priorities + n, tree.begin() + leaves);
+        for (size_t i = leaves - 1; i > 0; i--)
+        {
+            tree[i] = tree[2 * i] + tree[2 * i + 1];
+        }
+    }
+
+    double Get(uint32_t index) const
+    {
+        return tree[index + (size_t)leaves];
+    }
+
+    double Total() const
+    {
+        return tree[1];
+    }
+
+    /**
+     * \brief Find the leaf whose range of the cumulative sum contains value.
+     * \param value In [0, Total()).
+     * \return Index of the leaf. Leaves with zero priority are never returned.
+     */
+    uint32_t Find(double value) const
+    {
+        size_t i = 1;
+        while (i < leaves)
+        {
+            size_t left = 2 * i;
+            // go right only if the value is past the left sum and the right subtree is not
+            // empty, which also covers rounding errors at the upper end
+            if (value >= tree[left] && tree[left + 1] > 0)
+            {
+                value -= tree[left];
+                i = left + 1;
+            }
+            else
+            {
+                i = left;
+            }
+        }
+        return i - leaves;
+    }
+
+  private:
+    uint32_t leaves;
+    std::vector<double> tree;
+};
+
+#endif // NS3_RLTCP_SUM_TREE_H
@@ -0,0 +1,88 @@
+/*
+ * Copyright (c) 2023 Huazhong University of Science and Technology
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Cost of one DQN target network update versus model size: serialization
+ * through torch::save / torch::load, in-memory parameter copy and Polyak
+ * soft update.
+ *
+ * Usage: ./ns3 run "ns3ai_rltcp_target_sync_benchmark --iterations=1000"
+ */
+
+#include "agent.h"
+
+#include <ns3/core-module.h>
+
+#include <chrono>
+#include <iostream>
+#include <sstream>
+
+using namespace ns3;
+
+namespace
+{
+
+using Clock = std::chrono::steady_clock;
+
+/// \return mean microseconds per call of f
+template <typename F>
+double
+TimeUs(uint32_t iterations, F f)
+{
+    auto start = Clock::now();
+    for (uint32_t i = 0; i < iterations; i++)
+    {
+        f();
+    }
+    return std::chrono::duration<double, std::micro>(Clock::now() - start).count() / iterations;
+}
+
+} // namespace
+
+int
+main(int argc, char* argv[])
+{
+    uint32_t iterations = 1000;
+    double tau = 0.005;
+
+    CommandLine cmd;
+    cmd.AddValue("iterations", "Updates timed per model size and method", iterations);
+    cmd.AddValue("tau", "Polyak update rate", tau);
+    cmd.Parse(argc, argv);
+
+    std::cout << "hidden,parameters,serialize_us,copy_us,polyak_us" << std::endl;
+    for (int hidden : {20, 64, 256, 1024, 2048})
+    {
+        Net policy(OBS_SHAPE, ACTION_NUM, hidden);
+        Net target(OBS_SHAPE, ACTION_NUM, hidden);
+        int64_t parameters = 0;
+        for (const auto& p : policy->parameters())
+        {
+            parameters += p.numel();
+        }
+
+        double serializeUs = TimeUs(iterations, [&]() {
+            std::stringstream stream;
+            torch::save(policy, stream);
+            torch::load(target, stream);
+        });
+        double copyUs = TimeUs(iterations, [&]() { CopyNetParameters(policy, target); });
+        double polyakUs = TimeUs(iterations, [&]() { PolyakUpdate(policy, target, tau); });
+
+        std::cout << hidden << "," << parameters << "," << serializeUs << "," << copyUs << ","
+                  << polyakUs << std::endl;
+    }
+    return 0;
+}
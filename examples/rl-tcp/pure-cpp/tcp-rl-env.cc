@@ -22,23 +22,114 @@
 
 #include "tcp-rl-env.h"
 
+#include "../rl-tcp-benchmark.h"
+
+#include <ns3/ns3-ai-step-batcher.h>
+
 #include <iostream>
-#include <numeric>
 
 namespace ns3
 {
 
 NS_LOG_COMPONENT_DEFINE("tcp-rl-env-purecpp");
 
+namespace
+{
+
+/// DQN agent shared by all sockets using batched inference
+struct TcpRlBatchPolicy
+{
+    TcpRlBatchPolicy()
+    {
+        batcher.SetBatchHandler(MakeCallback(&TcpRlBatchPolicy::Infer, this));
+    }
+
+    void Infer(const std::vector<TcpObservation>& obs, std::vector<TcpAction>& actions)
+    {
+        auto begin = RlTcpBenchmark::Clock::now();
+        agent.GetActions(obs, actions);
+        RlTcpBenchmark::Get().RecordAgentCall(begin, obs.size(), 0);
+    }
+
+    TcpDeepQAgent agent;
+    Ns3AiStepBatcher<TcpObservation, TcpAction> batcher;
+    bool configured{false}; //!< whether the agent took the settings of the first socket
+    uint32_t users{0};      //!< sockets sharing the agent
+    std::string checkpointSaveFile;
+    std::string replaySaveFile;
+};
+
+TcpRlBatchPolicy&
+GetBatchPolicy()
+{
+    static TcpRlBatchPolicy policy;
+    return policy;
+}
+
+/// Load the warm-start files of an agent, if set
+void
+LoadAgent(TcpDeepQAgent& agent, const std::string& checkpointFile, const std::string& replayFile)
+{
+    if (!checkpointFile.empty())
+    {
+        NS_ABORT_MSG_IF(!agent.LoadCheckpoint(checkpointFile),
+                        "Cannot load checkpoint " << checkpointFile);
+        NS_LOG_INFO("Loaded checkpoint " << checkpointFile);
+    }
+    if (!replayFile.empty())
+    {
+        NS_ABORT_MSG_IF(!agent.LoadReplay(replayFile),
+                        "Cannot load replay memory " << replayFile);
+        NS_LOG_INFO("Loaded replay memory " << replayFile << ", capacity "
+                                            << agent.GetReplayCapacity());
+    }
+}
+
+/// Save the checkpoint and replay memory of an agent, if files are set
+void
+SaveAgent(TcpDeepQAgent& agent, const std::string& checkpointFile, const std::string& replayFile)
+{
+    if (!checkpointFile.empty())
+    {
+        NS_ABORT_MSG_IF(!agent.SaveCheckpoint(checkpointFile),
+                        "Cannot save checkpoint " << checkpointFile);
+    }
+    if (!replayFile.empty())
+    {
+        NS_ABORT_MSG_IF(!agent.SaveReplay(replayFile),
+                        "Cannot save replay memory " << replayFile);
+    }
+}
+
+} // namespace
+
 NS_OBJECT_ENSURE_REGISTERED(TcpTimeStepEnv);
 
 TcpTimeStepEnv::TcpTimeStepEnv()
-    : m_agent()
 {
 }
 
 TcpTimeStepEnv::~TcpTimeStepEnv()
 {
+    if (m_agent && m_agent->GetDroppedTransitions() > 0)
+    {
+        NS_LOG_WARN("Learner dropped " << m_agent->GetDroppedTransitions() << " transitions");
+    }
+    if (!m_started)
+    {
+        return;
+    }
+    if (!m_batchInference)
+    {
+        SaveAgent(*m_agent, m_checkpointSaveFile, m_replaySaveFile);
+        return;
+    }
+    // the shared agent is saved with the last socket
+    TcpRlBatchPolicy& policy = GetBatchPolicy();
+    if (--policy.users == 0)
+    {
+        SaveAgent(policy.agent, policy.checkpointSaveFile, policy.replaySaveFile);
+    }
 }
 
 TypeId
@@ -52,7 +143,63 @@ TcpTimeStepEnv::GetTypeId()
                                           "Step interval used in TCP env. Default: 100ms",
                                           TimeValue(MilliSeconds(100)),
                                           MakeTimeAccessor(&TcpTimeStepEnv::m_timeStep),
-                                          MakeTimeChecker());
+                                          MakeTimeChecker())
+                            .AddAttribute("ReplayCapacity",
+                                          "Capacity of the DQN replay memory, in transitions",
+                                          UintegerValue(REPLAY_LENGTH),
+                                          MakeUintegerAccessor(&TcpTimeStepEnv::m_replayCapacity),
+                                          MakeUintegerChecker<uint32_t>(1))
+                            .AddAttribute("PrioritizedReplay",
+                                          "Sample the replay memory by TD error (sum tree) "
+                                          "instead of uniformly",
+                                          BooleanValue(false),
+                                          MakeBooleanAccessor(&TcpTimeStepEnv::m_prioritizedReplay),
+                                          MakeBooleanChecker())
+                            .AddAttribute("AsyncLearning",
+                                          "Train the DQN in a background learner thread; the "
+                                          "simulation thread only runs inference",
+                                          BooleanValue(false),
+                                          MakeBooleanAccessor(&TcpTimeStepEnv::m_asyncLearning),
+                                          MakeBooleanChecker())
+                            .AddAttribute("TargetUpdateTau",
+                                          "Soft update rate of the DQN target network at every "
+                                          "step. 0: copy the policy network every 100 steps",
+                                          DoubleValue(0),
+                                          MakeDoubleAccessor(&TcpTimeStepEnv::m_targetUpdateTau),
+                                          MakeDoubleChecker<double>(0, 1))
+                            .AddAttribute("BatchInference",
+                                          "Share one DQN agent among all sockets and run the "
+                                          "sockets stepping at the same time in one batched "
+                                          "forward pass. Steps are aligned to multiples of "
+                                          "StepTime",
+                                          BooleanValue(false),
+                                          MakeBooleanAccessor(&TcpTimeStepEnv::m_batchInference),
+                                          MakeBooleanChecker())
+                            .AddAttribute("CheckpointLoadFile",
+                                          "DQN checkpoint (networks and optimizer) to start "
+                                          "from. Empty: random weights",
+                                          StringValue(""),
+                                          MakeStringAccessor(&TcpTimeStepEnv::m_checkpointLoadFile),
+                                          MakeStringChecker())
+                            .AddAttribute("CheckpointSaveFile",
+                                          "File to save the DQN checkpoint to at the end of "
+                                          "the simulation. Empty: not saved",
+                                          StringValue(""),
+                                          MakeStringAccessor(&TcpTimeStepEnv::m_checkpointSaveFile),
+                                          MakeStringChecker())
+                            .AddAttribute("ReplayLoadFile",
+                                          "Replay memory file to start from (mapped with mmap; "
+                                          "its capacity replaces ReplayCapacity). Empty: "
+                                          "empty replay memory",
+                                          StringValue(""),
+                                          MakeStringAccessor(&TcpTimeStepEnv::m_replayLoadFile),
+                                          MakeStringChecker())
+                            .AddAttribute("ReplaySaveFile",
+                                          "File to save the replay memory to at the end of the "
+                                          "simulation. Empty: not saved",
+                                          StringValue(""),
+                                          MakeStringAccessor(&TcpTimeStepEnv::m_replaySaveFile),
+                                          MakeStringChecker());
 
     return tid;
 }
@@ -71,6 +218,16 @@ TcpTimeStepEnv::SetSocketUuid(uint32_t id)
     m_socketUuid = id;
 }
 
+void
+TcpTimeStepEnv::ConfigureAgent(TcpDeepQAgent& agent) const
+{
+    agent.SetReplayCapacity(m_replayCapacity);
+    agent.SetPrioritizedReplay(m_prioritizedReplay);
+    agent.SetTargetUpdateTau(m_targetUpdateTau);
+    agent.SetAsyncLearning(m_asyncLearning);
+    LoadAgent(agent, m_checkpointLoadFile, m_replayLoadFile);
+}
+
 void
 TcpTimeStepEnv::TxPktTrace(Ptr<const Packet>, const TcpHeader&, Ptr<const TcpSocketBase>)
 {
@@ -104,29 +261,47 @@ TcpTimeStepEnv::ScheduleNotify()
 {
     Simulator::Schedule(m_timeStep, &TcpTimeStepEnv::ScheduleNotify, this);
 
-    uint64_t bytesInFlightSum = std::accumulate(m_bytesInFlight.begin(), m_bytesInFlight.end(), 0);
-    m_bytesInFlight.clear();
+    uint64_t bytesInFlightSum = m_bytesInFlight.GetSum();
+    m_bytesInFlight.Reset();
 
-    uint64_t segmentsAckedSum = std::accumulate(m_segmentsAcked.begin(), m_segmentsAcked.end(), 0);
-    m_segmentsAcked.clear();
+    uint64_t segmentsAckedSum = m_segmentsAcked.GetSum();
+    m_segmentsAcked.Reset();
 
-    std::cerr << "At " << (uint64_t)(Simulator::Now().GetMilliSeconds()) << "ms:\n";
-    std::cerr << "\tstate --"
-              << " ssThresh=" << m_tcb->m_ssThresh << " cWnd=" << m_tcb->m_cWnd
-              << " segmentAcked=" << segmentsAckedSum << " segmentSize=" << m_tcb->m_segmentSize
-              << " bytesInFlightSum=" << bytesInFlightSum << std::endl;
+    NS_LOG_DEBUG("Socket " << m_socketUuid << " state --"
+                           << " ssThresh=" << m_tcb->m_ssThresh << " cWnd=" << m_tcb->m_cWnd
+                           << " segmentAcked=" << segmentsAckedSum
+                           << " segmentSize=" << m_tcb->m_segmentSize
+                           << " bytesInFlightSum=" << bytesInFlightSum);
 
-    auto actions = m_agent.GetAction(m_tcb->m_ssThresh,
+    if (m_batchInference)
+    {
+        TcpRlBatchPolicy& policy = GetBatchPolicy();
+        if (!policy.configured)
+        {
+            ConfigureAgent(policy.agent);
+            policy.checkpointSaveFile = m_checkpointSaveFile;
+            policy.replaySaveFile = m_replaySaveFile;
+            policy.configured = true;
+        }
+        // the action is set when the batch of this timestamp is flushed
+        policy.batcher.Request({m_socketUuid,
+                                (float)m_tcb->m_ssThresh,
+                                (float)m_tcb->m_cWnd,
+                                (float)segmentsAckedSum,
+                                (float)m_tcb->m_segmentSize,
+                                (float)bytesInFlightSum},
+                               MakeCallback(&TcpTimeStepEnv::SetAction, this));
+    }
+    else
+    {
+        auto begin = RlTcpBenchmark::Clock::now();
+        SetAction(m_agent->GetAction(m_tcb->m_ssThresh,
                                      m_tcb->m_cWnd,
                                      segmentsAckedSum,
                                      m_tcb->m_segmentSize,
-                                     bytesInFlightSum);
-
-    m_new_cWnd = std::get<0>(actions);
-    m_new_ssThresh = std::get<1>(actions);
-
-    std::cerr << "\taction --"
-              << " new_cWnd=" << m_new_cWnd << " new_ssThresh=" << m_new_ssThresh << std::endl;
+                                     bytesInFlightSum));
+        RlTcpBenchmark::Get().RecordAgentCall(begin, 1, 0);
+    }
 
     m_rttSampleNum = 0;
     m_rttSum = MicroSeconds(0.0);
@@ -138,6 +313,36 @@ TcpTimeStepEnv::ScheduleNotify()
     m_interRxTimeSum = MicroSeconds(0.0);
 }
 
+void
+TcpTimeStepEnv::SetAction(const TcpAction& action)
+{
+    m_new_cWnd = std::get<0>(action);
+    m_new_ssThresh = std::get<1>(action);
+    m_hasAction = true;
+
+    NS_LOG_DEBUG("Socket " << m_socketUuid << " action --"
+                           << " new_cWnd=" << m_new_cWnd << " new_ssThresh=" << m_new_ssThresh);
+}
+
+void
+TcpTimeStepEnv::Start()
+{
+    m_started = true;
+    if (!m_batchInference)
+    {
+        // the sockets sharing the batched agent do not need their own
+        m_agent = std::make_unique<TcpDeepQAgent>();
+        ConfigureAgent(*m_agent);
+        ScheduleNotify();
+        return;
+    }
+    GetBatchPolicy().users++;
+    // align the steps of all sockets to multiples of the step time, so they are batched
+    Time offset = TimeStep(Simulator::Now().GetTimeStep() % m_timeStep.GetTimeStep());
+    Time delay = offset.IsZero() ? Time(0) : m_timeStep - offset;
+    Simulator::Schedule(delay, &TcpTimeStepEnv::ScheduleNotify, this);
+}
+
 uint32_t
 TcpTimeStepEnv::GetSsThresh(Ptr<const TcpSocketState> tcb, uint32_t bytesInFlight)
 {
@@ -145,14 +350,18 @@ TcpTimeStepEnv::GetSsThresh(Ptr<const TcpSocketState> tcb, uint32_t bytesInFligh
     NS_LOG_INFO(Simulator::Now() << " Node: " << m_nodeId
                                  << " GetSsThresh, BytesInFlight: " << bytesInFlight);
     m_tcb = tcb;
-    m_bytesInFlight.push_back(bytesInFlight);
+    m_bytesInFlight.Add(bytesInFlight);
 
     if (!m_started)
     {
-        m_started = true;
-        ScheduleNotify();
+        Start();
     }
 
+    if (!m_hasAction)
+    {
+        // no action yet while waiting for the first aligned step
+        return std::max(2 * tcb->m_segmentSize, bytesInFlight / 2);
+    }
     return m_new_ssThresh;
 }
 
@@ -163,16 +372,18 @@ TcpTimeStepEnv::IncreaseWindow(Ptr<TcpSocketState> tcb, uint32_t segmentsAcked)
     NS_LOG_INFO(Simulator::Now() << " Node: " << m_nodeId
                                  << " IncreaseWindow, SegmentsAcked: " << segmentsAcked);
     m_tcb = tcb;
-    m_segmentsAcked.push_back(segmentsAcked);
-    m_bytesInFlight.push_back(tcb->m_bytesInFlight);
+    m_segmentsAcked.Add(segmentsAcked);
+    m_bytesInFlight.Add(tcb->m_bytesInFlight);
 
     if (!m_started)
     {
-        m_started = true;
-        ScheduleNotify();
+        Start();
     }
 
-    tcb->m_cWnd = m_new_cWnd;
+    if (m_hasAction)
+    {
+        tcb->m_cWnd = m_new_cWnd;
+    }
 }
 
 void
@@ -199,12 +410,20 @@ TcpTimeStepEnv::CwndEvent(Ptr<TcpSocketState> tcb, const TcpSocketState::TcpCAEv
 NS_OBJECT_ENSURE_REGISTERED(TcpEventBasedEnv);
 
 TcpEventBasedEnv::TcpEventBasedEnv()
-    : m_agent()
 {
 }
 
 TcpEventBasedEnv::~TcpEventBasedEnv()
 {
+    if (!m_agent)
+    {
+        return;
+    }
+    if (m_agent->GetDroppedTransitions() > 0)
+    {
+        NS_LOG_WARN("Learner dropped " << m_agent->GetDroppedTransitions() << " transitions");
+    }
+    SaveAgent(*m_agent, m_checkpointSaveFile, m_replaySaveFile);
 }
 
 TypeId
@@ -213,7 +432,58 @@ TcpEventBasedEnv::GetTypeId()
     static TypeId tid = TypeId("ns3::TcpEventBasedEnv")
                             .SetParent<Object>()
                             .SetGroupName("Ns3Ai")
-                            .AddConstructor<TcpEventBasedEnv>();
+                            .AddConstructor<TcpEventBasedEnv>()
+                            .AddAttribute("ReplayCapacity",
+                                          "Capacity of the DQN replay memory, in transitions",
+                                          UintegerValue(REPLAY_LENGTH),
+                                          MakeUintegerAccessor(&TcpEventBasedEnv::m_replayCapacity),
+                                          MakeUintegerChecker<uint32_t>(1))
+                            .AddAttribute("PrioritizedReplay",
+                                          "Sample the replay memory by TD error (sum tree) "
+                                          "instead of uniformly",
+                                          BooleanValue(false),
+                                          MakeBooleanAccessor(
+                                              &TcpEventBasedEnv::m_prioritizedReplay),
+                                          MakeBooleanChecker())
+                            .AddAttribute("AsyncLearning",
+                                          "Train the DQN in a background learner thread; the "
+                                          "simulation thread only runs inference",
+                                          BooleanValue(false),
+                                          MakeBooleanAccessor(&TcpEventBasedEnv::m_asyncLearning),
+                                          MakeBooleanChecker())
+                            .AddAttribute("TargetUpdateTau",
+                                          "Soft update rate of the DQN target network at every "
+                                          "step. 0: copy the policy network every 100 steps",
+                                          DoubleValue(0),
+                                          MakeDoubleAccessor(&TcpEventBasedEnv::m_targetUpdateTau),
+                                          MakeDoubleChecker<double>(0, 1))
+                            .AddAttribute("CheckpointLoadFile",
+                                          "DQN checkpoint (networks and optimizer) to start "
+                                          "from. Empty: random weights",
+                                          StringValue(""),
+                                          MakeStringAccessor(
+                                              &TcpEventBasedEnv::m_checkpointLoadFile),
+                                          MakeStringChecker())
+                            .AddAttribute("CheckpointSaveFile",
+                                          "File to save the DQN checkpoint to at the end of "
+                                          "the simulation. Empty: not saved",
+                                          StringValue(""),
+                                          MakeStringAccessor(
+                                              &TcpEventBasedEnv::m_checkpointSaveFile),
+                                          MakeStringChecker())
+                            .AddAttribute("ReplayLoadFile",
+                                          "Replay memory file to start from (mapped with mmap; "
+                                          "its capacity replaces ReplayCapacity). Empty: "
+                                          "empty replay memory",
+                                          StringValue(""),
+                                          MakeStringAccessor(&TcpEventBasedEnv::m_replayLoadFile),
+                                          MakeStringChecker())
+                            .AddAttribute("ReplaySaveFile",
+                                          "File to save the replay memory to at the end of the "
+                                          "simulation. Empty: not saved",
+                                          StringValue(""),
+                                          MakeStringAccessor(&TcpEventBasedEnv::m_replaySaveFile),
+                                          MakeStringChecker());
 
     return tid;
 }
@@ -232,6 +502,16 @@ TcpEventBasedEnv::SetSocketUuid(uint32_t id)
     m_socketUuid = id;
 }
 
+void
+TcpEventBasedEnv::ConfigureAgent(TcpDeepQAgent& agent) const
+{
+    agent.SetReplayCapacity(m_replayCapacity);
+    agent.SetPrioritizedReplay(m_prioritizedReplay);
+    agent.SetTargetUpdateTau(m_targetUpdateTau);
+    agent.SetAsyncLearning(m_asyncLearning);
+    LoadAgent(agent, m_checkpointLoadFile, m_replayLoadFile);
+}
+
 void
 TcpEventBasedEnv::TxPktTrace(Ptr<const Packet>, const TcpHeader&, Ptr<const TcpSocketBase>)
 {
@@ -263,29 +543,37 @@ TcpEventBasedEnv::RxPktTrace(Ptr<const Packet>, const TcpHeader&, Ptr<const TcpS
 void
 TcpEventBasedEnv::Notify()
 {
-    uint64_t bytesInFlightSum = std::accumulate(m_bytesInFlight.begin(), m_bytesInFlight.end(), 0);
-    m_bytesInFlight.clear();
+    if (!m_agent)
+    {
+        m_agent = std::make_unique<TcpDeepQAgent>();
+        ConfigureAgent(*m_agent);
+    }
 
-    uint64_t segmentsAckedSum = std::accumulate(m_segmentsAcked.begin(), m_segmentsAcked.end(), 0);
-    m_segmentsAcked.clear();
+    uint64_t bytesInFlightSum = m_bytesInFlight.GetSum();
+    m_bytesInFlight.Reset();
 
-    std::cerr << "At " << (uint64_t)(Simulator::Now().GetMilliSeconds()) << "ms:\n";
-    std::cerr << "\tstate --"
-              << " ssThresh=" << m_tcb->m_ssThresh << " cWnd=" << m_tcb->m_cWnd
-              << " segmentAcked=" << segmentsAckedSum << " segmentSize=" << m_tcb->m_segmentSize
-              << " bytesInFlightSum=" << bytesInFlightSum << std::endl;
+    uint64_t segmentsAckedSum = m_segmentsAcked.GetSum();
+    m_segmentsAcked.Reset();
 
-    auto actions = m_agent.GetAction(m_tcb->m_ssThresh,
-                                     m_tcb->m_cWnd,
-                                     segmentsAckedSum,
-                                     m_tcb->m_segmentSize,
-                                     bytesInFlightSum);
+    NS_LOG_DEBUG("Socket " << m_socketUuid << " state --"
+                           << " ssThresh=" << m_tcb->m_ssThresh << " cWnd=" << m_tcb->m_cWnd
+                           << " segmentAcked=" << segmentsAckedSum
+                           << " segmentSize=" << m_tcb->m_segmentSize
+                           << " bytesInFlightSum=" << bytesInFlightSum);
+
+    auto begin = RlTcpBenchmark::Clock::now();
+    auto actions = m_agent->GetAction(m_tcb->m_ssThresh,
+                                      m_tcb->m_cWnd,
+                                      segmentsAckedSum,
+                                      m_tcb->m_segmentSize,
+                                      bytesInFlightSum);
+    RlTcpBenchmark::Get().RecordAgentCall(begin, 1, 0);
 
     m_new_cWnd = std::get<0>(actions);
     m_new_ssThresh = std::get<1>(actions);
 
-    std::cerr << "\taction --"
-              << " new_cWnd=" << m_new_cWnd << " new_ssThresh=" << m_new_ssThresh << std::endl;
+    NS_LOG_DEBUG("Socket " << m_socketUuid << " action --"
+                           << " new_cWnd=" << m_new_cWnd << " new_ssThresh=" << m_new_ssThresh);
 
     m_rttSampleNum = 0;
     m_rttSum = MicroSeconds(0.0);
@@ -304,7 +592,7 @@ TcpEventBasedEnv::GetSsThresh(Ptr<const TcpSocketState> tcb, uint32_t bytesInFli
     NS_LOG_INFO(Simulator::Now() << " Node: " << m_nodeId
                                  << " GetSsThresh, BytesInFlight: " << bytesInFlight);
     m_tcb = tcb;
-    m_bytesInFlight.push_back(bytesInFlight);
+    m_bytesInFlight.Add(bytesInFlight);
 
     Notify();
 
@@ -318,8 +606,8 @@ TcpEventBasedEnv::IncreaseWindow(Ptr<TcpSocketState> tcb, uint32_t segmentsAcked
     NS_LOG_INFO(Simulator::Now() << " Node: " << m_nodeId
                                  << " IncreaseWindow, SegmentsAcked: " << segmentsAcked);
     m_tcb = tcb;
-    m_segmentsAcked.push_back(segmentsAcked);
-    m_bytesInFlight.push_back(tcb->m_bytesInFlight);
+    m_segmentsAcked.Add(segmentsAcked);
+    m_bytesInFlight.Add(tcb->m_bytesInFlight);
 
     Notify();
 
@@ -27,9 +27,12 @@
 
 #include "ns3/core-module.h"
 #include "ns3/network-module.h"
+#include "ns3/ns3-ai-stream-stats.h"
 #include "ns3/tcp-header.h"
 #include "ns3/tcp-socket-base.h"
 
+#include <memory>
+
 namespace ns3
 {
 struct TcpRlEnv
@@ -84,19 +87,33 @@ class TcpTimeStepEnv : public Object
 
     uint32_t m_new_ssThresh;
     uint32_t m_new_cWnd;
+    bool m_hasAction{false};
     void ScheduleNotify();
+    void Start();
+    void SetAction(const TcpAction& action);
+    void ConfigureAgent(TcpDeepQAgent& agent) const;
     bool m_started{false};
     Time m_timeStep;
+    bool m_batchInference;
 
     // state
     Ptr<const TcpSocketState> m_tcb;
-    std::vector<uint32_t> m_bytesInFlight;
-    std::vector<uint32_t> m_segmentsAcked;
+    Ns3AiStreamStats m_bytesInFlight;
+    Ns3AiStreamStats m_segmentsAcked;
 
     uint64_t m_rttSampleNum{0};
     Time m_rttSum{MicroSeconds(0.0)};
 
-    TcpDeepQAgent m_agent;
+    // agent of this socket, only built without BatchInference
+    std::unique_ptr<TcpDeepQAgent> m_agent;
+    uint32_t m_replayCapacity;        //!< capacity of the replay memory
+    bool m_prioritizedReplay;         //!< whether the replay memory is prioritized
+    bool m_asyncLearning;             //!< whether the DQN is trained in a learner thread
+    double m_targetUpdateTau;         //!< soft update rate of the target network
+    std::string m_checkpointLoadFile; //!< checkpoint to warm-start from
+    std::string m_checkpointSaveFile; //!< checkpoint written when the env is destroyed
+    std::string m_replayLoadFile;     //!< replay memory to warm-start from
+    std::string m_replaySaveFile;     //!< replay memory written when the env is destroyed
 };
 
 class TcpEventBasedEnv : public Object
@@ -133,16 +150,26 @@ class TcpEventBasedEnv : public Object
     uint32_t m_new_ssThresh;
     uint32_t m_new_cWnd;
     void Notify();
+    void ConfigureAgent(TcpDeepQAgent& agent) const;
 
     // state
     Ptr<const TcpSocketState> m_tcb;
-    std::vector<uint32_t> m_bytesInFlight;
-    std::vector<uint32_t> m_segmentsAcked;
+    Ns3AiStreamStats m_bytesInFlight;
+    Ns3AiStreamStats m_segmentsAcked;
 
     uint64_t m_rttSampleNum{0};
     Time m_rttSum{MicroSeconds(0.0)};
 
-    TcpDeepQAgent m_agent;
+    // agent of this socket, built at the first notification
+    std::unique_ptr<TcpDeepQAgent> m_agent;
+    uint32_t m_replayCapacity;        //!< capacity of the replay memory
+    bool m_prioritizedReplay;         //!< whether the replay memory is prioritized
+    bool m_asyncLearning;             //!< whether the DQN is trained in a learner thread
+    double m_targetUpdateTau;         //!< soft update rate of the target network
+    std::string m_checkpointLoadFile; //!< checkpoint to warm-start from
+    std::string m_checkpointSaveFile; //!< checkpoint written when the env is destroyed
+    std::string m_replayLoadFile;     //!< replay memory to warm-start from
+    std::string m_replaySaveFile;     //!< replay memory written when the env is destroyed
 };
 
 } // namespace ns3
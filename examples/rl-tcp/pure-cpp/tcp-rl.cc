@@ -375,7 +375,7 @@ TcpRlEventBased::CreateEnv()
     //  std::cerr << "in CreateEnv (), this = " << this << std::endl;
     NS_LOG_FUNCTION(this);
     env = CreateObject<TcpEventBasedEnv>();
-    std::cerr << "CreateEnv" << (env == nullptr) << std::endl;
+    NS_LOG_DEBUG("CreateEnv " << (env == nullptr));
     env->SetSocketUuid(TcpRlEventBased::GenerateUuid());
 
     ConnectSocketCallbacks();
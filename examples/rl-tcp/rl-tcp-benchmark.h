@@ -0,0 +1,101 @@
+/*
+ * Copyright (c) 2023 Huazhong University of Science and Technology
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef NS3_RLTCP_BENCHMARK_H
+#define NS3_RLTCP_BENCHMARK_H
+
+#include <ns3/simulator.h>
+
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <string>
+
+/**
+ * \brief Performance counters of an RL-TCP run, shared by the pure-cpp, use-msg and
+ * use-gym variants so that they can be compared side by side.
+ *
+ * The envs time every call to the agent with RecordAgentCall(). For the pure C++
+ * agent, this is the inference (and the learning, unless asynchronous). For the
+ * message and Gym interfaces, this is the whole round trip to Python: IPC and agent.
+ * The main program brackets Simulator::Run() with Begin() and End() and prints one
+ * machine-readable line with Report().
+ */
+class RlTcpBenchmark
+{
+  public:
+    typedef std::chrono::steady_clock Clock;
+
+    static RlTcpBenchmark& Get()
+    {
+        static RlTcpBenchmark benchmark;
+        return benchmark;
+    }
+
+    void Begin()
+    {
+        m_events = ns3::Simulator::GetEventCount();
+        m_begin = Clock::now();
+    }
+
+    void End()
+    {
+        m_wallSeconds = std::chrono::duration<double>(Clock::now() - m_begin).count();
+        m_events = ns3::Simulator::GetEventCount() - m_events;
+    }
+
+    /**
+     * \brief Record one call to the agent.
+     * \param begin When the call started.
+     * \param steps Steps (one per socket) served by the call.
+     * \param ipcRounds C++-Python round trips of the call.
+     */
+    void RecordAgentCall(Clock::time_point begin, uint32_t steps, uint32_t ipcRounds)
+    {
+        m_agentSeconds += std::chrono::duration<double>(Clock::now() - begin).count();
+        m_steps += steps;
+        m_ipcRounds += ipcRounds;
+    }
+
+    /**
+     * \brief Print the counters as one line of space separated key=value pairs.
+     */
+    void Report(const std::string& variant, uint32_t flows, double simSeconds) const
+    {
+        std::cout << "BENCHMARK variant=" << variant << " flows=" << flows
+                  << " sim_s=" << simSeconds << " wall_s=" << m_wallSeconds
+                  << " events=" << m_events
+                  << " events_per_s=" << (m_wallSeconds > 0 ? m_events / m_wallSeconds : 0)
+                  << " wall_per_sim_s=" << (simSeconds > 0 ? m_wallSeconds / simSeconds : 0)
+                  << " steps=" << m_steps << " ipc_rounds=" << m_ipcRounds
+                  << " agent_us_per_step=" << (m_steps ? m_agentSeconds * 1e6 / m_steps : 0)
+                  << " agent_share=" << (m_wallSeconds > 0 ? m_agentSeconds / m_wallSeconds : 0)
+                  << std::endl;
+    }
+
+  private:
+    RlTcpBenchmark() = default;
+
+    Clock::time_point m_begin;
+    double m_wallSeconds{0};  //!< wall-clock time of the run
+    uint64_t m_events{0};     //!< events executed by the run
+    double m_agentSeconds{0}; //!< wall-clock time spent in agent calls
+    uint64_t m_steps{0};      //!< steps served by the agent
+    uint64_t m_ipcRounds{0};  //!< C++-Python round trips
+};
+
+#endif // NS3_RLTCP_BENCHMARK_H
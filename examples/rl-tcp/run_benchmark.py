@@ -0,0 +1,109 @@
+# Copyright (c) 2023 Huazhong University of Science and Technology
+#
+# This program is free software; you can redistribute it and/or modify
+# it under the terms of the GNU General Public License version 2 as
+# published by the Free Software Foundation;
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program; if not, write to the Free Software
+# Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+# Runs the RL-TCP dumbbell with an increasing number of flows for the pure-cpp,
+# use-msg and use-gym variants, and prints their benchmark counters side by side.
+# The C++ executables and the message interface binding must be built beforehand.
+
+import os
+import sys
+import csv
+import argparse
+import subprocess
+
+EXAMPLE_DIR = os.path.dirname(os.path.abspath(__file__))
+NS3_DIR = os.path.abspath(os.path.join(EXAMPLE_DIR, '../../../..'))
+COLUMNS = ['variant', 'flows', 'sim_s', 'wall_s', 'events', 'events_per_s',
+           'wall_per_sim_s', 'steps', 'ipc_rounds', 'agent_us_per_step', 'agent_share']
+
+parser = argparse.ArgumentParser()
+parser.add_argument('--flows', type=str, default='10,100,1000',
+                    help='comma separated numbers of flows (leaf pairs of the dumbbell)')
+parser.add_argument('--variants', type=str, default='pure-cpp,use-msg,use-gym',
+                    help='comma separated variants among pure-cpp, use-msg and use-gym')
+parser.add_argument('--duration', type=float, default=10,
+                    help='simulation duration (seconds)')
+parser.add_argument('--bottleneck_bandwidth', type=str, default='2Mbps')
+parser.add_argument('--bottleneck_delay', type=str, default='0.01ms')
+parser.add_argument('--access_bandwidth', type=str, default='10Mbps')
+parser.add_argument('--access_delay', type=str, default='20ms',
+                    help='access link delay, the base RTT is about four times this value')
+parser.add_argument('--use_rl', action='store_true',
+                    help='use the DQN agents instead of New Reno')
+parser.add_argument('--coalesce', action='store_true',
+                    help='coalesce the steps of use-msg into one vector message')
+parser.add_argument('--batch_inference', action='store_true',
+                    help='share one batched DQN agent among the pure-cpp sockets')
+parser.add_argument('--csv', type=str, help='also write the results to this CSV file')
+args = parser.parse_args()
+
+scenario = {
+    'duration': args.duration,
+    'bottleneck_bandwidth': args.bottleneck_bandwidth,
+    'bottleneck_delay': args.bottleneck_delay,
+    'access_bandwidth': args.access_bandwidth,
+    'access_delay': args.access_delay,
+    'benchmark': 'true'}
+
+
+def command(variant, flows):
+    settings = dict(scenario, nLeaf=flows)
+    if variant == 'pure-cpp':
+        if args.batch_inference:
+            settings['batchInference'] = 'true'
+        program = 'ns3ai_rltcp_purecpp' + ''.join(
+            ' --{}={}'.format(key, value) for key, value in settings.items())
+        return [os.path.join(NS3_DIR, 'ns3'), 'run', program], NS3_DIR
+    # the Python scripts start the simulation themselves
+    cmd = [sys.executable, 'run_rl_tcp.py', '--duration={}'.format(args.duration),
+           '--n_leaf={}'.format(flows)]
+    cmd += ['--ns3_setting={}={}'.format(key, value) for key, value in settings.items()
+            if key not in ('duration', 'nLeaf')]
+    if args.use_rl:
+        cmd.append('--use_rl')
+    if variant == 'use-msg' and args.coalesce:
+        cmd.append('--coalesce')
+    return cmd, os.path.join(EXAMPLE_DIR, variant)
+
+
+def run(variant, flows):
+    cmd, cwd = command(variant, flows)
+    proc = subprocess.run(cmd, cwd=cwd, text=True, stdout=subprocess.PIPE,
+                          stderr=subprocess.DEVNULL)
+    for line in proc.stdout.splitlines():
+        if line.startswith('BENCHMARK '):
+            return dict(item.split('=', 1) for item in line.split()[1:])
+    print('{} with {} flows failed (exit code {})'.format(variant, flows, proc.returncode))
+    return None
+
+
+results = []
+for flows in [int(n) for n in args.flows.split(',')]:
+    for variant in args.variants.split(','):
+        print('Running {} with {} flows...'.format(variant, flows), flush=True)
+        result = run(variant, flows)
+        if result:
+            results.append(result)
+
+print()
+print(''.join('{:>18}'.format(column) for column in COLUMNS))
+for result in results:
+    print(''.join('{:>18}'.format(result.get(column, '-')) for column in COLUMNS))
+
+if args.csv:
+    with open(args.csv, 'w', newline='') as f:
+        writer = csv.DictWriter(f, fieldnames=COLUMNS, extrasaction='ignore')
+        writer.writeheader()
+        writer.writerows(results)
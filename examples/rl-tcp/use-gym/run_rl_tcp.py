@@ -67,6 +67,10 @@ parser.add_argument('--use_rl', action='store_true',
                     help='whether use rl algorithm') #用于指定是否使用强化学习算法。
 parser.add_argument('--rl_algo', type=str,
                     default='DeepQ', help='RL Algorithm, Q or DeepQ') #用于指定强化学习算法的类型，默认为 DeepQ。
+parser.add_argument('--n_leaf', type=int, default=1,
+                    help='number of left and right side leaf nodes (one socket each)')
+parser.add_argument('--ns3_setting', action='append', default=[], metavar='KEY=VALUE',
+                    help='extra command line argument of the simulation, e.g. benchmark=true')
 
 args = parser.parse_args() #使用 parser.parse_args() 解析命令行参数，并将结果存储在 args 变量中。
 
@@ -103,7 +107,9 @@ stepIdx = 0 #设置了一个名为 stepIdx 的变量，初始值为 0。
 ns3Settings = {
     'transport_prot': 'TcpRlTimeBased',
     'duration': my_duration,
-    'simSeed': my_sim_seed}
+    'simSeed': my_sim_seed,
+    'nLeaf': args.n_leaf}
+ns3Settings.update(setting.split('=', 1) for setting in args.ns3_setting)
 #使用 gym.make 创建了一个名为 env 的 OpenAI Gym 环境，使用了自定义的 ns3ai_gym_env 插件。传递给环境的参数包括 targetName、ns3Path 和 ns3Settings。其中，targetName 是 ns3ai_rltcp_gym，ns3Path 是 "../../../../../"，而 ns3Settings 则是上一步中定义的字典。
 env = gym.make("ns3ai_gym_env/Ns3-v0", targetName="ns3ai_rltcp_gym",
                ns3Path="../../../../../", ns3Settings=ns3Settings)
@@ -30,6 +30,8 @@
  *
  */
 
+#include "../rl-tcp-benchmark.h"
+
 #include "ns3/ai-module.h"
 #include "ns3/applications-module.h"
 #include "ns3/core-module.h"
@@ -90,6 +92,7 @@ main(int argc, char* argv[])
     double duration = 1000.0;  //表示模拟持续时间，值为 1000.0，表示模拟持续时间为 1000 秒。
     uint32_t run = 0;         //表示运行次数，值为 0，表示没有指定运行次数。
     bool flow_monitor = false;  //表示是否启用流量监测，值为 false，表示不启用流量监测。
+    bool benchmark = false;
     bool sack = true;           //表示是否启用选择性确认 (SACK)，值为 true，表示启用 SACK。
     std::string queue_disc_type = "ns3::PfifoFastQueueDisc";   //表示队列调度类型，值为 "ns3::PfifoFastQueueDisc"，表示使用 ns3 中提供的先进先出快速队列调度器。
     std::string recovery = "ns3::TcpClassicRecovery";          //表示恢复策略，值为 "ns3::TcpClassicRecovery"，表示使用 ns3 中提供的经典 TCP 恢复策略。
@@ -117,6 +120,9 @@ main(int argc, char* argv[])
     cmd.AddValue("mtu", "Size of IP packets to send in bytes", mtu_bytes);       //指定要发送的 IP 数据包的大小（以字节为单位）。
     cmd.AddValue("duration", "Time to allow flows to run in seconds", duration); //指定允许流量运行的时间（以秒为单位）。
     cmd.AddValue("flow_monitor", "Enable flow monitor", flow_monitor);           //启用或禁用流量监测。
+    cmd.AddValue("benchmark",
+                 "Print events/s, wall-clock time, IPC rounds and agent time",
+                 benchmark);
     cmd.AddValue("queue_disc_type",
                  "Queue disc type for gateway (e.g. ns3::CoDelQueueDisc)",
                  queue_disc_type);                                              //指定网关的队列调度类型（例如，"ns3::CoDelQueueDisc"）。
@@ -310,7 +316,9 @@ main(int argc, char* argv[])
 
     //设置仿真停止时间，确保仿真在达到指定的 stop_time 后停止运行。
     Simulator::Stop(Seconds(stop_time));
+    RlTcpBenchmark::Get().Begin();
     Simulator::Run();//运行仿真：直到达到设定的停止时间。
+    RlTcpBenchmark::Get().End();
 
     //序列化流量监视器信息到 XML 文件：
     //如果启用了流量监视器 (flow_monitor 为真)，则使用 flowHelper.SerializeToXmlFile 将流量监视器的信息保存到 XML 文件中。这包括有关仿真期间数据包流量的详细信息。
@@ -327,6 +335,10 @@ main(int argc, char* argv[])
     }
 
     PrintRxCount();//打印接收数据包数量：调用一个函数，该函数可能用于打印每个节点接收到的数据包数量的信息。
+    if (benchmark)
+    {
+        RlTcpBenchmark::Get().Report("use-gym", nLeaf, Simulator::Now().GetSeconds());
+    }
     Simulator::Destroy();//销毁仿真：释放仿真资源，确保正确结束仿真。
     return 0;
 }
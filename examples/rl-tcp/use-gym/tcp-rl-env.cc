@@ -20,6 +20,8 @@
 
 #include "tcp-rl-env.h"
 
+#include "../rl-tcp-benchmark.h"
+
 #include "ns3/core-module.h"
 #include "ns3/log.h"
 #include "ns3/object.h"
@@ -27,7 +29,6 @@
 #include "ns3/tcp-header.h"
 #include "ns3/tcp-socket-base.h"
 
-#include <numeric>
 #include <vector>
 
 namespace ns3
@@ -35,6 +36,15 @@ namespace ns3
 
 NS_LOG_COMPONENT_DEFINE("tcp-rl-env-gym");
 
+/**
+ * Names of the features available to the reporting policy, in the order of the values
+ * passed by TcpEnvBase::ShouldReport()
+ */
+static const std::vector<std::string> g_reportFeatureNames = {"cWnd",
+                                                              "ssThresh",
+                                                              "bytesInFlight",
+                                                              "rtt"};
+
 NS_OBJECT_ENSURE_REGISTERED(TcpEnvBase);
 
 TcpEnvBase::TcpEnvBase()
@@ -54,7 +64,31 @@ TypeId
 TcpEnvBase::GetTypeId()
 //这个函数的作用是为 TcpEnvBase 类提供唯一的类型标识符，以便在其他地方使用该类时能够唯一地识别它。类型标识符通常用于动态类型识别、反射和序列化等操作。
 {
-    static TypeId tid = TypeId("ns3::TcpEnvBase").SetParent<OpenGymEnv>().SetGroupName("Ns3Ai");
+    static TypeId tid =
+        TypeId("ns3::TcpEnvBase")
+            .SetParent<OpenGymEnv>()
+            .SetGroupName("Ns3Ai")
+            .AddAttribute("ReportFeatures",
+                          Ns3AiReportPolicy::GetFeaturesHelp(g_reportFeatureNames),
+                          StringValue(""),
+                          MakeStringAccessor(&TcpEnvBase::m_reportFeatures),
+                          MakeStringChecker())
+            .AddAttribute("ReportAbsThreshold",
+                          std::string(Ns3AiReportPolicy::ABS_THRESHOLD_HELP) +
+                              ". Unit: bytes, or us for rtt",
+                          DoubleValue(0),
+                          MakeDoubleAccessor(&TcpEnvBase::m_reportAbsThreshold),
+                          MakeDoubleChecker<double>(0))
+            .AddAttribute("ReportRelThreshold",
+                          Ns3AiReportPolicy::REL_THRESHOLD_HELP,
+                          DoubleValue(0),
+                          MakeDoubleAccessor(&TcpEnvBase::m_reportRelThreshold),
+                          MakeDoubleChecker<double>(0))
+            .AddAttribute("ReportMaxSilence",
+                          Ns3AiReportPolicy::MAX_SILENCE_HELP,
+                          TimeValue(Seconds(0)),
+                          MakeTimeAccessor(&TcpEnvBase::m_reportMaxSilence),
+                          MakeTimeChecker());
 
     return tid;
 }
@@ -66,6 +100,54 @@ TcpEnvBase::DoDispose()
 //当需要销毁 TcpEnvBase 类或其子类的对象时，可以调用 DoDispose 函数来释放资源并执行清理操作。这有助于确保资源的正确释放，避免内存泄漏等问题。
 {
     NS_LOG_FUNCTION(this);
+    NS_LOG_INFO("Socket " << m_socketUuid << " reports sent: " << m_reportPolicy.GetReportedCount()
+                          << ", suppressed: " << m_reportPolicy.GetSuppressedCount());
+}
+
+void
+TcpEnvBase::NotifyConstructionCompleted()
+{
+    OpenGymEnv::NotifyConstructionCompleted();
+    m_reportPolicy.Configure(m_reportFeatures,
+                             g_reportFeatureNames,
+                             m_reportAbsThreshold,
+                             m_reportRelThreshold,
+                             m_reportMaxSilence);
+}
+
+bool
+TcpEnvBase::ShouldReport(Ptr<const TcpSocketState> tcb, Time rtt)
+{
+    bool report = m_reportPolicy.ShouldReport({static_cast<double>(tcb->m_cWnd.Get()),
+                                               static_cast<double>(tcb->m_ssThresh.Get()),
+                                               static_cast<double>(tcb->m_bytesInFlight.Get()),
+                                               static_cast<double>(rtt.GetMicroSeconds())});
+    if (!report)
+    {
+        NS_LOG_DEBUG("Socket " << m_socketUuid << " report suppressed, total "
+                               << m_reportPolicy.GetSuppressedCount());
+    }
+    return report;
+}
+
+void
+TcpEnvBase::NotifyAgent()
+{
+    Ptr<OpenGymInterface> openGymInterface = OpenGymInterface::Get();
+    uint64_t exchanges = openGymInterface->GetExchangeCount();
+    auto begin = RlTcpBenchmark::Clock::now();
+    Notify();
+    // steps re-applying a held action do not reach Python, like in the message interface
+    if (openGymInterface->GetExchangeCount() > exchanges)
+    {
+        RlTcpBenchmark::Get().RecordAgentCall(begin, 1, 1);
+    }
+}
+
+uint64_t
+TcpEnvBase::GetSuppressedReports() const
+{
+    return m_reportPolicy.GetSuppressedCount();
 }
 
 void
@@ -249,7 +331,17 @@ TcpTimeStepEnv::ScheduleNextStateRead()
     NS_LOG_FUNCTION(this);
     Simulator::Schedule(m_timeStep, &TcpTimeStepEnv::ScheduleNextStateRead, this);
     //该函数使用了 Simulator 类的 Schedule() 方法来安排一个定时事件，该事件将在指定的时间间隔（m_timeStep）后触发。在这个例子中，定时事件的处理函数是 TcpTimeStepEnv::ScheduleNextStateRead 本身，并且参数是 this 指针，这意味着定时事件将在当前对象上触发。
-    Notify();
+    Time avgRtt = Seconds(0.0);
+    if (m_rttSampleNum)
+    {
+        avgRtt = m_rttSum / m_rttSampleNum;
+    }
+    // statistics keep accumulating until the next report
+    if (!ShouldReport(m_tcb, avgRtt))
+    {
+        return;
+    }
+    NotifyAgent();
     //函数使用 Notify() 方法来通知其他对象或观察者关于定时事件的安排。这个通知可能用于协调其他对象的操作或进行状态更新。
 }
 
@@ -342,26 +434,26 @@ TcpTimeStepEnv::GetObservation() //初始化
 
     //向 box 中添加与 TCP（传输控制协议）相关的各种参数，如套接字 UUID、节点 ID、慢启动阈值、拥塞窗口、段大小、在飞行中的字节数、已确认的段数、平均往返时延（RTT）、最小 RTT、平均传输间隔、平均接收间隔和吞吐量。
     // bytesInFlightSum
-    uint64_t bytesInFlightSum = std::accumulate(m_bytesInFlight.begin(), m_bytesInFlight.end(), 0);
+    uint64_t bytesInFlightSum = m_bytesInFlight.GetSum();
     box->AddValue(bytesInFlightSum);
 
     // bytesInFlightAvg
     uint64_t bytesInFlightAvg = 0;
-    if (!m_bytesInFlight.empty())
+    if (m_bytesInFlight.GetCount() > 0)
     {
-        bytesInFlightAvg = bytesInFlightSum / m_bytesInFlight.size();
+        bytesInFlightAvg = bytesInFlightSum / m_bytesInFlight.GetCount();
     }
     box->AddValue(bytesInFlightAvg);
 
     // segmentsAckedSum
-    uint64_t segmentsAckedSum = std::accumulate(m_segmentsAcked.begin(), m_segmentsAcked.end(), 0);
+    uint64_t segmentsAckedSum = m_segmentsAcked.GetSum();
     box->AddValue(segmentsAckedSum);
 
     // segmentsAckedAvg
     uint64_t segmentsAckedAvg = 0;
-    if (!m_segmentsAcked.empty())
+    if (m_segmentsAcked.GetCount() > 0)
     {
-        segmentsAckedAvg = segmentsAckedSum / m_segmentsAcked.size();
+        segmentsAckedAvg = segmentsAckedSum / m_segmentsAcked.GetCount();
     }
     box->AddValue(segmentsAckedAvg);
 
@@ -393,15 +485,22 @@ TcpTimeStepEnv::GetObservation() //初始化
     box->AddValue(avgInterRx.GetMicroSeconds());
 
     // throughput  bytes/s
-    float throughput = (segmentsAckedSum * m_tcb->m_segmentSize) / m_timeStep.GetSeconds();
+    // a report may cover several steps when the reporting policy suppressed some
+    Time interval = m_timeStep;
+    if (m_lastObservationTime.IsStrictlyPositive() && Simulator::Now() > m_lastObservationTime)
+    {
+        interval = Simulator::Now() - m_lastObservationTime;
+    }
+    m_lastObservationTime = Simulator::Now();
+    float throughput = (segmentsAckedSum * m_tcb->m_segmentSize) / interval.GetSeconds();
     box->AddValue(throughput);
 
     // Print data 使用 NS-3 日志记录（NS_LOG_INFO）记录 box 中的数据
     NS_LOG_INFO("MyGetObservation: " << box);
 
     //清空或重置各种数据结构，为下一次生成观测数据做准备。
-    m_bytesInFlight.clear();
-    m_segmentsAcked.clear();
+    m_bytesInFlight.Reset();
+    m_segmentsAcked.Reset();
 
     m_rttSampleNum = 0;
     m_rttSum = MicroSeconds(0.0);
@@ -469,7 +568,7 @@ TcpTimeStepEnv::GetSsThresh(Ptr<const TcpSocketState> tcb, uint32_t bytesInFligh
     //使用 NS-3 的日志功能记录函数调用，包括当前对象的地址（this）、模拟时间、节点 ID 以及当前的字节数。
     
     m_tcb = tcb;  //将传递给函数的 tcb 参数保存到成员变量 m_tcb 中。
-    m_bytesInFlight.push_back(bytesInFlight);  //将当前的 bytesInFlight 添加到成员变量 m_bytesInFlight 中，这是一个存储字节数的容器。
+    m_bytesInFlight.Add(bytesInFlight);  //将当前的 bytesInFlight 添加到成员变量 m_bytesInFlight 中，这是一个存储字节数的容器。
 
     if (!m_started)
     {
@@ -493,8 +592,8 @@ TcpTimeStepEnv::IncreaseWindow(Ptr<TcpSocketState> tcb, uint32_t segmentsAcked)
     NS_LOG_INFO(Simulator::Now() << " Node: " << m_nodeId
                                  << " IncreaseWindow, SegmentsAcked: " << segmentsAcked);
     m_tcb = tcb;  //将传递给函数的 tcb 参数保存到成员变量 m_tcb 中，表示当前 TCP 套接字的状态。
-    m_segmentsAcked.push_back(segmentsAcked);  //将 segmentsAcked 添加到成员变量 m_segmentsAcked 中，这是一个存储被确认数据段数量的容器。
-    m_bytesInFlight.push_back(tcb->m_bytesInFlight); //将套接字的字节数添加到成员变量 m_bytesInFlight 中，这是一个存储字节数的容器。
+    m_segmentsAcked.Add(segmentsAcked);  //将 segmentsAcked 添加到成员变量 m_segmentsAcked 中，这是一个存储被确认数据段数量的容器。
+    m_bytesInFlight.Add(tcb->m_bytesInFlight); //将套接字的字节数添加到成员变量 m_bytesInFlight 中，这是一个存储字节数的容器。
 
     if (!m_started)
     {
@@ -699,7 +798,10 @@ TcpEventBasedEnv::GetSsThresh(Ptr<const TcpSocketState> tcb, uint32_t bytesInFli
     m_info = "GetSsThresh";
     m_tcb = tcb;
     m_bytesInFlight = bytesInFlight;
-    Notify();
+    if (ShouldReport(tcb, m_rtt))
+    {
+        NotifyAgent();
+    }
     return m_new_ssThresh;  //函数返回一个 uint32_t 类型的值 m_new_ssThresh，但没有说明该值的具体含义。
 }
 
@@ -718,7 +820,10 @@ TcpEventBasedEnv::IncreaseWindow(Ptr<TcpSocketState> tcb, uint32_t segmentsAcked
     m_info = "IncreaseWindow";
     m_tcb = tcb;
     m_segmentsAcked = segmentsAcked; //将传递给函数的 segmentsAcked 参数保存到成员变量 m_segmentsAcked 中，表示已确认的 TCP 段的数量。
-    Notify(); //通过调用 Notify() 函数通知相关的观察者（observers）。
+    if (ShouldReport(tcb, m_rtt))
+    {
+        NotifyAgent(); //通过调用 Notify() 函数通知相关的观察者（observers）。
+    }
     tcb->m_cWnd = m_new_cWnd;
 }
 
@@ -80,7 +80,28 @@ class TcpEnvBase : public OpenGymEnv
         CWND_EVENT,
     } CalledFunc_t;
 
+    /**
+     * \brief Get the number of reports suppressed by the reporting policy.
+     */
+    uint64_t GetSuppressedReports() const;
+
   protected:
+    /**
+     * \brief Whether the current state should be reported to the agent, according
+     * to the Report* attributes. If not, the last action stays in force.
+     */
+    bool ShouldReport(Ptr<const TcpSocketState> tcb, Time rtt);
+
+    /**
+     * \brief Configure the reporting policy once the attributes are set.
+     */
+    void NotifyConstructionCompleted() override;
+
+    /**
+     * \brief Notify the agent of the current state and time the round trip.
+     */
+    void NotifyAgent();
+
     uint32_t m_nodeId;
     uint32_t m_socketUuid;
 
@@ -96,6 +117,13 @@ class TcpEnvBase : public OpenGymEnv
     // actions
     uint32_t m_new_ssThresh;
     uint32_t m_new_cWnd;
+
+  private:
+    Ns3AiReportPolicy m_reportPolicy;
+    std::string m_reportFeatures;
+    double m_reportAbsThreshold;
+    double m_reportRelThreshold;
+    Time m_reportMaxSilence;
 };
 
 class TcpTimeStepEnv : public TcpEnvBase
@@ -127,10 +155,11 @@ class TcpTimeStepEnv : public TcpEnvBase
     void ScheduleNextStateRead();
     bool m_started{false};
     Time m_timeStep;
+    Time m_lastObservationTime{Seconds(0.0)};
     // state
     Ptr<const TcpSocketState> m_tcb;
-    std::vector<uint32_t> m_bytesInFlight;
-    std::vector<uint32_t> m_segmentsAcked;
+    Ns3AiStreamStats m_bytesInFlight;
+    Ns3AiStreamStats m_segmentsAcked;
 
     uint64_t m_rttSampleNum{0};
     Time m_rttSum{MicroSeconds(0.0)};
@@ -30,6 +30,8 @@
  *
  */
 
+#include "../rl-tcp-benchmark.h"
+
 #include "ns3/ai-module.h"
 #include "ns3/applications-module.h"
 #include "ns3/core-module.h"
@@ -75,6 +77,7 @@ int
 main(int argc, char* argv[])
 {
     double tcpEnvTimeStep = 0.1;
+    bool coalesceSteps = false;
     uint32_t nLeaf = 1;
     std::string transport_prot = "TcpRlTimeBased";
     double error_p = 0.0;
@@ -88,6 +91,7 @@ main(int argc, char* argv[])
     double duration = 1000.0;
     uint32_t run = 0;
     bool flow_monitor = false;
+    bool benchmark = false;
     bool sack = true;
     std::string queue_disc_type = "ns3::PfifoFastQueueDisc";
     std::string recovery = "ns3::TcpClassicRecovery";
@@ -99,6 +103,9 @@ main(int argc, char* argv[])
     cmd.AddValue("envTimeStep",
                  "Time step interval for TcpRlTimeBased. Default: 0.1s",
                  tcpEnvTimeStep);
+    cmd.AddValue("coalesceSteps",
+                 "Exchange the steps of all TcpRlTimeBased sockets in one vector message",
+                 coalesceSteps);
     cmd.AddValue("nLeaf", "Number of left and right side leaf nodes", nLeaf);
     cmd.AddValue("transport_prot",
                  "Transport protocol to use: TcpNewReno, TcpHybla, TcpHighSpeed, TcpHtcp, "
@@ -115,6 +122,9 @@ main(int argc, char* argv[])
     cmd.AddValue("mtu", "Size of IP packets to send in bytes", mtu_bytes);
     cmd.AddValue("duration", "Time to allow flows to run in seconds", duration);
     cmd.AddValue("flow_monitor", "Enable flow monitor", flow_monitor);
+    cmd.AddValue("benchmark",
+                 "Print events/s, wall-clock time, IPC rounds and agent time",
+                 benchmark);
     cmd.AddValue("queue_disc_type",
                  "Queue disc type for gateway (e.g. ns3::CoDelQueueDisc)",
                  queue_disc_type);
@@ -129,6 +139,7 @@ main(int argc, char* argv[])
     if (transport_prot == "TcpRlTimeBased")
     {
         Config::SetDefault("ns3::TcpTimeStepEnv::StepTime", TimeValue(Seconds(tcpEnvTimeStep)));
+        Config::SetDefault("ns3::TcpTimeStepEnv::CoalesceSteps", BooleanValue(coalesceSteps));
     }
 
     transport_prot = std::string("ns3::") + transport_prot;
@@ -279,7 +290,9 @@ main(int argc, char* argv[])
     }
 
     Simulator::Stop(Seconds(stop_time));
+    RlTcpBenchmark::Get().Begin();
     Simulator::Run();
+    RlTcpBenchmark::Get().End();
 
     if (flow_monitor)
     {
@@ -287,6 +300,10 @@ main(int argc, char* argv[])
     }
 
     PrintRxCount();
+    if (benchmark)
+    {
+        RlTcpBenchmark::Get().Report("use-msg", nLeaf, Simulator::Now().GetSeconds());
+    }
     Simulator::Destroy();
     return 0;
 }
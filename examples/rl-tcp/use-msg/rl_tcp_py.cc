@@ -25,10 +25,18 @@
 
 #include <ns3/ai-module.h>
 
+#include <iostream>
 #include <pybind11/pybind11.h>
+#include <pybind11/stl.h>
 
 namespace py = pybind11;
 
+PYBIND11_MAKE_OPAQUE(ns3::Ns3AiMsgInterfaceImpl<ns3::TcpRlEnv, ns3::TcpRlAct>::Cpp2PyMsgVector);
+PYBIND11_MAKE_OPAQUE(ns3::Ns3AiMsgInterfaceImpl<ns3::TcpRlEnv, ns3::TcpRlAct>::Py2CppMsgVector);
+
+using TcpRlEnvVector = ns3::Ns3AiMsgInterfaceImpl<ns3::TcpRlEnv, ns3::TcpRlAct>::Cpp2PyMsgVector;
+using TcpRlActVector = ns3::Ns3AiMsgInterfaceImpl<ns3::TcpRlEnv, ns3::TcpRlAct>::Py2CppMsgVector;
+
 PYBIND11_MODULE(ns3ai_rltcp_msg_py, m)
 {
     py::class_<ns3::TcpRlEnv>(m, "PyEnvStruct")
@@ -41,12 +49,94 @@ PYBIND11_MODULE(ns3ai_rltcp_msg_py, m)
         .def_readwrite("cWnd", &ns3::TcpRlEnv::cWnd)
         .def_readwrite("segmentSize", &ns3::TcpRlEnv::segmentSize)
         .def_readwrite("segmentsAcked", &ns3::TcpRlEnv::segmentsAcked)
-        .def_readwrite("bytesInFlight", &ns3::TcpRlEnv::bytesInFlight);
+        .def_readwrite("bytesInFlight", &ns3::TcpRlEnv::bytesInFlight)
+        .def_readwrite("heldSteps", &ns3::TcpRlEnv::heldSteps);
 
     py::class_<ns3::TcpRlAct>(m, "PyActStruct")
         .def(py::init<>())
         .def_readwrite("new_ssThresh", &ns3::TcpRlAct::new_ssThresh)
-        .def_readwrite("new_cWnd", &ns3::TcpRlAct::new_cWnd);
+        .def_readwrite("new_cWnd", &ns3::TcpRlAct::new_cWnd)
+        .def_readwrite("repeat", &ns3::TcpRlAct::repeat);
+
+    // vectors of coalesced steps (CoalesceSteps), one record per socket
+    py::class_<TcpRlEnvVector>(m, "PyEnvVector")
+        .def("resize",
+             static_cast<void (TcpRlEnvVector::*)(TcpRlEnvVector::size_type)>(
+                 &TcpRlEnvVector::resize))
+        .def("__len__", &TcpRlEnvVector::size)
+        .def(
+            "__getitem__",
+            [](TcpRlEnvVector& vec, uint32_t i) -> ns3::TcpRlEnv& {
+                if (i >= vec.size())
+                {
+                    std::cerr << "Invalid index " << i << " for vector, whose size is "
+                              << vec.size() << std::endl;
+                    exit(1);
+                }
+                return vec.at(i);
+            },
+            py::return_value_policy::reference)
+        .def(
+            "get_obs",
+            [](TcpRlEnvVector& vec) {
+                // socket ids and [ssThresh, cWnd, segmentsAcked, segmentSize, bytesInFlight]
+                std::vector<uint32_t> socketIds;
+                std::vector<std::vector<uint32_t>> obs;
+                socketIds.reserve(vec.size());
+                obs.reserve(vec.size());
+                for (const auto& env : vec)
+                {
+                    socketIds.push_back(env.socketUid);
+                    obs.push_back({env.ssThresh,
+                                   env.cWnd,
+                                   env.segmentsAcked,
+                                   env.segmentSize,
+                                   env.bytesInFlight});
+                }
+                return py::make_tuple(socketIds, obs);
+            },
+            "Return the socket ids and the observations of all records at once");
+
+    py::class_<TcpRlActVector>(m, "PyActVector")
+        .def("resize",
+             static_cast<void (TcpRlActVector::*)(TcpRlActVector::size_type)>(
+                 &TcpRlActVector::resize))
+        .def("__len__", &TcpRlActVector::size)
+        .def(
+            "__getitem__",
+            [](TcpRlActVector& vec, uint32_t i) -> ns3::TcpRlAct& {
+                if (i >= vec.size())
+                {
+                    std::cerr << "Invalid index " << i << " for vector, whose size is "
+                              << vec.size() << std::endl;
+                    exit(1);
+                }
+                return vec.at(i);
+            },
+            py::return_value_policy::reference)
+        .def(
+            "set_actions",
+            [](TcpRlActVector& vec,
+               const std::vector<std::vector<uint32_t>>& acts,
+               uint32_t repeat) {
+                // one [new_cWnd, new_ssThresh] per record, in the order of the observations
+                vec.resize(acts.size());
+                for (size_t i = 0; i < acts.size(); i++)
+                {
+                    if (acts[i].size() != 2)
+                    {
+                        std::cerr << "Action " << i << " must be [new_cWnd, new_ssThresh]"
+                                  << std::endl;
+                        exit(1);
+                    }
+                    vec[i].new_cWnd = acts[i][0];
+                    vec[i].new_ssThresh = acts[i][1];
+                    vec[i].repeat = repeat;
+                }
+            },
+            py::arg("acts"),
+            py::arg("repeat") = 0,
+            "Set the actions of all records at once");
 
     py::class_<ns3::Ns3AiMsgInterfaceImpl<ns3::TcpRlEnv, ns3::TcpRlAct>>(m, "Ns3AiMsgInterfaceImpl")
         .def(py::init<bool,
@@ -68,5 +158,11 @@ PYBIND11_MODULE(ns3ai_rltcp_msg_py, m)
              py::return_value_policy::reference)
         .def("GetPy2CppStruct",
              &ns3::Ns3AiMsgInterfaceImpl<ns3::TcpRlEnv, ns3::TcpRlAct>::GetPy2CppStruct,
+             py::return_value_policy::reference)
+        .def("GetCpp2PyVector",
+             &ns3::Ns3AiMsgInterfaceImpl<ns3::TcpRlEnv, ns3::TcpRlAct>::GetCpp2PyVector,
+             py::return_value_policy::reference)
+        .def("GetPy2CppVector",
+             &ns3::Ns3AiMsgInterfaceImpl<ns3::TcpRlEnv, ns3::TcpRlAct>::GetPy2CppVector,
              py::return_value_policy::reference);
 }
@@ -68,6 +68,14 @@ parser.add_argument('--use_rl', action='store_true',
                     help='whether use rl algorithm')
 parser.add_argument('--rl_algo', type=str,
                     default='DeepQ', help='RL Algorithm, Q or DeepQ')
+parser.add_argument('--action_repeat', type=int, default=0,
+                    help='number of following time steps on which ns-3 repeats an action')
+parser.add_argument('--n_leaf', type=int, default=1,
+                    help='number of left and right side leaf nodes (one socket each)')
+parser.add_argument('--coalesce', action='store_true',
+                    help='exchange the steps of all sockets in one vector message')
+parser.add_argument('--ns3_setting', action='append', default=[], metavar='KEY=VALUE',
+                    help='extra command line argument of the simulation, e.g. benchmark=true')
 
 args = parser.parse_args()
 my_seed = 42
@@ -101,12 +109,52 @@ stepIdx = 0
 ns3Settings = {
     'transport_prot': 'TcpRlTimeBased',
     'duration': my_duration,
-    'simSeed': my_sim_seed}
-exp = Experiment("ns3ai_rltcp_msg", "../../../../../", py_binding, handleFinish=True)
+    'simSeed': my_sim_seed,
+    'nLeaf': args.n_leaf}
+ns3Settings.update(setting.split('=', 1) for setting in args.ns3_setting)
+if args.coalesce:
+    # one record per socket, and some room for the growth of the vectors
+    ns3Settings['coalesceSteps'] = 'true'
+    exp = Experiment("ns3ai_rltcp_msg", "../../../../../", py_binding, handleFinish=True,
+                     useVector=True, vectorSize=args.n_leaf, shmSize=4096 + 128 * args.n_leaf)
+else:
+    exp = Experiment("ns3ai_rltcp_msg", "../../../../../", py_binding, handleFinish=True)
 msgInterface = exp.run(setting=ns3Settings, show_output=True)
 
-try:
+
+def run_coalesced():
+    global stepIdx
     while True:
+        # receive the observations of all sockets stepping at this time
+        msgInterface.PyRecvBegin()
+        if msgInterface.PyGetFinished():
+            print("Simulation ended")
+            break
+        socketIds, obsList = msgInterface.GetCpp2PyVector().get_obs()
+        msgInterface.PyRecvEnd()
+
+        actList = []
+        for socketId, obs in zip(socketIds, obsList):
+            if args.show_log:
+                print("Recv obs:", obs)
+            if args.result:
+                for i, res in enumerate(res_list):
+                    globals()[res].append(obs[i])
+            actList.append(get_agent(socketId, args.use_rl).get_action(obs))
+
+        # send the actions to C++, in the order of the observations
+        msgInterface.PySendBegin()
+        msgInterface.GetPy2CppVector().set_actions(actList, args.action_repeat)
+        msgInterface.PySendEnd()
+
+        if args.show_log:
+            print("Step:", stepIdx)
+            stepIdx += 1
+            print("Send act:", actList)
+
+
+try:
+    while not args.coalesce:
         # receive observation from C++
         msgInterface.PyRecvBegin()
         if msgInterface.PyGetFinished():
@@ -118,11 +166,12 @@ try:
         segmentSize = msgInterface.GetCpp2PyStruct().segmentSize
         bytesInFlight = msgInterface.GetCpp2PyStruct().bytesInFlight
         socketId = msgInterface.GetCpp2PyStruct().socketUid
+        heldSteps = msgInterface.GetCpp2PyStruct().heldSteps
         msgInterface.PyRecvEnd()
 
         obs = [ssThresh, cWnd, segmentsAcked, segmentSize, bytesInFlight]
         if args.show_log:
-            print("Recv obs:", obs)
+            print("Recv obs:", obs, "held steps:", heldSteps)
 
         if args.result:
             for res in res_list:
@@ -137,6 +186,7 @@ try:
         msgInterface.PySendBegin()
         msgInterface.GetPy2CppStruct().new_cWnd = new_cWnd
         msgInterface.GetPy2CppStruct().new_ssThresh = new_ssThresh
+        msgInterface.GetPy2CppStruct().repeat = args.action_repeat
         msgInterface.PySendEnd()
 
         if args.show_log:
@@ -144,6 +194,9 @@ try:
             stepIdx += 1
             print("Send act:", act)
 
+    if args.coalesce:
+        run_coalesced()
+
 except Exception as e:
     exc_type, exc_value, exc_traceback = sys.exc_info()
     print("Exception occurred: {}".format(e))
@@ -22,14 +22,80 @@
 
 #include "tcp-rl-env.h"
 
+#include "../rl-tcp-benchmark.h"
+
+#include <ns3/ns3-ai-step-batcher.h>
+
+#include <algorithm>
 #include <iostream>
-#include <numeric>
 
 namespace ns3
 {
 
 NS_LOG_COMPONENT_DEFINE("tcp-rl-env-msg");
 
+/**
+ * Names of the features available to the reporting policy, in the order of
+ * GetReportFeatureValues()
+ */
+static const std::vector<std::string> g_reportFeatureNames = {"cWnd",
+                                                              "ssThresh",
+                                                              "bytesInFlight",
+                                                              "rtt"};
+
+static std::vector<double>
+GetReportFeatureValues(Ptr<const TcpSocketState> tcb, Time rttSum, uint64_t rttSampleNum)
+{
+    Time avgRtt = rttSampleNum ? rttSum / rttSampleNum : Seconds(0.0);
+    return {static_cast<double>(tcb->m_cWnd.Get()),
+            static_cast<double>(tcb->m_ssThresh.Get()),
+            static_cast<double>(tcb->m_bytesInFlight.Get()),
+            static_cast<double>(avgRtt.GetMicroSeconds())};
+}
+
+namespace
+{
+
+/// Exchanges the states of all sockets stepping at the same time in one vector message
+struct TcpRlStepCoalescer
+{
+    TcpRlStepCoalescer()
+    {
+        batcher.SetBatchHandler(MakeCallback(&TcpRlStepCoalescer::Exchange, this));
+    }
+
+    void Exchange(const std::vector<TcpRlEnv>& envs, std::vector<TcpRlAct>& acts)
+    {
+        Ns3AiMsgInterfaceImpl<TcpRlEnv, TcpRlAct>* msgInterface =
+            Ns3AiMsgInterface::Get()->GetInterface<TcpRlEnv, TcpRlAct>();
+
+        // the vector size is the number of records, Python replies with as many actions
+        auto begin = RlTcpBenchmark::Clock::now();
+        msgInterface->CppSendBegin();
+        msgInterface->GetCpp2PyVector()->assign(envs.begin(), envs.end());
+        msgInterface->CppSendEnd();
+
+        msgInterface->CppRecvBegin();
+        auto actVector = msgInterface->GetPy2CppVector();
+        NS_ABORT_MSG_IF(actVector->size() != envs.size(),
+                        "Expected " << envs.size() << " actions, got " << actVector->size());
+        std::copy(actVector->begin(), actVector->end(), acts.begin());
+        msgInterface->CppRecvEnd();
+        RlTcpBenchmark::Get().RecordAgentCall(begin, envs.size(), 1);
+    }
+
+    Ns3AiStepBatcher<TcpRlEnv, TcpRlAct> batcher;
+};
+
+TcpRlStepCoalescer&
+GetStepCoalescer()
+{
+    static TcpRlStepCoalescer coalescer;
+    return coalescer;
+}
+
+} // namespace
+
 NS_OBJECT_ENSURE_REGISTERED(TcpTimeStepEnv);
 
 TcpTimeStepEnv::TcpTimeStepEnv()
@@ -37,13 +103,14 @@ TcpTimeStepEnv::TcpTimeStepEnv()
     //    std::cerr << "in TcpTimeStepEnv(), this = " << this << std::endl;
     auto interface = Ns3AiMsgInterface::Get();
     interface->SetIsMemoryCreator(false);
-    interface->SetUseVector(false);
     interface->SetHandleFinish(true);
 }
 
 TcpTimeStepEnv::~TcpTimeStepEnv()
 {
     //    std::cerr << "in ~TcpTimeStepEnv(), this = " << this << std::endl;
+    NS_LOG_INFO("Socket " << m_socketUuid << " reports sent: " << m_reportPolicy.GetReportedCount()
+                          << ", suppressed: " << m_reportPolicy.GetSuppressedCount());
 }
 
 TypeId
@@ -57,6 +124,35 @@ TcpTimeStepEnv::GetTypeId()
                                           "Step interval used in TCP env. Default: 100ms",
                                           TimeValue(MilliSeconds(100)),
                                           MakeTimeAccessor(&TcpTimeStepEnv::m_timeStep),
+                                          MakeTimeChecker())
+                            .AddAttribute("CoalesceSteps",
+                                          "Align the steps of all sockets to multiples of "
+                                          "StepTime and exchange the states and actions of the "
+                                          "sockets stepping at the same time in one vector "
+                                          "message. Python must use the vector interface",
+                                          BooleanValue(false),
+                                          MakeBooleanAccessor(&TcpTimeStepEnv::m_coalesceSteps),
+                                          MakeBooleanChecker())
+                            .AddAttribute("ReportFeatures",
+                                          Ns3AiReportPolicy::GetFeaturesHelp(g_reportFeatureNames),
+                                          StringValue(""),
+                                          MakeStringAccessor(&TcpTimeStepEnv::m_reportFeatures),
+                                          MakeStringChecker())
+                            .AddAttribute("ReportAbsThreshold",
+                                          std::string(Ns3AiReportPolicy::ABS_THRESHOLD_HELP) +
+                                              ". Unit: bytes, or us for rtt",
+                                          DoubleValue(0),
+                                          MakeDoubleAccessor(&TcpTimeStepEnv::m_reportAbsThreshold),
+                                          MakeDoubleChecker<double>(0))
+                            .AddAttribute("ReportRelThreshold",
+                                          Ns3AiReportPolicy::REL_THRESHOLD_HELP,
+                                          DoubleValue(0),
+                                          MakeDoubleAccessor(&TcpTimeStepEnv::m_reportRelThreshold),
+                                          MakeDoubleChecker<double>(0))
+                            .AddAttribute("ReportMaxSilence",
+                                          Ns3AiReportPolicy::MAX_SILENCE_HELP,
+                                          TimeValue(Seconds(0)),
+                                          MakeTimeAccessor(&TcpTimeStepEnv::m_reportMaxSilence),
                                           MakeTimeChecker());
 
     return tid;
@@ -105,50 +201,95 @@ TcpTimeStepEnv::RxPktTrace(Ptr<const Packet>, const TcpHeader&, Ptr<const TcpSoc
 }
 
 void
-TcpTimeStepEnv::ScheduleNotify()
+TcpTimeStepEnv::NotifyConstructionCompleted()
 {
-    Simulator::Schedule(m_timeStep, &TcpTimeStepEnv::ScheduleNotify, this);
+    Object::NotifyConstructionCompleted();
+    // CoalesceSteps is set for all sockets, before the interface is created at the first step
+    Ns3AiMsgInterface::Get()->SetUseVector(m_coalesceSteps);
+    m_reportPolicy.Configure(m_reportFeatures,
+                             g_reportFeatureNames,
+                             m_reportAbsThreshold,
+                             m_reportRelThreshold,
+                             m_reportMaxSilence);
+}
 
-    Ns3AiMsgInterfaceImpl<TcpRlEnv, TcpRlAct>* msgInterface =
-        Ns3AiMsgInterface::Get()->GetInterface<TcpRlEnv, TcpRlAct>();
+bool
+TcpTimeStepEnv::ShouldReport()
+{
+    return m_reportPolicy.ShouldReport(
+        GetReportFeatureValues(m_tcb, m_rttSum, m_rttSampleNum));
+}
 
-    msgInterface->CppSendBegin();
-    auto env = msgInterface->GetCpp2PyStruct();
-    env->socketUid = m_socketUuid;
-    env->envType = 1;
-    env->simTime_us = Simulator::Now().GetMicroSeconds();
-    env->nodeId = m_nodeId;
-    env->ssThresh = m_tcb->m_ssThresh;
-    env->cWnd = m_tcb->m_cWnd;
-    env->segmentSize = m_tcb->m_segmentSize;
+uint64_t
+TcpTimeStepEnv::GetSuppressedReports() const
+{
+    return m_reportPolicy.GetSuppressedCount();
+}
 
-    uint64_t bytesInFlightSum = std::accumulate(m_bytesInFlight.begin(), m_bytesInFlight.end(), 0);
-    env->bytesInFlight = bytesInFlightSum;
-    m_bytesInFlight.clear();
+void
+TcpTimeStepEnv::ScheduleNotify()
+{
+    Simulator::Schedule(m_timeStep, &TcpTimeStepEnv::ScheduleNotify, this);
 
-    uint64_t segmentsAckedSum = std::accumulate(m_segmentsAcked.begin(), m_segmentsAcked.end(), 0);
-    env->segmentsAcked = segmentsAckedSum;
-    m_segmentsAcked.clear();
-    //  std::cerr << "At " << (uint64_t)(Simulator::Now().GetMilliSeconds()) << "ms:\n";
-    //  std::cerr << "\tstate --"
-    //            << " ssThresh=" << env->ssThresh
-    //            << " cWnd=" << env->cWnd
-    //            << " segmentSize=" << env->segmentSize
-    //            << " segmentAcked=" << env->segmentsAcked
-    //            << " bytesInFlightSum=" << bytesInFlightSum
-    //            << std::endl;
-    msgInterface->CppSendEnd();
+    // Python asked to repeat its last action: keep it and keep accumulating the
+    // statistics, so that the next state covers all the skipped steps.
+    if (m_actionHold.IsHolding())
+    {
+        m_actionHold.Step();
+        return;
+    }
+    // nothing changed enough: the last action stays in force and the statistics
+    // keep accumulating until the next report
+    if (!ShouldReport())
+    {
+        return;
+    }
 
-    msgInterface->CppRecvBegin();
-    auto act = msgInterface->GetPy2CppStruct();
-    m_new_cWnd = act->new_cWnd;
-    m_new_ssThresh = act->new_ssThresh;
-    msgInterface->CppRecvEnd();
+    TcpRlEnv env;
+    env.socketUid = m_socketUuid;
+    env.envType = 1;
+    env.simTime_us = Simulator::Now().GetMicroSeconds();
+    env.nodeId = m_nodeId;
+    env.ssThresh = m_tcb->m_ssThresh;
+    env.cWnd = m_tcb->m_cWnd;
+    env.segmentSize = m_tcb->m_segmentSize;
+    // the state covers the steps on which the last action was repeated, if any
+    env.heldSteps = m_actionHold.TakeHeldSteps();
+
+    uint64_t bytesInFlightSum = m_bytesInFlight.GetSum();
+    env.bytesInFlight = bytesInFlightSum;
+    m_bytesInFlight.Reset();
+
+    uint64_t segmentsAckedSum = m_segmentsAcked.GetSum();
+    env.segmentsAcked = segmentsAckedSum;
+    m_segmentsAcked.Reset();
+    NS_LOG_DEBUG("Socket " << m_socketUuid << " state --"
+                           << " ssThresh=" << env.ssThresh << " cWnd=" << env.cWnd
+                           << " segmentSize=" << env.segmentSize
+                           << " segmentAcked=" << env.segmentsAcked
+                           << " bytesInFlightSum=" << bytesInFlightSum);
+
+    if (m_coalesceSteps)
+    {
+        // the action is set when the batch of this timestamp is exchanged
+        GetStepCoalescer().batcher.Request(env, MakeCallback(&TcpTimeStepEnv::SetAction, this));
+    }
+    else
+    {
+        Ns3AiMsgInterfaceImpl<TcpRlEnv, TcpRlAct>* msgInterface =
+            Ns3AiMsgInterface::Get()->GetInterface<TcpRlEnv, TcpRlAct>();
+
+        auto begin = RlTcpBenchmark::Clock::now();
+        msgInterface->CppSendBegin();
+        *msgInterface->GetCpp2PyStruct() = env;
+        msgInterface->CppSendEnd();
+
+        msgInterface->CppRecvBegin();
+        SetAction(*msgInterface->GetPy2CppStruct());
+        msgInterface->CppRecvEnd();
+        RlTcpBenchmark::Get().RecordAgentCall(begin, 1, 1);
+    }
 
-    //  std::cerr << "\taction --"
-    //            << " new_cWnd=" << m_new_cWnd
-    //            << " new_ssThresh=" << m_new_ssThresh
-    //            << std::endl;
     m_rttSampleNum = 0;
     m_rttSum = MicroSeconds(0.0);
 
@@ -159,6 +300,35 @@ TcpTimeStepEnv::ScheduleNotify()
     m_interRxTimeSum = MicroSeconds(0.0);
 }
 
+void
+TcpTimeStepEnv::SetAction(const TcpRlAct& act)
+{
+    m_new_cWnd = act.new_cWnd;
+    m_new_ssThresh = act.new_ssThresh;
+    m_hasAction = true;
+    if (act.repeat > 0)
+    {
+        m_actionHold.Hold(act, act.repeat, Time(0));
+    }
+    NS_LOG_DEBUG("Socket " << m_socketUuid << " action --"
+                           << " new_cWnd=" << m_new_cWnd << " new_ssThresh=" << m_new_ssThresh);
+}
+
+void
+TcpTimeStepEnv::Start()
+{
+    m_started = true;
+    if (!m_coalesceSteps)
+    {
+        ScheduleNotify();
+        return;
+    }
+    // align the steps of all sockets to multiples of the step time, so they are coalesced
+    Time offset = TimeStep(Simulator::Now().GetTimeStep() % m_timeStep.GetTimeStep());
+    Time delay = offset.IsZero() ? Time(0) : m_timeStep - offset;
+    Simulator::Schedule(delay, &TcpTimeStepEnv::ScheduleNotify, this);
+}
+
 uint32_t
 TcpTimeStepEnv::GetSsThresh(Ptr<const TcpSocketState> tcb, uint32_t bytesInFlight)
 {
@@ -166,14 +336,18 @@ TcpTimeStepEnv::GetSsThresh(Ptr<const TcpSocketState> tcb, uint32_t bytesInFligh
     NS_LOG_INFO(Simulator::Now() << " Node: " << m_nodeId
                                  << " GetSsThresh, BytesInFlight: " << bytesInFlight);
     m_tcb = tcb;
-    m_bytesInFlight.push_back(bytesInFlight);
+    m_bytesInFlight.Add(bytesInFlight);
 
     if (!m_started)
     {
-        m_started = true;
-        ScheduleNotify();
+        Start();
     }
 
+    if (!m_hasAction)
+    {
+        // no action yet while waiting for the first aligned step
+        return std::max(2 * tcb->m_segmentSize, bytesInFlight / 2);
+    }
     // action
     return m_new_ssThresh;
 }
@@ -185,16 +359,18 @@ TcpTimeStepEnv::IncreaseWindow(Ptr<TcpSocketState> tcb, uint32_t segmentsAcked)
     NS_LOG_INFO(Simulator::Now() << " Node: " << m_nodeId
                                  << " IncreaseWindow, SegmentsAcked: " << segmentsAcked);
     m_tcb = tcb;
-    m_segmentsAcked.push_back(segmentsAcked);
-    m_bytesInFlight.push_back(tcb->m_bytesInFlight);
+    m_segmentsAcked.Add(segmentsAcked);
+    m_bytesInFlight.Add(tcb->m_bytesInFlight);
 
     if (!m_started)
     {
-        m_started = true;
-        ScheduleNotify();
+        Start();
     }
     // action
-    tcb->m_cWnd = m_new_cWnd;
+    if (m_hasAction)
+    {
+        tcb->m_cWnd = m_new_cWnd;
+    }
 }
 
 void
@@ -241,6 +417,8 @@ TcpEventBasedEnv::TcpEventBasedEnv()
 
 TcpEventBasedEnv::~TcpEventBasedEnv()
 {
+    NS_LOG_INFO("Socket " << m_socketUuid << " reports sent: " << m_reportPolicy.GetReportedCount()
+                          << ", suppressed: " << m_reportPolicy.GetSuppressedCount());
 }
 
 TypeId
@@ -249,7 +427,28 @@ TcpEventBasedEnv::GetTypeId()
     static TypeId tid = TypeId("ns3::TcpEventBasedEnv")
                             .SetParent<Object>()
                             .SetGroupName("Ns3Ai")
-                            .AddConstructor<TcpEventBasedEnv>();
+                            .AddConstructor<TcpEventBasedEnv>()
+                            .AddAttribute("ReportFeatures",
+                                          Ns3AiReportPolicy::GetFeaturesHelp(g_reportFeatureNames),
+                                          StringValue(""),
+                                          MakeStringAccessor(&TcpEventBasedEnv::m_reportFeatures),
+                                          MakeStringChecker())
+                            .AddAttribute("ReportAbsThreshold",
+                                          std::string(Ns3AiReportPolicy::ABS_THRESHOLD_HELP) +
+                                              ". Unit: bytes, or us for rtt",
+                                          DoubleValue(0),
+                                          MakeDoubleAccessor(&TcpEventBasedEnv::m_reportAbsThreshold),
+                                          MakeDoubleChecker<double>(0))
+                            .AddAttribute("ReportRelThreshold",
+                                          Ns3AiReportPolicy::REL_THRESHOLD_HELP,
+                                          DoubleValue(0),
+                                          MakeDoubleAccessor(&TcpEventBasedEnv::m_reportRelThreshold),
+                                          MakeDoubleChecker<double>(0))
+                            .AddAttribute("ReportMaxSilence",
+                                          Ns3AiReportPolicy::MAX_SILENCE_HELP,
+                                          TimeValue(Seconds(0)),
+                                          MakeTimeAccessor(&TcpEventBasedEnv::m_reportMaxSilence),
+                                          MakeTimeChecker());
 
     return tid;
 }
@@ -296,12 +495,42 @@ TcpEventBasedEnv::RxPktTrace(Ptr<const Packet>, const TcpHeader&, Ptr<const TcpS
     m_lastPktRxTime = Simulator::Now();
 }
 
+void
+TcpEventBasedEnv::NotifyConstructionCompleted()
+{
+    Object::NotifyConstructionCompleted();
+    m_reportPolicy.Configure(m_reportFeatures,
+                             g_reportFeatureNames,
+                             m_reportAbsThreshold,
+                             m_reportRelThreshold,
+                             m_reportMaxSilence);
+}
+
+bool
+TcpEventBasedEnv::ShouldReport()
+{
+    return m_reportPolicy.ShouldReport(
+        GetReportFeatureValues(m_tcb, m_rttSum, m_rttSampleNum));
+}
+
+uint64_t
+TcpEventBasedEnv::GetSuppressedReports() const
+{
+    return m_reportPolicy.GetSuppressedCount();
+}
+
 void
 TcpEventBasedEnv::Notify()
 {
+    if (!ShouldReport())
+    {
+        return;
+    }
+
     Ns3AiMsgInterfaceImpl<TcpRlEnv, TcpRlAct>* msgInterface =
         Ns3AiMsgInterface::Get()->GetInterface<TcpRlEnv, TcpRlAct>();
 
+    auto begin = RlTcpBenchmark::Clock::now();
     msgInterface->CppSendBegin();
     auto env = msgInterface->GetCpp2PyStruct();
     env->socketUid = m_socketUuid;
@@ -312,18 +541,19 @@ TcpEventBasedEnv::Notify()
     env->cWnd = m_tcb->m_cWnd;
     env->segmentSize = m_tcb->m_segmentSize;
 
-    uint64_t bytesInFlightSum = std::accumulate(m_bytesInFlight.begin(), m_bytesInFlight.end(), 0);
+    uint64_t bytesInFlightSum = m_bytesInFlight.GetSum();
     env->bytesInFlight = bytesInFlightSum;
-    m_bytesInFlight.clear();
+    env->heldSteps = 0;
+    m_bytesInFlight.Reset();
 
-    uint64_t segmentsAckedSum = std::accumulate(m_segmentsAcked.begin(), m_segmentsAcked.end(), 0);
+    uint64_t segmentsAckedSum = m_segmentsAcked.GetSum();
     env->segmentsAcked = segmentsAckedSum;
-    m_segmentsAcked.clear();
-    std::cerr << "At " << (uint64_t)(Simulator::Now().GetMilliSeconds()) << "ms:\n";
-    std::cerr << "\tstate --"
-              << " ssThresh=" << env->ssThresh << " cWnd=" << env->cWnd
-              << " segmentSize=" << env->segmentSize << " segmentAcked=" << env->segmentsAcked
-              << " bytesInFlightSum=" << bytesInFlightSum << std::endl;
+    m_segmentsAcked.Reset();
+    NS_LOG_DEBUG("Socket " << m_socketUuid << " state --"
+                           << " ssThresh=" << env->ssThresh << " cWnd=" << env->cWnd
+                           << " segmentSize=" << env->segmentSize
+                           << " segmentAcked=" << env->segmentsAcked
+                           << " bytesInFlightSum=" << bytesInFlightSum);
     msgInterface->CppSendEnd();
 
     msgInterface->CppRecvBegin();
@@ -331,9 +561,10 @@ TcpEventBasedEnv::Notify()
     m_new_cWnd = act->new_cWnd;
     m_new_ssThresh = act->new_ssThresh;
     msgInterface->CppRecvEnd();
+    RlTcpBenchmark::Get().RecordAgentCall(begin, 1, 1);
 
-    std::cerr << "\taction --"
-              << " new_cWnd=" << m_new_cWnd << " new_ssThresh=" << m_new_ssThresh << std::endl;
+    NS_LOG_DEBUG("Socket " << m_socketUuid << " action --"
+                           << " new_cWnd=" << m_new_cWnd << " new_ssThresh=" << m_new_ssThresh);
     m_rttSampleNum = 0;
     m_rttSum = MicroSeconds(0.0);
 
@@ -351,7 +582,7 @@ TcpEventBasedEnv::GetSsThresh(Ptr<const TcpSocketState> tcb, uint32_t bytesInFli
     NS_LOG_INFO(Simulator::Now() << " Node: " << m_nodeId
                                  << " GetSsThresh, BytesInFlight: " << bytesInFlight);
     m_tcb = tcb;
-    m_bytesInFlight.push_back(bytesInFlight);
+    m_bytesInFlight.Add(bytesInFlight);
 
     Notify();
 
@@ -366,8 +597,8 @@ TcpEventBasedEnv::IncreaseWindow(Ptr<TcpSocketState> tcb, uint32_t segmentsAcked
     NS_LOG_INFO(Simulator::Now() << " Node: " << m_nodeId
                                  << " IncreaseWindow, SegmentsAcked: " << segmentsAcked);
     m_tcb = tcb;
-    m_segmentsAcked.push_back(segmentsAcked);
-    m_bytesInFlight.push_back(tcb->m_bytesInFlight);
+    m_segmentsAcked.Add(segmentsAcked);
+    m_bytesInFlight.Add(tcb->m_bytesInFlight);
 
     Notify();
 
@@ -42,12 +42,14 @@ struct TcpRlEnv
     uint32_t segmentSize;
     uint32_t segmentsAcked;
     uint32_t bytesInFlight;
+    uint32_t heldSteps; // time-step env only: steps on which the last action was repeated
 };
 
 struct TcpRlAct
 {
     uint32_t new_ssThresh;
     uint32_t new_cWnd;
+    uint32_t repeat; // time-step env only: keep the action for this many following steps
 };
 
 class TcpTimeStepEnv : public Object
@@ -70,7 +72,22 @@ class TcpTimeStepEnv : public Object
     void CongestionStateSet(Ptr<TcpSocketState> tcb, const TcpSocketState::TcpCongState_t newState);
     void CwndEvent(Ptr<TcpSocketState> tcb, const TcpSocketState::TcpCAEvent_t event);
 
+    uint64_t GetSuppressedReports() const;
+
+  protected:
+    /**
+     * \brief Configure the reporting policy once the attributes are set.
+     */
+    void NotifyConstructionCompleted() override;
+
   private:
+    bool ShouldReport();
+    Ns3AiReportPolicy m_reportPolicy;
+    std::string m_reportFeatures;
+    double m_reportAbsThreshold;
+    double m_reportRelThreshold;
+    Time m_reportMaxSilence;
+
     uint32_t m_nodeId;
     uint32_t m_socketUuid;
 
@@ -83,14 +100,19 @@ class TcpTimeStepEnv : public Object
 
     uint32_t m_new_ssThresh;
     uint32_t m_new_cWnd;
+    bool m_hasAction{false};
     void ScheduleNotify();
+    void Start();
+    void SetAction(const TcpRlAct& act);
     bool m_started{false};
     Time m_timeStep;
+    bool m_coalesceSteps;
+    Ns3AiActionHold<TcpRlAct> m_actionHold;
 
     // state
     Ptr<const TcpSocketState> m_tcb;
-    std::vector<uint32_t> m_bytesInFlight;
-    std::vector<uint32_t> m_segmentsAcked;
+    Ns3AiStreamStats m_bytesInFlight;
+    Ns3AiStreamStats m_segmentsAcked;
 
     uint64_t m_rttSampleNum{0};
     Time m_rttSum{MicroSeconds(0.0)};
@@ -116,7 +138,22 @@ class TcpEventBasedEnv : public Object
     void CongestionStateSet(Ptr<TcpSocketState> tcb, const TcpSocketState::TcpCongState_t newState);
     void CwndEvent(Ptr<TcpSocketState> tcb, const TcpSocketState::TcpCAEvent_t event);
 
+    uint64_t GetSuppressedReports() const;
+
+  protected:
+    /**
+     * \brief Configure the reporting policy once the attributes are set.
+     */
+    void NotifyConstructionCompleted() override;
+
   private:
+    bool ShouldReport();
+    Ns3AiReportPolicy m_reportPolicy;
+    std::string m_reportFeatures;
+    double m_reportAbsThreshold;
+    double m_reportRelThreshold;
+    Time m_reportMaxSilence;
+
     uint32_t m_nodeId;
     uint32_t m_socketUuid;
 
@@ -133,8 +170,8 @@ class TcpEventBasedEnv : public Object
 
     // state
     Ptr<const TcpSocketState> m_tcb;
-    std::vector<uint32_t> m_bytesInFlight;
-    std::vector<uint32_t> m_segmentsAcked;
+    Ns3AiStreamStats m_bytesInFlight;
+    Ns3AiStreamStats m_segmentsAcked;
 
     uint64_t m_rttSampleNum{0};
     Time m_rttSum{MicroSeconds(0.0)};
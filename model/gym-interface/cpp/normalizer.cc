@@ -0,0 +1,307 @@
+/*
+ * Copyright (c) 2023 Huazhong University of Science and Technology
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "normalizer.h"
+
+#include <ns3/abort.h>
+#include <ns3/assert.h>
+#include <ns3/boolean.h>
+#include <ns3/double.h>
+#include <ns3/log.h>
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <limits>
+
+namespace ns3
+{
+
+NS_LOG_COMPONENT_DEFINE("OpenGymObsNormalizer");
+NS_OBJECT_ENSURE_REGISTERED(OpenGymObsNormalizer);
+
+TypeId
+OpenGymObsNormalizer::GetTypeId()
+{
+    static TypeId tid =
+        TypeId("ns3::OpenGymObsNormalizer")
+            .SetParent<Object>()
+            .SetGroupName("OpenGym")
+            .AddConstructor<OpenGymObsNormalizer>()
+            .AddAttribute("Standardize",
+                          "Subtract the running mean and divide by the running standard deviation",
+                          BooleanValue(true),
+                          MakeBooleanAccessor(&OpenGymObsNormalizer::m_standardize),
+                          MakeBooleanChecker())
+            .AddAttribute("Clip",
+                          "Clip processed values to [-Clip, Clip]. 0: no clipping",
+                          DoubleValue(10.0),
+                          MakeDoubleAccessor(&OpenGymObsNormalizer::m_clip),
+                          MakeDoubleChecker<double>(0))
+            .AddAttribute("UpdateStats",
+                          "Update the running statistics with new observations. Disable to "
+                          "evaluate with frozen statistics",
+                          BooleanValue(true),
+                          MakeBooleanAccessor(&OpenGymObsNormalizer::m_updateStats),
+                          MakeBooleanChecker())
+            .AddAttribute("Epsilon",
+                          "Added to the variance to avoid division by zero",
+                          DoubleValue(1e-8),
+                          MakeDoubleAccessor(&OpenGymObsNormalizer::m_epsilon),
+                          MakeDoubleChecker<double>(0));
+    return tid;
+}
+
+OpenGymObsNormalizer::OpenGymObsNormalizer()
+{
+    NS_LOG_FUNCTION(this);
+}
+
+OpenGymObsNormalizer::~OpenGymObsNormalizer()
+{
+    NS_LOG_FUNCTION(this);
+}
+
+void
+OpenGymObsNormalizer::Process(ns3_ai_gym::DataContainer& dataContainer)
+{
+    NS_LOG_FUNCTION(this);
+    uint32_t boxIdx = 0;
+    ProcessContainer(dataContainer, boxIdx);
+}
+
+void
+OpenGymObsNormalizer::ProcessContainer(ns3_ai_gym::DataContainer& dataContainer, uint32_t& boxIdx)
+{
+    if (dataContainer.type() == ns3_ai_gym::Box)
+    {
+        ProcessBox(dataContainer, boxIdx);
+    }
+    else if (dataContainer.type() == ns3_ai_gym::Tuple)
+    {
+        ns3_ai_gym::TupleDataContainer tupleContainerPbMsg;
+        dataContainer.data().UnpackTo(&tupleContainerPbMsg);
+        for (int i = 0; i < tupleContainerPbMsg.element_size(); i++)
+        {
+            ProcessContainer(*tupleContainerPbMsg.mutable_element(i), boxIdx);
+        }
+        dataContainer.mutable_data()->PackFrom(tupleContainerPbMsg);
+    }
+    else if (dataContainer.type() == ns3_ai_gym::Dict)
+    {
+        ns3_ai_gym::DictDataContainer dictContainerPbMsg;
+        dataContainer.data().UnpackTo(&dictContainerPbMsg);
+        for (int i = 0; i < dictContainerPbMsg.element_size(); i++)
+        {
+            ProcessContainer(*dictContainerPbMsg.mutable_element(i), boxIdx);
+        }
+        dataContainer.mutable_data()->PackFrom(dictContainerPbMsg);
+    }
+}
+
+void
+OpenGymObsNormalizer::ProcessBox(ns3_ai_gym::DataContainer& dataContainer, uint32_t& boxIdx)
+{
+    ns3_ai_gym::BoxDataContainer box;
+    dataContainer.data().UnpackTo(&box);
+
+    // gather the values as double, whatever the dtype
+    switch (box.dtype())
+    {
+    case ns3_ai_gym::INT:
+        m_values.assign(box.intdata().begin(), box.intdata().end());
+        break;
+    case ns3_ai_gym::UINT:
+        m_values.assign(box.uintdata().begin(), box.uintdata().end());
+        break;
+    case ns3_ai_gym::DOUBLE:
+        m_values.assign(box.doubledata().begin(), box.doubledata().end());
+        break;
+    default:
+        m_values.assign(box.floatdata().begin(), box.floatdata().end());
+        break;
+    }
+    const std::size_t n = m_values.size();
+    double* x = m_values.data();
+
+    if (boxIdx >= m_stats.size())
+    {
+        m_stats.resize(boxIdx + 1);
+    }
+    BoxStats& stats = m_stats[boxIdx++];
+    if (stats.mean.size() != n)
+    {
+        NS_ASSERT_MSG(stats.count == 0, "Box size changed from " << stats.mean.size() << " to " << n);
+        stats.mean.assign(n, 0.0);
+        stats.m2.assign(n, 0.0);
+    }
+    double* mean = stats.mean.data();
+    double* m2 = stats.m2.data();
+
+    // Welford update, all features share the sample count
+    if (m_updateStats)
+    {
+        stats.count++;
+        const double invCount = 1.0 / stats.count;
+        for (std::size_t i = 0; i < n; i++)
+        {
+            const double delta = x[i] - mean[i];
+            mean[i] += delta * invCount;
+            m2[i] += delta * (x[i] - mean[i]);
+        }
+    }
+
+    if (m_standardize && stats.count > 0)
+    {
+        const double invCount = 1.0 / stats.count;
+        for (std::size_t i = 0; i < n; i++)
+        {
+            x[i] = (x[i] - mean[i]) / std::sqrt(m2[i] * invCount + m_epsilon);
+        }
+    }
+
+    if (m_clip > 0)
+    {
+        const double clip = m_clip;
+        for (std::size_t i = 0; i < n; i++)
+        {
+            x[i] = std::min(std::max(x[i], -clip), clip);
+        }
+    }
+
+    box.clear_intdata();
+    box.clear_uintdata();
+    box.clear_doubledata();
+    box.mutable_floatdata()->Resize(n, 0.0f);
+    float* out = box.mutable_floatdata()->mutable_data();
+    for (std::size_t i = 0; i < n; i++)
+    {
+        out[i] = static_cast<float>(x[i]);
+    }
+    box.set_dtype(ns3_ai_gym::FLOAT);
+    dataContainer.mutable_data()->PackFrom(box);
+}
+
+void
+OpenGymObsNormalizer::ProcessSpace(ns3_ai_gym::SpaceDescription& spaceDesc)
+{
+    NS_LOG_FUNCTION(this);
+    ProcessSpaceDesc(spaceDesc);
+}
+
+void
+OpenGymObsNormalizer::ProcessSpaceDesc(ns3_ai_gym::SpaceDescription& spaceDesc)
+{
+    if (spaceDesc.type() == ns3_ai_gym::Box)
+    {
+        ns3_ai_gym::BoxSpace boxSpacePb;
+        spaceDesc.space().UnpackTo(&boxSpacePb);
+        float bound = m_clip > 0 ? m_clip : std::numeric_limits<float>::max();
+        if (m_standardize || m_clip > 0)
+        {
+            boxSpacePb.set_low(m_standardize ? -bound : std::max(boxSpacePb.low(), -bound));
+            boxSpacePb.set_high(m_standardize ? bound : std::min(boxSpacePb.high(), bound));
+        }
+        boxSpacePb.set_dtype(ns3_ai_gym::FLOAT);
+        spaceDesc.mutable_space()->PackFrom(boxSpacePb);
+    }
+    else if (spaceDesc.type() == ns3_ai_gym::Tuple)
+    {
+        ns3_ai_gym::TupleSpace tupleSpacePb;
+        spaceDesc.space().UnpackTo(&tupleSpacePb);
+        for (int i = 0; i < tupleSpacePb.element_size(); i++)
+        {
+            ProcessSpaceDesc(*tupleSpacePb.mutable_element(i));
+        }
+        spaceDesc.mutable_space()->PackFrom(tupleSpacePb);
+    }
+    else if (spaceDesc.type() == ns3_ai_gym::Dict)
+    {
+        ns3_ai_gym::DictSpace dictSpacePb;
+        spaceDesc.space().UnpackTo(&dictSpacePb);
+        for (int i = 0; i < dictSpacePb.element_size(); i++)
+        {
+            ProcessSpaceDesc(*dictSpacePb.mutable_element(i));
+        }
+        spaceDesc.mutable_space()->PackFrom(dictSpacePb);
+    }
+}
+
+const std::vector<OpenGymObsNormalizer::BoxStats>&
+OpenGymObsNormalizer::GetStats() const
+{
+    return m_stats;
+}
+
+void
+OpenGymObsNormalizer::SetStats(const std::vector<BoxStats>& stats)
+{
+    NS_LOG_FUNCTION(this);
+    m_stats = stats;
+}
+
+void
+OpenGymObsNormalizer::SaveStats(const std::string& filename) const
+{
+    NS_LOG_FUNCTION(this << filename);
+    std::ofstream ofs(filename);
+    NS_ABORT_MSG_IF(!ofs.is_open(), "Cannot open " << filename);
+    ofs.precision(std::numeric_limits<double>::max_digits10);
+    // one line per Box: count, size, means, m2s
+    for (const auto& stats : m_stats)
+    {
+        ofs << stats.count << " " << stats.mean.size();
+        for (double v : stats.mean)
+        {
+            ofs << " " << v;
+        }
+        for (double v : stats.m2)
+        {
+            ofs << " " << v;
+        }
+        ofs << "\n";
+    }
+}
+
+void
+OpenGymObsNormalizer::LoadStats(const std::string& filename)
+{
+    NS_LOG_FUNCTION(this << filename);
+    std::ifstream ifs(filename);
+    NS_ABORT_MSG_IF(!ifs.is_open(), "Cannot open " << filename);
+    std::vector<BoxStats> stats;
+    BoxStats box;
+    std::size_t n;
+    while (ifs >> box.count >> n)
+    {
+        box.mean.resize(n);
+        box.m2.resize(n);
+        for (std::size_t i = 0; i < n; i++)
+        {
+            ifs >> box.mean[i];
+        }
+        for (std::size_t i = 0; i < n; i++)
+        {
+            ifs >> box.m2[i];
+        }
+        NS_ABORT_MSG_IF(ifs.fail(), "Malformed statistics file " << filename);
+        stats.push_back(box);
+    }
+    m_stats = stats;
+}
+
+} // namespace ns3
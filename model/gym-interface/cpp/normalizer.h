@@ -0,0 +1,105 @@
+/*
+ * Copyright (c) 2023 Huazhong University of Science and Technology
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef OPENGYM_NORMALIZER_H
+#define OPENGYM_NORMALIZER_H
+
+#include "messages.pb.h"
+
+#include <ns3/object.h>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace ns3
+{
+
+/**
+ * \brief Observation preprocessing stage of the Gym interface.
+ *
+ * Keeps Welford running mean and variance of every feature of the Box
+ * observations (including Boxes inside Tuple and Dict observations), and
+ * replaces each value by its standardized and/or clipped value before the
+ * observation is sent to Python. Processed Boxes are sent as float.
+ *
+ * The statistics can be saved and loaded to resume training or to evaluate a
+ * trained agent with frozen statistics (see the UpdateStats attribute).
+ */
+class OpenGymObsNormalizer : public Object
+{
+  public:
+    OpenGymObsNormalizer();
+    ~OpenGymObsNormalizer() override;
+    static TypeId GetTypeId();
+
+    /**
+     * \brief Running statistics of one Box
+     */
+    struct BoxStats
+    {
+        uint64_t count{0};        //!< number of samples
+        std::vector<double> mean; //!< running mean of each feature
+        std::vector<double> m2;   //!< running sum of squared deviations of each feature
+    };
+
+    /**
+     * \brief Update the statistics and normalize an observation in place.
+     */
+    void Process(ns3_ai_gym::DataContainer& dataContainer);
+
+    /**
+     * \brief Adapt an observation space description to the processed observations.
+     */
+    void ProcessSpace(ns3_ai_gym::SpaceDescription& spaceDesc);
+
+    /**
+     * \brief Get the statistics of all Boxes, in the order they appear in the observation.
+     */
+    const std::vector<BoxStats>& GetStats() const;
+
+    /**
+     * \brief Replace the statistics, e.g., with ones restored from a checkpoint.
+     */
+    void SetStats(const std::vector<BoxStats>& stats);
+
+    /**
+     * \brief Save the statistics to a text file.
+     */
+    void SaveStats(const std::string& filename) const;
+
+    /**
+     * \brief Load the statistics from a file written by SaveStats.
+     */
+    void LoadStats(const std::string& filename);
+
+  private:
+    void ProcessBox(ns3_ai_gym::DataContainer& dataContainer, uint32_t& boxIdx);
+    void ProcessContainer(ns3_ai_gym::DataContainer& dataContainer, uint32_t& boxIdx);
+    void ProcessSpaceDesc(ns3_ai_gym::SpaceDescription& spaceDesc);
+
+    bool m_standardize;             //!< subtract the mean and divide by the standard deviation
+    double m_clip;                  //!< clip processed values to [-m_clip, m_clip], 0 to disable
+    bool m_updateStats;             //!< update statistics with new observations
+    double m_epsilon;               //!< added to the variance to avoid division by zero
+    std::vector<BoxStats> m_stats;  //!< statistics of each Box
+    std::vector<double> m_values;   //!< scratch buffer of the current Box values
+};
+
+} // namespace ns3
+
+#endif // OPENGYM_NORMALIZER_H
@@ -33,6 +33,8 @@ NS_OBJECT_ENSURE_REGISTERED(OpenGymEnv);
 NS_LOG_COMPONENT_DEFINE("OpenGymEnv");
 
 OpenGymEnv::OpenGymEnv()
+    : m_isAgent(false),
+      m_agentId(0)
 {
     NS_LOG_FUNCTION(this);
 }
@@ -67,13 +69,30 @@ OpenGymEnv::SetOpenGymInterface(Ptr<OpenGymInterface> openGymInterface)
     openGymInterface->SetExecuteActionsCb(MakeCallback(&OpenGymEnv::ExecuteActions, this));
 }
 
+void
+OpenGymEnv::SetOpenGymInterface(Ptr<OpenGymInterface> openGymInterface, uint32_t agentId)
+{
+    NS_LOG_FUNCTION(this << agentId);
+    m_openGymInterface = openGymInterface;
+    m_isAgent = true;
+    m_agentId = agentId;
+    openGymInterface->RegisterAgent(agentId, this);
+}
+
 void
 OpenGymEnv::Notify()
 {
     NS_LOG_FUNCTION(this);
     if (m_openGymInterface)
     {
-        m_openGymInterface->Notify(this);
+        if (m_isAgent)
+        {
+            m_openGymInterface->NotifyAgentReady(m_agentId);
+        }
+        else
+        {
+            m_openGymInterface->Notify(this);
+        }
     }
 }
 
@@ -97,6 +116,12 @@ void
 OpenGymEnv::DoDispose()
 {
     NS_LOG_FUNCTION(this);
+    if (m_isAgent && m_openGymInterface)
+    {
+        // the interface holds a reference to this env until it is unregistered
+        m_openGymInterface->UnregisterAgent(m_agentId);
+        m_isAgent = false;
+    }
 }
 
 } // namespace ns3
@@ -84,6 +84,13 @@ class OpenGymEnv : public Object
      */
     void SetOpenGymInterface(Ptr<OpenGymInterface> openGymInterface);
 
+    /**
+     * Register the environment as agent agentId of a multi-agent setup. Notify()
+     * then only marks the agent as ready, and the interface exchanges the states
+     * and actions of all ready agents in one step.
+     */
+    void SetOpenGymInterface(Ptr<OpenGymInterface> openGymInterface, uint32_t agentId);
+
     /**
      * Notify Python side about the states, and execute the actions  通知Python端关于状态，并执行动作。这是一个重要的函数，用于将环境的状态和动作信息发送到Python端。。
      */
@@ -100,6 +107,8 @@ class OpenGymEnv : public Object
     void DoDispose() override;
 
     Ptr<OpenGymInterface> m_openGymInterface; //m_openGymInterface 是指向 OpenGymInterface 对象的智能指针，用于与Python端通信。
+    bool m_isAgent;     //!< whether registered as an agent in multi-agent mode
+    uint32_t m_agentId; //!< agent ID in multi-agent mode
 
   private:
 };
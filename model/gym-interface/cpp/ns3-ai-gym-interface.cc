@@ -29,11 +29,17 @@
 #include "container.h"
 #include "messages.pb.h"
 #include "ns3-ai-gym-env.h"
+#include "normalizer.h"
 #include "spaces.h"
 
+#include <ns3/abort.h>
 #include <ns3/config.h>
 #include <ns3/log.h>
 #include <ns3/simulator.h>
+#include <ns3/string.h>
+#include <ns3/uinteger.h>
+
+#include <fstream>
 
 namespace ns3
 {
@@ -51,7 +57,10 @@ OpenGymInterface::Get()
 OpenGymInterface::OpenGymInterface()
     : m_simEnd(false),
       m_stopEnvRequested(false),
-      m_initSimMsgSent(false)
+      m_initSimMsgSent(false),
+      m_exchangeCount(0),
+      m_agentsNotifyScheduled(false),
+      m_timingEnabled(false)
 {
     auto interface = Ns3AiMsgInterface::Get();
     interface->SetIsMemoryCreator(false);
@@ -69,7 +78,19 @@ OpenGymInterface::GetTypeId()
     static TypeId tid = TypeId("OpenGymInterface")
                             .SetParent<Object>()
                             .SetGroupName("OpenGym")
-                            .AddConstructor<OpenGymInterface>();
+                            .AddConstructor<OpenGymInterface>()
+                            .AddAttribute("TimingTraceFile",
+                                          "If set, time every step and write a Chrome trace "
+                                          "to this file when the simulation ends",
+                                          StringValue(""),
+                                          MakeStringAccessor(&OpenGymInterface::m_timingTraceFile),
+                                          MakeStringChecker())
+                            .AddAttribute("TimingMaxSteps",
+                                          "Max number of steps whose timing is recorded. "
+                                          "Totals include all steps",
+                                          UintegerValue(100000),
+                                          MakeUintegerAccessor(&OpenGymInterface::m_timingMaxSteps),
+                                          MakeUintegerChecker<uint32_t>());
     return tid;
 }
 /*这段代码的功能是初始化 OpenAI Gym 环境。具体注释如下：
@@ -97,8 +118,19 @@ OpenGymInterface::Init()
     m_initSimMsgSent = true;
 
     // 获取观测空间和动作空间
-    Ptr<OpenGymSpace> obsSpace = GetObservationSpace();
-    Ptr<OpenGymSpace> actionSpace = GetActionSpace();
+    Ptr<OpenGymSpace> obsSpace;
+    Ptr<OpenGymSpace> actionSpace;
+    if (IsMultiAgent())
+    {
+        // all agents share the spaces of the first registered one
+        obsSpace = m_agents.begin()->second->GetObservationSpace();
+        actionSpace = m_agents.begin()->second->GetActionSpace();
+    }
+    else
+    {
+        obsSpace = GetObservationSpace();
+        actionSpace = GetActionSpace();
+    }
 
      // 创建用于初始化的消息，这一行代码是为了创建一个用于构建初始化消息的对象，以便后续代码可以向其中添加相关信息。
     /*这个对象的声明并不仅仅是为了创建一个变量，更重要的是为后续的代码提供一个容器，用于构建并存储将要发送到 Python 端的初始化消息。
@@ -109,6 +141,10 @@ OpenGymInterface::Init()
     {
         ns3_ai_gym::SpaceDescription spaceDesc;
         spaceDesc = obsSpace->GetSpaceDescription();
+        if (m_obsNormalizer)
+        {
+            m_obsNormalizer->ProcessSpace(spaceDesc);
+        }
         simInitMsg.mutable_obsspace()->CopyFrom(spaceDesc);
     }
     // 如果存在动作空间，将其描述信息添加到初始化消息中
@@ -118,6 +154,12 @@ OpenGymInterface::Init()
         spaceDesc = actionSpace->GetSpaceDescription();
         simInitMsg.mutable_actspace()->CopyFrom(spaceDesc);
     }
+    simInitMsg.set_multiagent(IsMultiAgent());
+    if (!m_timingTraceFile.empty())
+    {
+        m_timingEnabled = true;
+    }
+    simInitMsg.set_timing(m_timingEnabled);
 
     // get the interface  这段代码获取了用于处理特定消息类型的消息接口
     Ns3AiMsgInterfaceImpl<Ns3AiGymMsg, Ns3AiGymMsg>* msgInterface =
@@ -174,17 +216,33 @@ OpenGymInterface::NotifyCurrentState()
     {
         return;
     }
+    // re-apply the held action locally instead of asking Python
+    if (m_actionHold.IsHolding())
+    {
+        if (!IsGameOver())
+        {
+            ExecuteActions(m_actionHold.Step(GetReward()));
+            return;
+        }
+        m_actionHold.Cancel();
+    }
+    TimingStepBegin();
     // collect current env state 收集当前环境状态信息
     Ptr<OpenGymDataContainer> obsDataContainer = GetObservation();// 获取观察数据
-    float reward = GetReward();// 获取奖励值
+    float reward = m_actionHold.TakeReward(GetReward());// 获取奖励值（含重复动作期间累计的奖励）
     bool isGameOver = IsGameOver();// 判断游戏是否结束
     std::string extraInfo = GetExtraInfo();// 获取额外信息
+    m_curTiming.observationUs = TimingLap();
     ns3_ai_gym::EnvStateMsg envStateMsg;  // 创建 EnvStateMsg 消息
     // observation // 处理观察数据
     ns3_ai_gym::DataContainer obsDataContainerPbMsg;
     if (obsDataContainer) //这是一个条件语句，检查是否存在观察数据容器 obsDataContainer。这个容器应该包含当前环境的观察数据。
     {
         obsDataContainerPbMsg = obsDataContainer->GetDataContainerPbMsg();   //如果观察数据容器存在，调用其 GetDataContainerPbMsg 方法，将观察数据转换为 Protocol Buffers 消息类型 DataContainer，并将结果赋给 obsDataContainerPbMsg。
+        if (m_obsNormalizer)
+        {
+            m_obsNormalizer->Process(obsDataContainerPbMsg);
+        }
         envStateMsg.mutable_obsdata()->CopyFrom(obsDataContainerPbMsg);//接着，通过 mutable_obsdata() 获取 envStateMsg 对象中观察数据的可变引用，并使用 CopyFrom 方法将 obsDataContainerPbMsg 的内容复制到其中。这样就将观察数据添加到了 envStateMsg 中。
     }
     // 设置奖励值、游戏结束标志和额外信息
@@ -206,7 +264,31 @@ OpenGymInterface::NotifyCurrentState()
     }
     // extra info 将额外信息 extraInfo 添加到环境状态消息中。
     envStateMsg.set_info(extraInfo);
+    envStateMsg.set_heldsteps(m_actionHold.GetHeldSteps());
 
+    ns3_ai_gym::EnvActMsg envActMsg;
+    if (!ExchangeMsg(envStateMsg, envActMsg))
+    {
+        return;
+    }
+
+    // first step after reset is called without actions, just to get current state // 在重置后的第一步中，如果没有动作被调用，仅用于获取当前状态
+    ns3_ai_gym::DataContainer actDataContainerPbMsg = envActMsg.actdata(); //获取 Python 发送的动作消息中的动作数据。
+    Ptr<OpenGymDataContainer> actDataContainer =
+        OpenGymDataContainer::CreateFromDataContainerPbMsg(actDataContainerPbMsg);//根据动作数据创建动作数据容器。
+    ExecuteActions(actDataContainer);//执行环境中的动作。
+    if (envActMsg.repeat() > 0 || envActMsg.holdtime() > 0)
+    {
+        m_actionHold.Hold(actDataContainer, envActMsg.repeat(), Seconds(envActMsg.holdtime()));
+    }
+    m_curTiming.executeUs = TimingLap();
+    TimingStepEnd();
+}
+
+bool
+OpenGymInterface::ExchangeMsg(const ns3_ai_gym::EnvStateMsg& envStateMsg,
+                              ns3_ai_gym::EnvActMsg& envActMsg)
+{
     // get the interface  // 获取消息传输接口
     Ns3AiMsgInterfaceImpl<Ns3AiGymMsg, Ns3AiGymMsg>* msgInterface =
         Ns3AiMsgInterface::Get()->GetInterface<Ns3AiGymMsg, Ns3AiGymMsg>();
@@ -217,39 +299,328 @@ OpenGymInterface::NotifyCurrentState()
     assert(msgInterface->GetCpp2PyStruct()->size <= MSG_BUFFER_SIZE);
     envStateMsg.SerializeToArray(msgInterface->GetCpp2PyStruct()->buffer,
                                  msgInterface->GetCpp2PyStruct()->size);//将 envStateMsg 序列化为字节数组，并将其拷贝到消息缓冲区中。
+    m_curTiming.serializationUs = TimingLap();
 
     msgInterface->CppSendEnd();//结束消息发送。
+    m_exchangeCount++;
 
     // receive act msg from python // 从 Python 接收动作消息
-    ns3_ai_gym::EnvActMsg envActMsg;//解析 Python 发送的消息，将其反序列化为 envActMsg 对象。
     msgInterface->CppRecvBegin();
+    m_curTiming.waitUs = TimingLap();
 
     envActMsg.ParseFromArray(msgInterface->GetPy2CppStruct()->buffer,
                              msgInterface->GetPy2CppStruct()->size);
     msgInterface->CppRecvEnd();//结束接收消息。
+    m_curTiming.deserializationUs = TimingLap();
+    if (envActMsg.has_pytiming())
+    {
+        m_curTiming.pyDecodeUs = envActMsg.pytiming().decodeus();
+        m_curTiming.pyAgentUs = envActMsg.pytiming().agentus();
+        m_curTiming.pyEncodeUs = envActMsg.pytiming().encodeus();
+    }
 
     if (m_simEnd) // 如果模拟结束，则只接收消息并退出
     {
         // if sim end only rx msg and quit
-        return;
+        return false;
     }
 
     // 判断是否有停止模拟的请求
     bool stopSim = envActMsg.stopsimreq();
     if (stopSim) //如果有停止模拟的请求，执行相应的处理：
     {
-        NS_LOG_DEBUG("---Stop requested: " << stopSim); 
+        NS_LOG_DEBUG("---Stop requested: " << stopSim);
         m_stopEnvRequested = true;//设置停止环境的标志。
         Simulator::Stop();//停止模拟。
         Simulator::Destroy();//销毁模拟器。
         std::exit(0);//退出程序。
     }
+    return true;
+}
 
-    // first step after reset is called without actions, just to get current state // 在重置后的第一步中，如果没有动作被调用，仅用于获取当前状态
-    ns3_ai_gym::DataContainer actDataContainerPbMsg = envActMsg.actdata(); //获取 Python 发送的动作消息中的动作数据。
-    Ptr<OpenGymDataContainer> actDataContainer =
-        OpenGymDataContainer::CreateFromDataContainerPbMsg(actDataContainerPbMsg);//根据动作数据创建动作数据容器。
-    ExecuteActions(actDataContainer);//执行环境中的动作。
+void
+OpenGymInterface::RegisterAgent(uint32_t agentId, Ptr<OpenGymEnv> agent)
+{
+    NS_LOG_FUNCTION(this << agentId);
+    NS_ASSERT_MSG(m_agents.find(agentId) == m_agents.end(),
+                  "Agent " << agentId << " is already registered");
+    m_agents[agentId] = agent;
+}
+
+void
+OpenGymInterface::UnregisterAgent(uint32_t agentId)
+{
+    NS_LOG_FUNCTION(this << agentId);
+    m_agents.erase(agentId);
+    m_agentActionHolds.erase(agentId);
+    m_readyAgents.erase(agentId);
+}
+
+void
+OpenGymInterface::NotifyAgentReady(uint32_t agentId)
+{
+    NS_LOG_FUNCTION(this << agentId);
+    auto it = m_agents.find(agentId);
+    NS_ASSERT_MSG(it != m_agents.end(), "Agent " << agentId << " is not registered");
+    Ns3AiActionHold<Ptr<OpenGymDataContainer>>& actionHold = m_agentActionHolds[agentId];
+    if (actionHold.IsHolding())
+    {
+        if (!it->second->GetGameOver())
+        {
+            it->second->ExecuteActions(actionHold.Step(it->second->GetReward()));
+            return;
+        }
+        actionHold.Cancel();
+    }
+    m_readyAgents.insert(agentId);
+    if (!m_agentsNotifyScheduled)
+    {
+        m_agentsNotifyScheduled = true;
+        Simulator::ScheduleNow(&OpenGymInterface::NotifyAgentsState, this);
+    }
+}
+
+void
+OpenGymInterface::NotifyAgentsState()
+{
+    NS_LOG_FUNCTION(this);
+    m_agentsNotifyScheduled = false;
+    if (!m_initSimMsgSent)
+    {
+        Init();
+    }
+    if (m_stopEnvRequested || (m_readyAgents.empty() && !m_simEnd))
+    {
+        return;
+    }
+
+    // agents may become ready again while executing actions, so take the batch first
+    std::set<uint32_t> readyAgents;
+    if (m_simEnd)
+    {
+        // the final message carries every agent, with the reward accumulated by its hold
+        for (const auto& agent : m_agents)
+        {
+            readyAgents.insert(agent.first);
+        }
+        m_readyAgents.clear();
+    }
+    else
+    {
+        readyAgents.swap(m_readyAgents);
+    }
+    TimingStepBegin();
+
+    ns3_ai_gym::EnvStateMsg envStateMsg;
+    for (uint32_t agentId : readyAgents)
+    {
+        Ptr<OpenGymEnv> agent = m_agents.at(agentId);
+        ns3_ai_gym::AgentEnvState* agentState = envStateMsg.add_agents();
+        agentState->set_agentid(agentId);
+        Ptr<OpenGymDataContainer> obsDataContainer = agent->GetObservation();
+        if (obsDataContainer)
+        {
+            ns3_ai_gym::DataContainer obsDataContainerPbMsg =
+                obsDataContainer->GetDataContainerPbMsg();
+            if (m_obsNormalizer)
+            {
+                m_obsNormalizer->Process(obsDataContainerPbMsg);
+            }
+            agentState->mutable_obsdata()->CopyFrom(obsDataContainerPbMsg);
+        }
+        Ns3AiActionHold<Ptr<OpenGymDataContainer>>& actionHold = m_agentActionHolds[agentId];
+        agentState->set_reward(actionHold.TakeReward(agent->GetReward()));
+        agentState->set_heldsteps(actionHold.GetHeldSteps());
+        agentState->set_isgameover(m_simEnd || agent->GetGameOver());
+        agentState->set_info(agent->GetExtraInfo());
+    }
+    envStateMsg.set_isgameover(m_simEnd);
+    if (m_simEnd)
+    {
+        envStateMsg.set_reason(ns3_ai_gym::EnvStateMsg::SimulationEnd);
+    }
+    // in multi-agent mode, this also includes the protobuf encoding of the observations
+    m_curTiming.observationUs = TimingLap();
+
+    ns3_ai_gym::EnvActMsg envActMsg;
+    if (!ExchangeMsg(envStateMsg, envActMsg))
+    {
+        return;
+    }
+
+    for (const auto& agentAct : envActMsg.agents())
+    {
+        auto it = m_agents.find(agentAct.agentid());
+        if (it == m_agents.end())
+        {
+            NS_LOG_WARN("Action for unknown agent " << agentAct.agentid() << " ignored");
+            continue;
+        }
+        Ptr<OpenGymDataContainer> actDataContainer =
+            OpenGymDataContainer::CreateFromDataContainerPbMsg(agentAct.actdata());
+        it->second->ExecuteActions(actDataContainer);
+        if (agentAct.repeat() > 0 || agentAct.holdtime() > 0)
+        {
+            m_agentActionHolds[agentAct.agentid()].Hold(actDataContainer,
+                                                        agentAct.repeat(),
+                                                        Seconds(agentAct.holdtime()));
+        }
+    }
+    m_curTiming.executeUs = TimingLap();
+    TimingStepEnd();
+}
+
+void
+OpenGymInterface::SetTimingEnabled(bool enabled)
+{
+    NS_LOG_FUNCTION(this << enabled);
+    NS_ASSERT_MSG(!m_initSimMsgSent, "Timing must be set before the first notification");
+    m_timingEnabled = enabled;
+}
+
+const std::vector<OpenGymInterface::StepTiming>&
+OpenGymInterface::GetStepTimings() const
+{
+    return m_stepTimings;
+}
+
+const OpenGymInterface::StepTiming&
+OpenGymInterface::GetTimingTotals() const
+{
+    return m_timingTotals;
+}
+
+uint64_t
+OpenGymInterface::GetExchangeCount() const
+{
+    return m_exchangeCount;
+}
+
+void
+OpenGymInterface::TimingStepBegin()
+{
+    if (!m_timingEnabled)
+    {
+        return;
+    }
+    auto now = std::chrono::steady_clock::now();
+    if (m_timingTotals.step == 0)
+    {
+        m_timingOrigin = now;
+        m_lastStepEnd = now;
+    }
+    m_curTiming = StepTiming();
+    m_curTiming.step = m_timingTotals.step;
+    m_curTiming.simTime = Simulator::Now().GetSeconds();
+    m_curTiming.startUs =
+        std::chrono::duration_cast<std::chrono::microseconds>(now - m_timingOrigin).count();
+    m_curTiming.simulationUs =
+        std::chrono::duration_cast<std::chrono::microseconds>(now - m_lastStepEnd).count();
+    m_timingMark = now;
+}
+
+int64_t
+OpenGymInterface::TimingLap()
+{
+    if (!m_timingEnabled)
+    {
+        return 0;
+    }
+    auto now = std::chrono::steady_clock::now();
+    int64_t lap = std::chrono::duration_cast<std::chrono::microseconds>(now - m_timingMark).count();
+    m_timingMark = now;
+    return lap;
+}
+
+void
+OpenGymInterface::TimingStepEnd()
+{
+    if (!m_timingEnabled)
+    {
+        return;
+    }
+    m_lastStepEnd = m_timingMark;
+    m_timingTotals.step++;
+    m_timingTotals.simulationUs += m_curTiming.simulationUs;
+    m_timingTotals.observationUs += m_curTiming.observationUs;
+    m_timingTotals.serializationUs += m_curTiming.serializationUs;
+    m_timingTotals.waitUs += m_curTiming.waitUs;
+    m_timingTotals.deserializationUs += m_curTiming.deserializationUs;
+    m_timingTotals.executeUs += m_curTiming.executeUs;
+    m_timingTotals.pyDecodeUs += m_curTiming.pyDecodeUs;
+    m_timingTotals.pyAgentUs += m_curTiming.pyAgentUs;
+    m_timingTotals.pyEncodeUs += m_curTiming.pyEncodeUs;
+    if (m_stepTimings.size() < m_timingMaxSteps)
+    {
+        m_stepTimings.push_back(m_curTiming);
+    }
+}
+
+void
+OpenGymInterface::WriteTimingTrace(const std::string& filename) const
+{
+    NS_LOG_FUNCTION(this << filename);
+    std::ofstream ofs(filename);
+    NS_ABORT_MSG_IF(!ofs.is_open(), "Cannot open " << filename);
+
+    // complete events ("ph":"X"), C++ side on thread 1 and Python side on thread 2
+    bool first = true;
+    auto event = [&](const char* name, int tid, int64_t ts, int64_t dur, const StepTiming& t) {
+        ofs << (first ? "\n" : ",\n") << "{\"name\":\"" << name << "\",\"ph\":\"X\",\"pid\":1,"
+            << "\"tid\":" << tid << ",\"ts\":" << ts << ",\"dur\":" << dur
+            << ",\"args\":{\"step\":" << t.step << ",\"simTime\":" << t.simTime << "}}";
+        first = false;
+    };
+
+    ofs << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+    ofs << "\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":1,"
+        << "\"args\":{\"name\":\"ns-3\"}},"
+        << "\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":2,"
+        << "\"args\":{\"name\":\"Python\"}}";
+    first = false;
+    for (const auto& t : m_stepTimings)
+    {
+        int64_t ts = t.startUs - t.simulationUs;
+        event("simulation", 1, ts, t.simulationUs, t);
+        ts = t.startUs;
+        event("observation", 1, ts, t.observationUs, t);
+        ts += t.observationUs;
+        event("serialization", 1, ts, t.serializationUs, t);
+        ts += t.serializationUs;
+        event("wait python", 1, ts, t.waitUs, t);
+        // Python times are durations only, lay them out inside the wait
+        int64_t pyTs = ts;
+        event("decode", 2, pyTs, t.pyDecodeUs, t);
+        pyTs += t.pyDecodeUs;
+        event("agent", 2, pyTs, t.pyAgentUs, t);
+        pyTs += t.pyAgentUs;
+        event("encode", 2, pyTs, t.pyEncodeUs, t);
+        ts += t.waitUs;
+        event("deserialization", 1, ts, t.deserializationUs, t);
+        ts += t.deserializationUs;
+        event("execute actions", 1, ts, t.executeUs, t);
+    }
+    ofs << "\n]}\n";
+}
+
+void
+OpenGymInterface::SetObservationNormalizer(Ptr<OpenGymObsNormalizer> normalizer)
+{
+    NS_LOG_FUNCTION(this << normalizer);
+    NS_ASSERT_MSG(!m_initSimMsgSent, "The observation space has already been sent");
+    m_obsNormalizer = normalizer;
+}
+
+Ptr<OpenGymObsNormalizer>
+OpenGymInterface::GetObservationNormalizer() const
+{
+    return m_obsNormalizer;
+}
+
+bool
+OpenGymInterface::IsMultiAgent() const
+{
+    return !m_agents.empty();
 }
 
 void
@@ -257,7 +628,14 @@ OpenGymInterface::WaitForStop()
 {
     NS_LOG_FUNCTION(this);
     //    NS_LOG_UNCOND("Wait for stop message");
-    NotifyCurrentState();
+    if (IsMultiAgent())
+    {
+        NotifyAgentsState();
+    }
+    else
+    {
+        NotifyCurrentState();
+    }
 }
 
 void
@@ -265,6 +643,10 @@ OpenGymInterface::NotifySimulationEnd()
 {
     NS_LOG_FUNCTION(this);
     m_simEnd = true;
+    if (!m_timingTraceFile.empty())
+    {
+        WriteTimingTrace(m_timingTraceFile);
+    }
     if (m_initSimMsgSent)
     {
         WaitForStop();
@@ -407,6 +789,10 @@ void
 OpenGymInterface::DoDispose()
 {
     NS_LOG_FUNCTION(this);
+    m_obsNormalizer = nullptr;
+    m_agents.clear();
+    m_agentActionHolds.clear();
+    m_readyAgents.clear();
 }
 
 void
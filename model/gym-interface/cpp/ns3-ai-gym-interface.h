@@ -27,16 +27,30 @@
 
 #include <ns3/ai-module.h>
 #include <ns3/callback.h>
+#include <ns3/ns3-ai-action-hold.h>
 #include <ns3/object.h>
 #include <ns3/ptr.h>
 #include <ns3/type-id.h>
 
+#include <chrono>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+namespace ns3_ai_gym
+{
+class EnvStateMsg;
+class EnvActMsg;
+} // namespace ns3_ai_gym
+
 namespace ns3
 {
 // OpenGymSpace 和 OpenGymDataContainer 类的前置声明
 class OpenGymSpace;
 class OpenGymDataContainer;
 class OpenGymEnv;
+class OpenGymObsNormalizer;
 // OpenGymInterface 类的定义，继承自 ns3 的 Object 类
 class OpenGymInterface : public Object
 {
@@ -47,7 +61,14 @@ class OpenGymInterface : public Object
     static TypeId GetTypeId();// 获取类型标识
 
     void Init();// 初始化接口
-    void NotifyCurrentState();// 通知当前状态
+    /**
+     * \brief Send the current state to Python and execute the returned action.
+     *
+     * If Python asked to repeat its last action (EnvActMsg repeat / holdTime), the
+     * held action is executed again without contacting Python, and the rewards of
+     * the skipped steps are added to the reward of the next transition.
+     */
+    void NotifyCurrentState();
     void WaitForStop();// 等待停止
     void NotifySimulationEnd();// 通知仿真结束
 
@@ -70,6 +91,98 @@ class OpenGymInterface : public Object
     // 通知实体状态改变
     void Notify(Ptr<OpenGymEnv> entity);
 
+    /**
+     * \brief Wall-clock time breakdown of one step, in microseconds.
+     *
+     * The Python times are measured by Ns3Env and reported in the action message;
+     * they are part of waitUs.
+     */
+    struct StepTiming
+    {
+        uint64_t step{0};             //!< step index
+        double simTime{0};            //!< simulation time of the step, in seconds
+        int64_t startUs{0};           //!< start of the step, relative to the first step
+        int64_t simulationUs{0};      //!< simulation since the end of the previous step
+        int64_t observationUs{0};     //!< observation, reward, game over and info callbacks
+        int64_t serializationUs{0};   //!< protobuf encoding of the state message
+        int64_t waitUs{0};            //!< waiting for the Python reply
+        int64_t deserializationUs{0}; //!< protobuf decoding of the action message
+        int64_t executeUs{0};         //!< ExecuteActions callbacks
+        int64_t pyDecodeUs{0};        //!< Python: decoding the state message
+        int64_t pyAgentUs{0};         //!< Python: agent, between step() calls
+        int64_t pyEncodeUs{0};        //!< Python: encoding the action message
+    };
+
+    /**
+     * \brief Enable or disable the per-step timing breakdown.
+     */
+    void SetTimingEnabled(bool enabled);
+
+    /**
+     * \brief Get the timing of the recorded steps (at most TimingMaxSteps).
+     */
+    const std::vector<StepTiming>& GetStepTimings() const;
+
+    /**
+     * \brief Get the timing summed over all steps, with step set to the number of steps.
+     */
+    const StepTiming& GetTimingTotals() const;
+
+    /**
+     * \brief Get the number of state messages exchanged with Python so far. Steps
+     * re-applying a held action locally are not counted.
+     */
+    uint64_t GetExchangeCount() const;
+
+    /**
+     * \brief Write the recorded steps as a Chrome trace (JSON trace event format),
+     * which opens in chrome://tracing or https://ui.perfetto.dev.
+     */
+    void WriteTimingTrace(const std::string& filename) const;
+
+    /**
+     * \brief Preprocess observations (and the observation space) in C++ before they
+     * are sent to Python. Set before the first notification.
+     */
+    void SetObservationNormalizer(Ptr<OpenGymObsNormalizer> normalizer);
+
+    /**
+     * \brief Get the observation preprocessing stage, e.g., to checkpoint its statistics.
+     */
+    Ptr<OpenGymObsNormalizer> GetObservationNormalizer() const;
+
+    /**
+     * \brief Register an environment as one agent of a multi-agent setup.
+     *
+     * Once an agent is registered, the interface works in multi-agent mode: all
+     * agents that become ready at the same simulation time are sent to Python in
+     * one message, and their actions come back in one reply. All agents must share
+     * the observation and action spaces of the first registered agent.
+     */
+    void RegisterAgent(uint32_t agentId, Ptr<OpenGymEnv> agent);
+
+    /**
+     * \brief Remove an agent, e.g., when the socket it controls is closed.
+     */
+    void UnregisterAgent(uint32_t agentId);
+
+    /**
+     * \brief Mark an agent as ready. The batched exchange with Python is scheduled
+     * at the current simulation time, after the events already queued for it.
+     */
+    void NotifyAgentReady(uint32_t agentId);
+
+    /**
+     * \brief Send the states of all ready agents and execute the returned actions.
+     * At the simulation end, all registered agents are sent, as game over.
+     */
+    void NotifyAgentsState();
+
+    /**
+     * \brief Whether at least one agent has been registered.
+     */
+    bool IsMultiAgent() const;
+
   protected:
     // Inherited 
     void DoInitialize() override;// 初始化
@@ -79,9 +192,24 @@ class OpenGymInterface : public Object
     static Ptr<OpenGymInterface>* DoGet();// 静态方法，获取 OpenGymInterface 对象的指针
     //    static void Delete();
 
+    /**
+     * \brief Send a state message to Python and receive the action message.
+     * \return false if the simulation has ended and no action should be executed.
+     */
+    bool ExchangeMsg(const ns3_ai_gym::EnvStateMsg& envStateMsg,
+                     ns3_ai_gym::EnvActMsg& envActMsg);
+
+    /// Start the timing record of a step
+    void TimingStepBegin();
+    /// \return microseconds since the last timing mark, and move the mark to now
+    int64_t TimingLap();
+    /// Finish the timing record of a step
+    void TimingStepEnd();
+
     bool m_simEnd;// 成员变量，标记仿真是否结束
     bool m_stopEnvRequested;// 成员变量，标记停止仿真的请求
     bool m_initSimMsgSent;// 成员变量，标记仿真消息是否已发送
+    uint64_t m_exchangeCount; //!< state messages exchanged with Python
 
     Callback<Ptr<OpenGymSpace>> m_actionSpaceCb;// 回调函数，用于获取动作空间
     Callback<Ptr<OpenGymSpace>> m_observationSpaceCb;// 回调函数，用于获取观察空间
@@ -90,6 +218,25 @@ class OpenGymInterface : public Object
     Callback<float> m_rewardCb;// 回调函数，用于获取奖励
     Callback<std::string> m_extraInfoCb;// 回调函数，用于获取额外信息
     Callback<bool, Ptr<OpenGymDataContainer>> m_actionCb;// 回调函数，用于执行动作
+
+    Ns3AiActionHold<Ptr<OpenGymDataContainer>> m_actionHold; //!< action-repeat state
+    Ptr<OpenGymObsNormalizer> m_obsNormalizer; //!< optional observation preprocessing
+
+    bool m_timingEnabled;                             //!< whether steps are timed
+    std::string m_timingTraceFile;                    //!< trace written at simulation end
+    uint32_t m_timingMaxSteps;                        //!< max number of recorded steps
+    std::vector<StepTiming> m_stepTimings;            //!< recorded steps
+    StepTiming m_timingTotals;                        //!< timing summed over all steps
+    StepTiming m_curTiming;                           //!< timing of the current step
+    std::chrono::steady_clock::time_point m_timingOrigin;  //!< start of the first step
+    std::chrono::steady_clock::time_point m_timingMark;    //!< last timing mark
+    std::chrono::steady_clock::time_point m_lastStepEnd;   //!< end of the previous step
+
+    std::map<uint32_t, Ptr<OpenGymEnv>> m_agents; //!< registered agents in multi-agent mode
+    std::map<uint32_t, Ns3AiActionHold<Ptr<OpenGymDataContainer>>>
+        m_agentActionHolds; //!< action-repeat state of each agent
+    std::set<uint32_t> m_readyAgents;             //!< agents waiting for the next batched step
+    bool m_agentsNotifyScheduled;                 //!< whether NotifyAgentsState is scheduled
 };
 
 } // end of namespace ns3
@@ -1,3 +1,4 @@
+import time
 import numpy as np
 import gymnasium as gym
 from gymnasium import spaces
@@ -5,7 +6,7 @@ import messages_pb2 as pb
 import ns3ai_gym_msg_py as py_binding
 from ns3ai_utils import Experiment
 
-//这个类的目的是将NS3网络仿真嵌入到OpenAI Gym环境中，使得可以使用Gym的标准接口与NS3进行交互。类中的各个方法负责处理环境初始化、动作的发送与接收、环境状态的获取等任务。
+# 这个类的目的是将NS3网络仿真嵌入到OpenAI Gym环境中，使得可以使用Gym的标准接口与NS3进行交互。类中的各个方法负责处理环境初始化、动作的发送与接收、环境状态的获取等任务。
 class Ns3Env(gym.Env):
     _created = False
 
@@ -129,6 +130,8 @@ class Ns3Env(gym.Env):
 
         self.action_space = self._create_space(simInitMsg.actSpace)
         self.observation_space = self._create_space(simInitMsg.obsSpace)
+        self.multiAgent = simInitMsg.multiAgent
+        self.timing = simInitMsg.timing
 
         reply = pb.SimInitAck()
         reply.done = True
@@ -167,22 +170,38 @@ class Ns3Env(gym.Env):
 
         envStateMsg = pb.EnvStateMsg()
         self.msgInterface.PyRecvBegin()
+        decodeStart = time.perf_counter()
         request = self.msgInterface.GetCpp2PyStruct().get_buffer()
         envStateMsg.ParseFromString(request)
         self.msgInterface.PyRecvEnd()
 
-        self.obsData = self._create_data(envStateMsg.obsData)
-        self.reward = envStateMsg.reward
         self.gameOver = envStateMsg.isGameOver
         self.gameOverReason = envStateMsg.reason
 
+        if self.multiAgent:
+            # one entry per agent that is ready at this simulation time
+            self.agentIds = [agent.agentId for agent in envStateMsg.agents]
+            self.obsData = {agent.agentId: self._create_data(agent.obsData)
+                            for agent in envStateMsg.agents}
+            self.reward = {agent.agentId: agent.reward for agent in envStateMsg.agents}
+            self.agentDone = {agent.agentId: agent.isGameOver for agent in envStateMsg.agents}
+            self.heldSteps = {agent.agentId: agent.heldSteps for agent in envStateMsg.agents}
+            self.extraInfo = {agent.agentId: agent.info for agent in envStateMsg.agents}
+        else:
+            self.obsData = self._create_data(envStateMsg.obsData)
+            self.reward = envStateMsg.reward
+            self.heldSteps = envStateMsg.heldSteps
+            self.extraInfo = envStateMsg.info
+            if not self.extraInfo:
+                self.extraInfo = {}
+
+        # the agent time runs until the next send_actions()
+        self.stateRxTime = time.perf_counter()
+        self.pyDecodeUs = int((self.stateRxTime - decodeStart) * 1e6)
+
         if self.gameOver:
             self.send_close_command()
 
-        self.extraInfo = envStateMsg.info
-        if not self.extraInfo:
-            self.extraInfo = {}
-
         self.newStateRx = True
 
     def get_obs(self):
@@ -279,10 +298,31 @@ class Ns3Env(gym.Env):
     def send_actions(self, actions):
         # 发送动作给NS3仿真
         # ...
+        encodeStart = time.perf_counter()
         reply = pb.EnvActMsg()
 
-        actionMsg = self._pack_data(actions, self.action_space)
-        reply.actData.CopyFrom(actionMsg)
+        if self.multiAgent:
+            # actions is a dict keyed by agent ID, or a sequence ordered as self.agentIds
+            if not isinstance(actions, dict):
+                assert len(actions) == len(self.agentIds)
+                actions = dict(zip(self.agentIds, actions))
+            for agentId, agentActions in actions.items():
+                agentAct = reply.agents.add()
+                agentAct.agentId = agentId
+                agentAct.actData.CopyFrom(self._pack_data(agentActions, self.action_space))
+                agentAct.repeat = self.actionRepeat
+                agentAct.holdTime = self.actionHoldTime
+        else:
+            actionMsg = self._pack_data(actions, self.action_space)
+            reply.actData.CopyFrom(actionMsg)
+            reply.repeat = self.actionRepeat
+            reply.holdTime = self.actionHoldTime
+
+        if self.timing:
+            # the encode time covers packing the actions, not the final serialization
+            reply.pyTiming.decodeUs = self.pyDecodeUs
+            reply.pyTiming.agentUs = int((encodeStart - self.stateRxTime) * 1e6)
+            reply.pyTiming.encodeUs = int((time.perf_counter() - encodeStart) * 1e6)
 
         replyMsg = reply.SerializeToString()
         assert len(replyMsg) <= py_binding.msg_buffer_size
@@ -293,6 +333,13 @@ class Ns3Env(gym.Env):
         self.newStateRx = False
         return True
 
+    def set_action_hold(self, repeat=0, holdTime=0.0):
+        # Let the simulator re-apply each action on the following `repeat` steps
+        # and/or for `holdTime` seconds, without asking Python. The rewards of the
+        # skipped steps are summed into the next transition (info["heldSteps"]).
+        self.actionRepeat = int(repeat)
+        self.actionHoldTime = float(holdTime)
+
     def get_state(self):
         # 返回当前的环境状态
         # 包括观测值、奖励、游戏是否结束等信息
@@ -300,7 +347,9 @@ class Ns3Env(gym.Env):
         obs = self.get_obs()
         reward = self.get_reward()
         done = self.is_game_over()
-        extraInfo = {"info": self.get_extra_info()}
+        extraInfo = {"info": self.get_extra_info(), "heldSteps": self.heldSteps}
+        if self.multiAgent:
+            extraInfo["agentDone"] = self.agentDone
         return obs, reward, done, False, extraInfo
 
     def __init__(self, targetName, ns3Path, ns3Settings=None, shmSize=4096):
@@ -310,6 +359,8 @@ class Ns3Env(gym.Env):
         self._created = True
         self.exp = Experiment(targetName, ns3Path, py_binding, shmSize=shmSize)
         self.ns3Settings = ns3Settings
+        self.actionRepeat = 0
+        self.actionHoldTime = 0.0
 
         self.newStateRx = False
         self.obsData = None
@@ -317,6 +368,13 @@ class Ns3Env(gym.Env):
         self.gameOver = False
         self.gameOverReason = None
         self.extraInfo = None
+        self.multiAgent = False
+        self.agentIds = []
+        self.agentDone = {}
+        self.heldSteps = 0
+        self.timing = False
+        self.pyDecodeUs = 0
+        self.stateRxTime = 0.0
 
         self.msgInterface = self.exp.run(setting=self.ns3Settings, show_output=True)
         self.initialize_env()
@@ -351,6 +409,13 @@ class Ns3Env(gym.Env):
         self.gameOver = False
         self.gameOverReason = None
         self.extraInfo = None
+        self.multiAgent = False
+        self.agentIds = []
+        self.agentDone = {}
+        self.heldSteps = 0
+        self.timing = False
+        self.pyDecodeUs = 0
+        self.stateRxTime = 0.0
 
         self.msgInterface = self.exp.run(show_output=True)
         self.initialize_env()
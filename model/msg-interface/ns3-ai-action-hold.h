@@ -0,0 +1,143 @@
+/*
+ * Copyright (c) 2023 Huazhong University of Science and Technology
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef NS3_AI_ACTION_HOLD_H
+#define NS3_AI_ACTION_HOLD_H
+
+#include <ns3/nstime.h>
+#include <ns3/simulator.h>
+
+#include <cstdint>
+
+namespace ns3
+{
+
+/**
+ * \brief Action-repeat (frame-skip) helper for time-stepped environments.
+ *
+ * After Python replies with an action and a repeat count and/or a hold duration,
+ * call Hold(). While IsHolding() returns true, the environment skips the exchange
+ * with Python: it calls Step() with the reward of the step and re-applies the
+ * returned action. When the hold expires, TakeReward() returns the reward
+ * accumulated over the skipped steps plus the current one, which is sent to
+ * Python as one aggregated transition. Environments without a C++ reward use
+ * Step() and TakeHeldSteps() instead, which only count the skipped steps.
+ *
+ * \tparam ActType Action type, e.g., the Py2Cpp struct of the message interface.
+ */
+template <typename ActType>
+class Ns3AiActionHold
+{
+  public:
+    /**
+     * \brief Hold an action.
+     * \param act The action to re-apply on skipped steps.
+     * \param repeat Number of following steps on which the action is re-applied.
+     * \param holdTime Duration (from now) during which the action is re-applied.
+     */
+    void Hold(const ActType& act, uint32_t repeat, Time holdTime)
+    {
+        m_act = act;
+        m_remaining = repeat;
+        m_holdUntil = Simulator::Now() + holdTime;
+    }
+
+    /**
+     * \brief Whether the current step should be skipped.
+     */
+    bool IsHolding() const
+    {
+        return m_remaining > 0 || Simulator::Now() < m_holdUntil;
+    }
+
+    /**
+     * \brief Account for one skipped step.
+     * \param reward Reward of the skipped step.
+     * \return The held action, to be applied again.
+     */
+    const ActType& Step(double reward)
+    {
+        m_reward += reward;
+        return Step();
+    }
+
+    /**
+     * \brief Account for one skipped step, without reward.
+     * \return The held action, to be applied again.
+     */
+    const ActType& Step()
+    {
+        if (m_remaining > 0)
+        {
+            m_remaining--;
+        }
+        m_heldSteps++;
+        return m_act;
+    }
+
+    /**
+     * \brief Get the aggregated reward of the transition and reset the accumulator.
+     * \param reward Reward of the current (not skipped) step.
+     */
+    double TakeReward(double reward)
+    {
+        double total = m_reward + reward;
+        m_reward = 0;
+        TakeHeldSteps();
+        return total;
+    }
+
+    /**
+     * \brief Close the transition without reward.
+     * \return The number of steps skipped in the transition, also given by GetHeldSteps().
+     */
+    uint32_t TakeHeldSteps()
+    {
+        m_lastHeldSteps = m_heldSteps;
+        m_heldSteps = 0;
+        return m_lastHeldSteps;
+    }
+
+    /**
+     * \brief Stop holding, e.g., when the game is over.
+     */
+    void Cancel()
+    {
+        m_remaining = 0;
+        m_holdUntil = Time(0);
+    }
+
+    /**
+     * \brief Number of steps skipped in the transition returned by the last TakeReward().
+     */
+    uint32_t GetHeldSteps() const
+    {
+        return m_lastHeldSteps;
+    }
+
+  private:
+    ActType m_act{};             //!< held action
+    uint32_t m_remaining{0};     //!< remaining steps to repeat
+    Time m_holdUntil{0};         //!< hold the action until this time
+    double m_reward{0};          //!< reward accumulated over skipped steps
+    uint32_t m_heldSteps{0};     //!< steps skipped so far in the current hold
+    uint32_t m_lastHeldSteps{0}; //!< steps skipped in the last transition
+};
+
+} // namespace ns3
+
+#endif // NS3_AI_ACTION_HOLD_H
@@ -212,6 +212,17 @@ class Ns3AiMsgInterfaceImpl
         Ns3AiSemaphore::sem_wait(&m_sync->m_py2cppFullCount);
     };
 
+    /**
+     * C++ side starts reading from shared memory if Python has
+     * replied, without waiting otherwise
+     * \return Whether the reading started, in which case
+     * CppRecvEnd must follow
+     */
+    bool CppTryRecvBegin()
+    {
+        return Ns3AiSemaphore::sem_try_wait(&m_sync->m_py2cppFullCount);
+    };
+
     /**
      * C++ side stops reading from shared memory, struct-based
      * or vector-based
@@ -0,0 +1,165 @@
+/*
+ * Copyright (c) 2023 Huazhong University of Science and Technology
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef NS3_AI_POLICY_TABLE_H
+#define NS3_AI_POLICY_TABLE_H
+
+#include <ns3/assert.h>
+#include <ns3/nstime.h>
+#include <ns3/simulator.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+namespace ns3
+{
+
+/**
+ * \brief Decision table pushed by Python and sampled locally in C++.
+ *
+ * Instead of asking Python for every decision (e.g., the MCS of every frame),
+ * Python replies once with a probability for each choice and a validity time.
+ * Until the table expires, C++ draws the decisions from it with its own random
+ * stream, so that they no longer wait for the IPC.
+ *
+ * Optionally, Python also gives the expected success rate of each choice. The
+ * outcomes reported with ReportOutcome() are then compared with it, and the table
+ * is invalidated early when the observed success rate drifts away from the
+ * expected one, so that Python is asked again.
+ */
+class Ns3AiPolicyTable
+{
+  public:
+    /**
+     * \brief Replace the table.
+     * \param probabilities Weight of each choice, normalized here.
+     * \param successRates Expected success rate of each choice, or nullptr to disable
+     * the drift detection.
+     * \param n Number of choices.
+     * \param validity The table expires after this duration, from now.
+     */
+    void Set(const float* probabilities, const float* successRates, uint32_t n, Time validity)
+    {
+        NS_ASSERT_MSG(n > 0, "Empty policy table");
+        m_cdf.resize(n);
+        double sum = 0;
+        for (uint32_t i = 0; i < n; i++)
+        {
+            NS_ASSERT_MSG(probabilities[i] >= 0, "Negative probability in policy table");
+            sum += probabilities[i];
+            m_cdf[i] = sum;
+        }
+        NS_ASSERT_MSG(sum > 0, "All probabilities are zero in policy table");
+        for (auto& c : m_cdf)
+        {
+            c /= sum;
+        }
+        if (successRates)
+        {
+            m_successRates.assign(successRates, successRates + n);
+        }
+        else
+        {
+            m_successRates.clear();
+        }
+        m_expires = Simulator::Now() + validity;
+        m_frames = 0;
+        m_observed = 0;
+        m_expected = 0;
+        m_drifted = false;
+    }
+
+    /**
+     * \brief Whether decisions can be drawn from the table: it is set, not expired
+     * and no drift was detected.
+     */
+    bool IsValid() const
+    {
+        return !m_cdf.empty() && !m_drifted && Simulator::Now() < m_expires;
+    }
+
+    /**
+     * \brief Force Python to be asked at the next decision.
+     */
+    void Invalidate()
+    {
+        m_drifted = true;
+    }
+
+    /**
+     * \brief Draw a choice.
+     * \param u Uniform random value in [0, 1), from the caller's random stream.
+     */
+    uint32_t Sample(double u) const
+    {
+        NS_ASSERT_MSG(!m_cdf.empty(), "Policy table is not set");
+        auto it = std::upper_bound(m_cdf.begin(), m_cdf.end(), u);
+        return std::min<size_t>(it - m_cdf.begin(), m_cdf.size() - 1);
+    }
+
+    /**
+     * \brief Enable the drift detection.
+     * \param threshold Maximum absolute difference between the observed and the
+     * expected success rates.
+     * \param minFrames Number of frames needed before the rates are compared.
+     */
+    void SetDriftDetection(double threshold, uint32_t minFrames)
+    {
+        m_threshold = threshold;
+        m_minFrames = minFrames;
+    }
+
+    /**
+     * \brief Report the outcome of frames sent with a choice of the table.
+     */
+    void ReportOutcome(uint32_t choice, uint32_t success, uint32_t fail)
+    {
+        if (m_successRates.empty() || m_threshold <= 0 || choice >= m_successRates.size())
+        {
+            return;
+        }
+        m_frames += success + fail;
+        m_observed += success;
+        m_expected += (success + fail) * m_successRates[choice];
+        if (m_frames >= m_minFrames && std::abs(m_observed - m_expected) > m_threshold * m_frames)
+        {
+            m_drifted = true;
+        }
+    }
+
+    uint32_t GetSize() const
+    {
+        return m_cdf.size();
+    }
+
+  private:
+    std::vector<double> m_cdf;         //!< cumulative probabilities of the choices
+    std::vector<float> m_successRates; //!< expected success rate of each choice
+    Time m_expires{0};                 //!< expiration time of the table
+    double m_threshold{0};             //!< drift threshold, 0 to disable
+    uint32_t m_minFrames{0};           //!< frames before the drift is checked
+    uint64_t m_frames{0};              //!< frames reported on this table
+    double m_observed{0};              //!< successful frames reported on this table
+    double m_expected{0};              //!< expected successful frames
+    bool m_drifted{false};             //!< whether the table was invalidated
+};
+
+} // namespace ns3
+
+#endif // NS3_AI_POLICY_TABLE_H
@@ -0,0 +1,233 @@
+/*
+ * Copyright (c) 2023 Huazhong University of Science and Technology
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef NS3_AI_REPORT_POLICY_H
+#define NS3_AI_REPORT_POLICY_H
+
+#include <ns3/assert.h>
+#include <ns3/fatal-error.h>
+#include <ns3/nstime.h>
+#include <ns3/simulator.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace ns3
+{
+
+/**
+ * \brief Event-triggered reporting policy for environments.
+ *
+ * Before each exchange with the agent, an environment passes the current values
+ * of all the features it can provide to ShouldReport(). A report is due when a
+ * selected feature changed since the last report by more than its absolute or
+ * relative threshold (any change at all if both thresholds are 0), or when no
+ * report was sent for longer than the max silence time. Otherwise the exchange
+ * is skipped and the last action stays in force. With no feature selected and no
+ * max silence set, every step is reported.
+ */
+class Ns3AiReportPolicy
+{
+  public:
+    /// Help of the ReportAbsThreshold attribute of the environments
+    static constexpr const char* ABS_THRESHOLD_HELP =
+        "Absolute change of a report feature that triggers a report. 0: disabled, or any "
+        "change if ReportRelThreshold is 0 too";
+    /// Help of the ReportRelThreshold attribute of the environments
+    static constexpr const char* REL_THRESHOLD_HELP =
+        "Relative change of a report feature that triggers a report. 0: disabled, or any "
+        "change if ReportAbsThreshold is 0 too";
+    /// Help of the ReportMaxSilence attribute of the environments
+    static constexpr const char* MAX_SILENCE_HELP = "Max interval without report. 0: no limit";
+
+    /**
+     * \brief Get the help of the ReportFeatures attribute of an environment.
+     * \param names Names of the values passed to ShouldReport(), in order.
+     * \return The help, which lists the names.
+     */
+    static std::string GetFeaturesHelp(const std::vector<std::string>& names)
+    {
+        std::string help = "Comma separated features whose change triggers a report:";
+        for (std::size_t i = 0; i < names.size(); i++)
+        {
+            help += (i ? ", " : " ") + names[i];
+        }
+        return help + ". Empty: report every step";
+    }
+
+    /**
+     * \brief Configure the policy from the Report* attributes of an environment,
+     * replacing any previous configuration.
+     * \param features Comma separated feature names (ReportFeatures).
+     * \param names Names of the values passed to ShouldReport(), in order.
+     * \param absThreshold Absolute change threshold (ReportAbsThreshold).
+     * \param relThreshold Relative change threshold (ReportRelThreshold).
+     * \param maxSilence Max interval without report (ReportMaxSilence).
+     */
+    void Configure(const std::string& features,
+                   const std::vector<std::string>& names,
+                   double absThreshold,
+                   double relThreshold,
+                   Time maxSilence)
+    {
+        m_features.clear();
+        m_lastValues.clear();
+        m_hasReported = false;
+        SelectFeatures(features, names, absThreshold, relThreshold);
+        SetMaxSilence(maxSilence);
+    }
+
+    /**
+     * \brief Select a feature for change detection.
+     * \param index Index of the feature in the values passed to ShouldReport().
+     * \param absThreshold Report when |value - last| > absThreshold (0 to disable).
+     * \param relThreshold Report when |value - last| > relThreshold * |last| (0 to disable).
+     *
+     * If both thresholds are 0, any change of the feature triggers a report.
+     */
+    void AddFeature(uint32_t index, double absThreshold, double relThreshold)
+    {
+        m_features.push_back({index, absThreshold, relThreshold});
+    }
+
+    /**
+     * \brief Select features by name with the same thresholds.
+     * \param list Comma separated feature names, e.g., "cWnd,rtt".
+     * \param names Names of the values passed to ShouldReport(), in order.
+     * \param absThreshold Absolute change threshold (0 to disable).
+     * \param relThreshold Relative change threshold (0 to disable).
+     *
+     * If both thresholds are 0, any change of the features triggers a report.
+     */
+    void SelectFeatures(const std::string& list,
+                        const std::vector<std::string>& names,
+                        double absThreshold,
+                        double relThreshold)
+    {
+        std::istringstream iss(list);
+        std::string name;
+        while (std::getline(iss, name, ','))
+        {
+            if (name.empty())
+            {
+                continue;
+            }
+            auto it = std::find(names.begin(), names.end(), name);
+            if (it == names.end())
+            {
+                NS_FATAL_ERROR("Unknown report feature: " << name);
+            }
+            AddFeature(it - names.begin(), absThreshold, relThreshold);
+        }
+    }
+
+    /**
+     * \brief Report at least once in this interval (0 to disable).
+     */
+    void SetMaxSilence(Time maxSilence)
+    {
+        m_maxSilence = maxSilence;
+    }
+
+    /**
+     * \brief Decide whether the current values are reported.
+     * \param values Current values of all features.
+     * \return true if a report is due. The values then become the reference of the
+     *         next decision.
+     */
+    bool ShouldReport(const std::vector<double>& values)
+    {
+        bool report = !m_hasReported || IsSilenceExpired() ||
+                      (m_features.empty() && m_maxSilence.IsZero());
+        for (std::size_t i = 0; !report && i < m_features.size(); i++)
+        {
+            const Feature& f = m_features[i];
+            NS_ASSERT_MSG(f.index < values.size(), "Missing value of feature " << f.index);
+            double diff = std::abs(values[f.index] - m_lastValues[i]);
+            if (f.absThreshold == 0 && f.relThreshold == 0)
+            {
+                // no threshold: any change
+                report = diff > 0;
+                continue;
+            }
+            report = (f.absThreshold > 0 && diff > f.absThreshold) ||
+                     (f.relThreshold > 0 && diff > f.relThreshold * std::abs(m_lastValues[i]));
+        }
+
+        if (!report)
+        {
+            m_suppressed++;
+            return false;
+        }
+        m_lastValues.resize(m_features.size());
+        for (std::size_t i = 0; i < m_features.size(); i++)
+        {
+            m_lastValues[i] = values[m_features[i].index];
+        }
+        m_hasReported = true;
+        m_lastReport = Simulator::Now();
+        m_reported++;
+        return true;
+    }
+
+    /**
+     * \brief Number of reports sent.
+     */
+    uint64_t GetReportedCount() const
+    {
+        return m_reported;
+    }
+
+    /**
+     * \brief Number of reports suppressed because no feature changed enough.
+     */
+    uint64_t GetSuppressedCount() const
+    {
+        return m_suppressed;
+    }
+
+  private:
+    /// A feature selected for change detection
+    struct Feature
+    {
+        uint32_t index;      //!< index in the values passed to ShouldReport()
+        double absThreshold; //!< absolute change threshold
+        double relThreshold; //!< relative change threshold
+    };
+
+    bool IsSilenceExpired() const
+    {
+        return m_maxSilence.IsStrictlyPositive() &&
+               Simulator::Now() - m_lastReport >= m_maxSilence;
+    }
+
+    std::vector<Feature> m_features;  //!< selected features
+    std::vector<double> m_lastValues; //!< values of the selected features at the last report
+    bool m_hasReported{false};        //!< whether a report has been sent
+    Time m_maxSilence{0};             //!< max interval without report
+    Time m_lastReport{0};             //!< time of the last report
+    uint64_t m_reported{0};           //!< reports sent
+    uint64_t m_suppressed{0};         //!< reports suppressed
+};
+
+} // namespace ns3
+
+#endif // NS3_AI_REPORT_POLICY_H
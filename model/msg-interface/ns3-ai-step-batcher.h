@@ -0,0 +1,125 @@
+/*
+ * Copyright (c) 2023 Huazhong University of Science and Technology
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef NS3_AI_STEP_BATCHER_H
+#define NS3_AI_STEP_BATCHER_H
+
+#include <ns3/assert.h>
+#include <ns3/callback.h>
+#include <ns3/simulator.h>
+
+#include <cstdint>
+#include <vector>
+
+namespace ns3
+{
+
+/**
+ * \brief Batches the requests of many environments made at the same simulation time.
+ *
+ * Each environment due for a step calls Request() with its observation and a
+ * callback receiving its action. The first request at a timestamp schedules a
+ * flush with Simulator::ScheduleNow(), which runs after all events already
+ * scheduled for that timestamp, so all environments stepping at the same time
+ * are served by a single call of the batch handler (e.g., one batched forward
+ * pass or one IPC round). The actions are then dispatched in request order.
+ *
+ * \tparam ObsType Observation of one environment.
+ * \tparam ActType Action of one environment.
+ */
+template <typename ObsType, typename ActType>
+class Ns3AiStepBatcher
+{
+  public:
+    /// Computes the actions of a batch of observations, in the same order
+    typedef Callback<void, const std::vector<ObsType>&, std::vector<ActType>&> BatchHandler;
+
+    /**
+     * \brief Set the handler computing a batch of actions.
+     */
+    void SetBatchHandler(BatchHandler handler)
+    {
+        m_handler = handler;
+    }
+
+    /**
+     * \brief Queue an observation for the batch of the current simulation time.
+     * \param obs The observation.
+     * \param onAction Called with the action when the batch is flushed.
+     */
+    void Request(const ObsType& obs, Callback<void, const ActType&> onAction)
+    {
+        m_obs.push_back(obs);
+        m_callbacks.push_back(onAction);
+        if (!m_flushScheduled)
+        {
+            m_flushScheduled = true;
+            Simulator::ScheduleNow(&Ns3AiStepBatcher::Flush, this);
+        }
+    }
+
+    /**
+     * \brief Number of batches flushed.
+     */
+    uint64_t GetBatchCount() const
+    {
+        return m_batches;
+    }
+
+    /**
+     * \brief Number of requests served.
+     */
+    uint64_t GetRequestCount() const
+    {
+        return m_requests;
+    }
+
+  private:
+    void Flush()
+    {
+        NS_ASSERT_MSG(!m_handler.IsNull(), "No batch handler set");
+        m_flushScheduled = false;
+        // swap out the batch, so the callbacks may already request the next step
+        m_batchObs.swap(m_obs);
+        m_batchCallbacks.swap(m_callbacks);
+        m_obs.clear();
+        m_callbacks.clear();
+
+        m_actions.resize(m_batchObs.size());
+        m_handler(m_batchObs, m_actions);
+        m_batches++;
+        m_requests += m_batchObs.size();
+        for (std::size_t i = 0; i < m_batchCallbacks.size(); i++)
+        {
+            m_batchCallbacks[i](m_actions[i]);
+        }
+    }
+
+    BatchHandler m_handler;                                       //!< computes a batch of actions
+    std::vector<ObsType> m_obs;                                   //!< pending observations
+    std::vector<Callback<void, const ActType&>> m_callbacks;      //!< pending callbacks
+    std::vector<ObsType> m_batchObs;                              //!< observations being served
+    std::vector<Callback<void, const ActType&>> m_batchCallbacks; //!< callbacks being served
+    std::vector<ActType> m_actions;                               //!< actions of the batch
+    bool m_flushScheduled{false};                                 //!< whether a flush is pending
+    uint64_t m_batches{0};                                        //!< batches flushed
+    uint64_t m_requests{0};                                       //!< requests served
+};
+
+} // namespace ns3
+
+#endif // NS3_AI_STEP_BATCHER_H
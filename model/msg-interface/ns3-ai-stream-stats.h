@@ -0,0 +1,252 @@
+/*
+ * Copyright (c) 2023 Huazhong University of Science and Technology
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef NS3_AI_STREAM_STATS_H
+#define NS3_AI_STREAM_STATS_H
+
+#include <ns3/assert.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+
+namespace ns3
+{
+
+/**
+ * \brief Constant-time, constant-memory aggregation of a stream of samples.
+ *
+ * Replaces storing every sample of a step (e.g., one per ACK) and summing them
+ * when the step ends. Add() updates the count, sum, min, max and an exponentially
+ * weighted moving average in O(1), and optionally a P-square estimate of one
+ * quantile (Jain and Chlamtac, 1985), which uses five markers instead of the
+ * samples.
+ *
+ * Reset() starts a new window (count, sum, min, max and quantile), while the EWMA
+ * carries over across windows.
+ */
+class Ns3AiStreamStats
+{
+  public:
+    /**
+     * \param ewmaAlpha Weight of a new sample in the EWMA.
+     */
+    explicit Ns3AiStreamStats(double ewmaAlpha = 0.125)
+        : m_ewmaAlpha(ewmaAlpha)
+    {
+        NS_ASSERT_MSG(ewmaAlpha > 0 && ewmaAlpha <= 1, "EWMA alpha must be in (0, 1]");
+    }
+
+    /**
+     * \brief Estimate the p-quantile of each window, e.g., 0.5 for the median.
+     */
+    void EnableQuantile(double p)
+    {
+        NS_ASSERT_MSG(p > 0 && p < 1, "Quantile must be in (0, 1)");
+        m_quantileEnabled = true;
+        m_p = p;
+        Reset();
+    }
+
+    void Add(double x)
+    {
+        if (m_count == 0)
+        {
+            m_min = x;
+            m_max = x;
+        }
+        else
+        {
+            m_min = std::min(m_min, x);
+            m_max = std::max(m_max, x);
+        }
+        m_ewma = m_ewmaInitialized ? m_ewma + m_ewmaAlpha * (x - m_ewma) : x;
+        m_ewmaInitialized = true;
+        m_sum += x;
+        m_count++;
+        if (m_quantileEnabled)
+        {
+            AddToQuantile(x);
+        }
+    }
+
+    /**
+     * \brief Start a new window. The EWMA is kept.
+     */
+    void Reset()
+    {
+        m_count = 0;
+        m_sum = 0;
+        m_min = 0;
+        m_max = 0;
+    }
+
+    uint64_t GetCount() const
+    {
+        return m_count;
+    }
+
+    double GetSum() const
+    {
+        return m_sum;
+    }
+
+    /// \return the mean of the window, 0 if empty
+    double GetMean() const
+    {
+        return m_count ? m_sum / m_count : 0;
+    }
+
+    /// \return the minimum of the window, 0 if empty
+    double GetMin() const
+    {
+        return m_min;
+    }
+
+    /// \return the maximum of the window, 0 if empty
+    double GetMax() const
+    {
+        return m_max;
+    }
+
+    /// \return the EWMA of all samples, 0 before the first one
+    double GetEwma() const
+    {
+        return m_ewma;
+    }
+
+    /**
+     * \return the estimated quantile of the window (exact below five samples), 0 if empty
+     */
+    double GetQuantile() const
+    {
+        NS_ASSERT_MSG(m_quantileEnabled, "Quantile estimation is not enabled");
+        if (m_count == 0)
+        {
+            return 0;
+        }
+        if (m_count < 5)
+        {
+            // the first samples are kept sorted in the markers
+            auto rank = (uint64_t)std::ceil(m_p * m_count);
+            return m_q[std::max<uint64_t>(rank, 1) - 1];
+        }
+        return m_q[2];
+    }
+
+  private:
+    void AddToQuantile(double x)
+    {
+        if (m_count <= 5)
+        {
+            // insertion sort of the first samples into the markers
+            int i = m_count - 1;
+            for (; i > 0 && m_q[i - 1] > x; i--)
+            {
+                m_q[i] = m_q[i - 1];
+            }
+            m_q[i] = x;
+            if (m_count == 5)
+            {
+                for (int j = 0; j < 5; j++)
+                {
+                    m_n[j] = j + 1;
+                }
+                m_desired[0] = 1;
+                m_desired[1] = 1 + 2 * m_p;
+                m_desired[2] = 1 + 4 * m_p;
+                m_desired[3] = 3 + 2 * m_p;
+                m_desired[4] = 5;
+            }
+            return;
+        }
+
+        // cell of the new sample, extending the extreme markers if needed
+        int k;
+        if (x < m_q[0])
+        {
+            m_q[0] = x;
+            k = 0;
+        }
+        else if (x >= m_q[4])
+        {
+            m_q[4] = x;
+            k = 3;
+        }
+        else
+        {
+            for (k = 0; x >= m_q[k + 1]; k++)
+            {
+            }
+        }
+        for (int i = k + 1; i < 5; i++)
+        {
+            m_n[i]++;
+        }
+        const double increments[5] = {0, m_p / 2, m_p, (1 + m_p) / 2, 1};
+        for (int i = 0; i < 5; i++)
+        {
+            m_desired[i] += increments[i];
+        }
+
+        // move the middle markers towards their desired positions
+        for (int i = 1; i < 4; i++)
+        {
+            double d = m_desired[i] - m_n[i];
+            if ((d >= 1 && m_n[i + 1] - m_n[i] > 1) || (d <= -1 && m_n[i - 1] - m_n[i] < -1))
+            {
+                int s = d > 0 ? 1 : -1;
+                double q = Parabolic(i, s);
+                if (m_q[i - 1] < q && q < m_q[i + 1])
+                {
+                    m_q[i] = q;
+                }
+                else
+                {
+                    m_q[i] += s * (m_q[i + s] - m_q[i]) / (m_n[i + s] - m_n[i]);
+                }
+                m_n[i] += s;
+            }
+        }
+    }
+
+    double Parabolic(int i, int s) const
+    {
+        return m_q[i] + (double)s / (m_n[i + 1] - m_n[i - 1]) *
+                            ((m_n[i] - m_n[i - 1] + s) * (m_q[i + 1] - m_q[i]) /
+                                 (m_n[i + 1] - m_n[i]) +
+                             (m_n[i + 1] - m_n[i] - s) * (m_q[i] - m_q[i - 1]) /
+                                 (m_n[i] - m_n[i - 1]));
+    }
+
+    uint64_t m_count{0};           //!< samples in the window
+    double m_sum{0};               //!< sum of the window
+    double m_min{0};               //!< minimum of the window
+    double m_max{0};               //!< maximum of the window
+    double m_ewmaAlpha;            //!< weight of a new sample in the EWMA
+    double m_ewma{0};              //!< EWMA of all samples
+    bool m_ewmaInitialized{false}; //!< whether a sample was seen
+    bool m_quantileEnabled{false}; //!< whether the quantile is estimated
+    double m_p{0.5};               //!< estimated quantile
+    double m_q[5]{};               //!< marker heights
+    double m_n[5]{};               //!< marker positions
+    double m_desired[5]{};         //!< desired marker positions
+};
+
+} // namespace ns3
+
+#endif // NS3_AI_STREAM_STATS_H
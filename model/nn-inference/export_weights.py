@@ -0,0 +1,154 @@
+# Copyright (c) 2023 Huazhong University of Science and Technology
+#
+# This program is free software; you can redistribute it and/or modify
+# it under the terms of the GNU General Public License version 2 as
+# published by the Free Software Foundation;
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program; if not, write to the Free Software
+# Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+"""Export PyTorch or Keras models to the weight format of Ns3AiNnModel (ns3-ai-nn.h).
+
+Usage:
+    from export_weights import export_torch, export_keras
+    export_torch(torch_model, "policy.nn")   # nn.Sequential or a list of modules
+    export_keras(keras_model, "cqi.nn")
+"""
+
+import struct
+import sys
+from array import array
+
+DENSE = 1
+RELU = 2
+SELU = 3
+TANH = 4
+SIGMOID = 5
+LSTM = 6
+GRU = 7
+ARGMAX = 8
+
+_ACTIVATIONS = {'relu': RELU, 'selu': SELU, 'tanh': TANH, 'sigmoid': SIGMOID}
+
+
+def _flatten(x):
+    # accept numpy arrays, torch tensors and nested lists
+    if hasattr(x, 'detach'):
+        x = x.detach().cpu().numpy()
+    if hasattr(x, 'ravel'):
+        return [float(v) for v in x.ravel()]
+    if isinstance(x, (list, tuple)):
+        return [v for e in x for v in _flatten(e)]
+    return [float(x)]
+
+
+def _floats(x):
+    a = array('f', _flatten(x))
+    if sys.byteorder != 'little':
+        a.byteswap()
+    return a.tobytes()
+
+
+def write_layers(filename, layers):
+    """Write layers given as (type, params) tuples.
+
+    Params: dense (in, out, W[out][in], b[out]); LSTM (in, hidden, W_ih[4H][in],
+    W_hh[4H][H], b[4H]); GRU (in, hidden, W_ih[3H][in], W_hh[3H][H], b_ih[3H],
+    b_hh[3H]); activations and argmax ().
+    """
+    with open(filename, 'wb') as f:
+        f.write(b'NS3AINN\0')
+        f.write(struct.pack('<II', 1, len(layers)))
+        for layerType, params in layers:
+            f.write(struct.pack('<I', layerType))
+            if params:
+                f.write(struct.pack('<II', params[0], params[1]))
+                for p in params[2:]:
+                    f.write(_floats(p))
+
+
+def export_torch(model, filename):
+    """Export an nn.Sequential (or a list of modules) of Linear, ReLU, SELU, Tanh,
+    Sigmoid and single-layer LSTM / GRU modules."""
+    import torch.nn as nn
+
+    modules = list(model) if isinstance(model, (nn.Sequential, list, tuple)) else [model]
+    layers = []
+    for m in modules:
+        if isinstance(m, nn.Linear):
+            bias = m.bias if m.bias is not None else [0.0] * m.out_features
+            layers.append((DENSE, (m.in_features, m.out_features, m.weight, bias)))
+        elif isinstance(m, (nn.LSTM, nn.GRU)):
+            assert m.num_layers == 1 and not m.bidirectional, 'only single-layer unidirectional RNNs'
+            if isinstance(m, nn.LSTM):
+                layers.append((LSTM, (m.input_size, m.hidden_size, m.weight_ih_l0,
+                                      m.weight_hh_l0, m.bias_ih_l0 + m.bias_hh_l0)))
+            else:
+                layers.append((GRU, (m.input_size, m.hidden_size, m.weight_ih_l0,
+                                     m.weight_hh_l0, m.bias_ih_l0, m.bias_hh_l0)))
+        elif isinstance(m, nn.ReLU):
+            layers.append((RELU, ()))
+        elif isinstance(m, nn.SELU):
+            layers.append((SELU, ()))
+        elif isinstance(m, nn.Tanh):
+            layers.append((TANH, ()))
+        elif isinstance(m, nn.Sigmoid):
+            layers.append((SIGMOID, ()))
+        else:
+            raise ValueError('unsupported module {}'.format(type(m).__name__))
+    write_layers(filename, layers)
+
+
+def _activation(name, layers):
+    if name in (None, 'linear'):
+        return
+    if name not in _ACTIVATIONS:
+        raise ValueError('unsupported activation {}'.format(name))
+    layers.append((_ACTIVATIONS[name], ()))
+
+
+def export_keras(model, filename):
+    """Export a Keras Sequential model of Dense, Activation, LSTM and GRU layers
+    (GRU with reset_after=True, the default). Only the last time step of the
+    recurrent layers is evaluated, one step per Forward() call."""
+    import numpy as np
+
+    layers = []
+    for layer in model.layers:
+        kind = type(layer).__name__
+        cfg = layer.get_config()
+        if kind == 'Dense':
+            w = layer.get_weights()
+            kernel = w[0]
+            bias = w[1] if len(w) > 1 else np.zeros(kernel.shape[1])
+            layers.append((DENSE, (kernel.shape[0], kernel.shape[1], kernel.T, bias)))
+            _activation(cfg.get('activation'), layers)
+        elif kind == 'Activation':
+            _activation(cfg['activation'], layers)
+        elif kind == 'LSTM':
+            kernel, recurrent, bias = layer.get_weights()
+            # Keras gate order i, f, c, o is the PyTorch order i, f, g, o
+            layers.append((LSTM, (kernel.shape[0], recurrent.shape[0], kernel.T, recurrent.T,
+                                  bias)))
+        elif kind == 'GRU':
+            assert cfg.get('reset_after', True), 'only GRU with reset_after=True'
+            kernel, recurrent, bias = layer.get_weights()
+            h = recurrent.shape[0]
+
+            # Keras gate order z, r, h -> PyTorch order r, z, n
+            def reorder(m):
+                return np.concatenate([m[..., h:2 * h], m[..., :h], m[..., 2 * h:]], axis=-1)
+
+            layers.append((GRU, (kernel.shape[0], h, reorder(kernel).T, reorder(recurrent).T,
+                                 reorder(bias[0]), reorder(bias[1]))))
+        elif kind in ('InputLayer', 'Dropout', 'Flatten'):
+            continue
+        else:
+            raise ValueError('unsupported layer {}'.format(kind))
+    write_layers(filename, layers)
@@ -0,0 +1,216 @@
+/*
+ * Copyright (c) 2023 Huazhong University of Science and Technology
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef NS3_AI_NN_KERNELS_H
+#define NS3_AI_NN_KERNELS_H
+
+#include <cmath>
+#include <cstdint>
+
+#if defined(__AVX2__) && defined(__FMA__)
+#include <immintrin.h>
+#define NS3_AI_NN_AVX2 1
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#define NS3_AI_NN_NEON 1
+#endif
+
+namespace ns3
+{
+
+/**
+ * \brief Compute kernels of the built-in inference engine.
+ *
+ * The vectorized kernels are selected at compile time: AVX2 with FMA on x86-64
+ * (build with -mavx2 -mfma or -march=native), NEON on arm64, and a scalar
+ * fallback otherwise.
+ */
+namespace Ns3AiNnKernels
+{
+
+/**
+ * \brief Name of the kernels compiled in: "avx2", "neon" or "scalar".
+ */
+inline const char*
+GetIsa()
+{
+#if defined(NS3_AI_NN_AVX2)
+    return "avx2";
+#elif defined(NS3_AI_NN_NEON)
+    return "neon";
+#else
+    return "scalar";
+#endif
+}
+
+/**
+ * \brief Dot product of two float vectors of length n.
+ */
+inline float
+Dot(const float* a, const float* b, uint32_t n)
+{
+    uint32_t i = 0;
+    float sum = 0;
+#if defined(NS3_AI_NN_AVX2)
+    __m256 acc0 = _mm256_setzero_ps();
+    __m256 acc1 = _mm256_setzero_ps();
+    for (; i + 16 <= n; i += 16)
+    {
+        acc0 = _mm256_fmadd_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i), acc0);
+        acc1 = _mm256_fmadd_ps(_mm256_loadu_ps(a + i + 8), _mm256_loadu_ps(b + i + 8), acc1);
+    }
+    for (; i + 8 <= n; i += 8)
+    {
+        acc0 = _mm256_fmadd_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i), acc0);
+    }
+    __m256 acc = _mm256_add_ps(acc0, acc1);
+    __m128 half = _mm_add_ps(_mm256_castps256_ps128(acc), _mm256_extractf128_ps(acc, 1));
+    half = _mm_add_ps(half, _mm_movehl_ps(half, half));
+    half = _mm_add_ss(half, _mm_movehdup_ps(half));
+    sum = _mm_cvtss_f32(half);
+#elif defined(NS3_AI_NN_NEON)
+    float32x4_t acc0 = vdupq_n_f32(0);
+    float32x4_t acc1 = vdupq_n_f32(0);
+    for (; i + 8 <= n; i += 8)
+    {
+        acc0 = vfmaq_f32(acc0, vld1q_f32(a + i), vld1q_f32(b + i));
+        acc1 = vfmaq_f32(acc1, vld1q_f32(a + i + 4), vld1q_f32(b + i + 4));
+    }
+    for (; i + 4 <= n; i += 4)
+    {
+        acc0 = vfmaq_f32(acc0, vld1q_f32(a + i), vld1q_f32(b + i));
+    }
+    sum = vaddvq_f32(vaddq_f32(acc0, acc1));
+#endif
+    for (; i < n; i++)
+    {
+        sum += a[i] * b[i];
+    }
+    return sum;
+}
+
+/**
+ * \brief y = W x + b, with W row-major of shape [rows][cols].
+ * \param b Bias of length rows, or nullptr.
+ */
+inline void
+MatVec(const float* w, const float* x, const float* b, uint32_t rows, uint32_t cols, float* y)
+{
+    for (uint32_t r = 0; r < rows; r++)
+    {
+        y[r] = Dot(w + (uint64_t)r * cols, x, cols) + (b ? b[r] : 0.0f);
+    }
+}
+
+/**
+ * \brief y += W x, with W row-major of shape [rows][cols].
+ */
+inline void
+MatVecAdd(const float* w, const float* x, uint32_t rows, uint32_t cols, float* y)
+{
+    for (uint32_t r = 0; r < rows; r++)
+    {
+        y[r] += Dot(w + (uint64_t)r * cols, x, cols);
+    }
+}
+
+/**
+ * \brief In-place ReLU.
+ */
+inline void
+Relu(float* x, uint32_t n)
+{
+    uint32_t i = 0;
+#if defined(NS3_AI_NN_AVX2)
+    const __m256 zero = _mm256_setzero_ps();
+    for (; i + 8 <= n; i += 8)
+    {
+        _mm256_storeu_ps(x + i, _mm256_max_ps(_mm256_loadu_ps(x + i), zero));
+    }
+#elif defined(NS3_AI_NN_NEON)
+    const float32x4_t zero = vdupq_n_f32(0);
+    for (; i + 4 <= n; i += 4)
+    {
+        vst1q_f32(x + i, vmaxq_f32(vld1q_f32(x + i), zero));
+    }
+#endif
+    for (; i < n; i++)
+    {
+        x[i] = x[i] > 0 ? x[i] : 0;
+    }
+}
+
+/**
+ * \brief In-place SELU, with the constants of Klambauer et al. (PyTorch and Keras).
+ */
+inline void
+Selu(float* x, uint32_t n)
+{
+    const float alpha = 1.6732632423543772f;
+    const float scale = 1.0507009873554805f;
+    for (uint32_t i = 0; i < n; i++)
+    {
+        x[i] = scale * (x[i] > 0 ? x[i] : alpha * (std::exp(x[i]) - 1));
+    }
+}
+
+/**
+ * \brief In-place tanh.
+ */
+inline void
+Tanh(float* x, uint32_t n)
+{
+    for (uint32_t i = 0; i < n; i++)
+    {
+        x[i] = std::tanh(x[i]);
+    }
+}
+
+/**
+ * \brief In-place logistic sigmoid.
+ */
+inline void
+Sigmoid(float* x, uint32_t n)
+{
+    for (uint32_t i = 0; i < n; i++)
+    {
+        x[i] = 1.0f / (1.0f + std::exp(-x[i]));
+    }
+}
+
+/**
+ * \brief Index of the largest element (the first one on ties).
+ */
+inline uint32_t
+Argmax(const float* x, uint32_t n)
+{
+    uint32_t best = 0;
+    for (uint32_t i = 1; i < n; i++)
+    {
+        if (x[i] > x[best])
+        {
+            best = i;
+        }
+    }
+    return best;
+}
+
+} // namespace Ns3AiNnKernels
+
+} // namespace ns3
+
+#endif // NS3_AI_NN_KERNELS_H
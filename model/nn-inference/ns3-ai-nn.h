@@ -0,0 +1,347 @@
+/*
+ * Copyright (c) 2023 Huazhong University of Science and Technology
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef NS3_AI_NN_H
+#define NS3_AI_NN_H
+
+#include "ns3-ai-nn-kernels.h"
+
+#include <ns3/abort.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <istream>
+#include <string>
+#include <vector>
+
+namespace ns3
+{
+
+/**
+ * \brief Layer types of the weight file format.
+ */
+enum Ns3AiNnLayerType : uint32_t
+{
+    NS3AI_NN_DENSE = 1,
+    NS3AI_NN_RELU = 2,
+    NS3AI_NN_SELU = 3,
+    NS3AI_NN_TANH = 4,
+    NS3AI_NN_SIGMOID = 5,
+    NS3AI_NN_LSTM = 6,
+    NS3AI_NN_GRU = 7,
+    NS3AI_NN_ARGMAX = 8,
+};
+
+/**
+ * \brief Recurrent state (h, and c for LSTM) of one input sequence.
+ *
+ * A model holds one default state; create more with Ns3AiNnModel::CreateState()
+ * to run the same weights on several sequences, e.g., one per flow or per UE.
+ */
+struct Ns3AiNnState
+{
+    std::vector<std::vector<float>> h; //!< hidden state of each layer (empty if not recurrent)
+    std::vector<std::vector<float>> c; //!< cell state of each LSTM layer
+};
+
+/**
+ * \brief Dependency-free inference of small feed-forward and recurrent networks.
+ *
+ * Supports dense, ReLU, SELU, tanh, sigmoid, single-layer LSTM and GRU (one
+ * time step per Forward() call) and argmax layers, with the kernels of
+ * Ns3AiNnKernels. Weights are loaded from the little-endian binary format
+ * written by export_weights.py:
+ *
+ * - header: magic "NS3AINN\0", uint32 version (1), uint32 number of layers
+ * - per layer: uint32 type, then
+ *   - dense: uint32 in, uint32 out, float W[out][in], float b[out]
+ *   - LSTM: uint32 in, uint32 hidden, float W_ih[4H][in], float W_hh[4H][H],
+ *     float b[4H] (b_ih + b_hh), gates in PyTorch order i, f, g, o
+ *   - GRU: uint32 in, uint32 hidden, float W_ih[3H][in], float W_hh[3H][H],
+ *     float b_ih[3H], float b_hh[3H], gates in PyTorch order r, z, n
+ *   - activations and argmax: no parameters
+ *
+ * The argmax layer outputs the index of the largest input as a single float.
+ */
+class Ns3AiNnModel
+{
+  public:
+    /**
+     * \brief Load the weights from a file.
+     */
+    void Load(const std::string& filename)
+    {
+        std::ifstream ifs(filename, std::ios::binary);
+        NS_ABORT_MSG_IF(!ifs.is_open(), "Cannot open " << filename);
+        Load(ifs);
+    }
+
+    /**
+     * \brief Load the weights from a stream.
+     */
+    void Load(std::istream& is)
+    {
+        char magic[8];
+        is.read(magic, sizeof(magic));
+        NS_ABORT_MSG_IF(!is || std::memcmp(magic, "NS3AINN", 8) != 0, "Not an ns3-ai weight file");
+        uint32_t version = ReadU32(is);
+        NS_ABORT_MSG_IF(version != 1, "Unsupported weight file version " << version);
+        uint32_t numLayers = ReadU32(is);
+
+        m_layers.clear();
+        m_inputSize = 0;
+        uint32_t size = 0; // output size of the previous layer
+        for (uint32_t l = 0; l < numLayers; l++)
+        {
+            Layer layer;
+            layer.type = ReadU32(is);
+            switch (layer.type)
+            {
+            case NS3AI_NN_DENSE:
+                layer.in = ReadU32(is);
+                layer.out = ReadU32(is);
+                ReadFloats(is, layer.w, (uint64_t)layer.out * layer.in);
+                ReadFloats(is, layer.b, layer.out);
+                break;
+            case NS3AI_NN_LSTM:
+            case NS3AI_NN_GRU: {
+                uint32_t gates = layer.type == NS3AI_NN_LSTM ? 4 : 3;
+                layer.in = ReadU32(is);
+                layer.out = ReadU32(is);
+                ReadFloats(is, layer.w, (uint64_t)gates * layer.out * layer.in);
+                ReadFloats(is, layer.u, (uint64_t)gates * layer.out * layer.out);
+                ReadFloats(is, layer.b, gates * layer.out);
+                if (layer.type == NS3AI_NN_GRU)
+                {
+                    ReadFloats(is, layer.b2, gates * layer.out);
+                }
+                break;
+            }
+            case NS3AI_NN_RELU:
+            case NS3AI_NN_SELU:
+            case NS3AI_NN_TANH:
+            case NS3AI_NN_SIGMOID:
+            case NS3AI_NN_ARGMAX:
+                NS_ABORT_MSG_IF(l == 0, "The first layer must have parameters");
+                layer.in = size;
+                layer.out = layer.type == NS3AI_NN_ARGMAX ? 1 : size;
+                break;
+            default:
+                NS_ABORT_MSG("Unknown layer type " << layer.type);
+            }
+            NS_ABORT_MSG_IF(l > 0 && layer.in != size,
+                            "Layer " << l << " expects " << layer.in << " inputs, got " << size);
+            if (l == 0)
+            {
+                m_inputSize = layer.in;
+            }
+            size = layer.out;
+            m_layers.push_back(std::move(layer));
+        }
+        NS_ABORT_MSG_IF(m_layers.empty(), "No layer in the weight file");
+
+        uint32_t maxSize = m_inputSize;
+        for (const auto& layer : m_layers)
+        {
+            // recurrent layers need room for all their gates
+            uint32_t gates = layer.type == NS3AI_NN_LSTM ? 4 : layer.type == NS3AI_NN_GRU ? 3 : 1;
+            maxSize = std::max(maxSize, gates * layer.out);
+        }
+        m_bufIn.assign(maxSize, 0);
+        m_bufOut.assign(maxSize, 0);
+        m_gates.assign(maxSize, 0);
+        m_gatesH.assign(maxSize, 0);
+        m_state = CreateState();
+    }
+
+    uint32_t GetInputSize() const
+    {
+        return m_inputSize;
+    }
+
+    uint32_t GetOutputSize() const
+    {
+        return m_layers.empty() ? 0 : m_layers.back().out;
+    }
+
+    /**
+     * \brief Create a zero recurrent state for this model.
+     */
+    Ns3AiNnState CreateState() const
+    {
+        Ns3AiNnState state;
+        state.h.resize(m_layers.size());
+        state.c.resize(m_layers.size());
+        for (std::size_t l = 0; l < m_layers.size(); l++)
+        {
+            if (m_layers[l].type == NS3AI_NN_LSTM || m_layers[l].type == NS3AI_NN_GRU)
+            {
+                state.h[l].assign(m_layers[l].out, 0);
+            }
+            if (m_layers[l].type == NS3AI_NN_LSTM)
+            {
+                state.c[l].assign(m_layers[l].out, 0);
+            }
+        }
+        return state;
+    }
+
+    /**
+     * \brief Reset the default recurrent state to zero.
+     */
+    void ResetState()
+    {
+        m_state = CreateState();
+    }
+
+    /**
+     * \brief Run one step with the default recurrent state.
+     * \param input GetInputSize() values.
+     * \return GetOutputSize() values, valid until the next call.
+     */
+    const float* Forward(const float* input)
+    {
+        return Forward(input, m_state);
+    }
+
+    /**
+     * \brief Run one step with the given recurrent state, which is updated.
+     * \param input GetInputSize() values.
+     * \param state State created by CreateState().
+     * \return GetOutputSize() values, valid until the next call.
+     */
+    const float* Forward(const float* input, Ns3AiNnState& state)
+    {
+        NS_ABORT_MSG_IF(m_layers.empty(), "No model loaded");
+        std::copy(input, input + m_inputSize, m_bufIn.begin());
+        float* x = m_bufIn.data();
+        float* y = m_bufOut.data();
+        for (std::size_t l = 0; l < m_layers.size(); l++)
+        {
+            const Layer& layer = m_layers[l];
+            switch (layer.type)
+            {
+            case NS3AI_NN_DENSE:
+                Ns3AiNnKernels::MatVec(layer.w.data(), x, layer.b.data(), layer.out, layer.in, y);
+                std::swap(x, y);
+                break;
+            case NS3AI_NN_RELU:
+                Ns3AiNnKernels::Relu(x, layer.out);
+                break;
+            case NS3AI_NN_SELU:
+                Ns3AiNnKernels::Selu(x, layer.out);
+                break;
+            case NS3AI_NN_TANH:
+                Ns3AiNnKernels::Tanh(x, layer.out);
+                break;
+            case NS3AI_NN_SIGMOID:
+                Ns3AiNnKernels::Sigmoid(x, layer.out);
+                break;
+            case NS3AI_NN_ARGMAX:
+                x[0] = Ns3AiNnKernels::Argmax(x, layer.in);
+                break;
+            case NS3AI_NN_LSTM:
+                LstmStep(layer, x, state.h[l].data(), state.c[l].data());
+                std::copy(state.h[l].begin(), state.h[l].end(), x);
+                break;
+            case NS3AI_NN_GRU:
+                GruStep(layer, x, state.h[l].data());
+                std::copy(state.h[l].begin(), state.h[l].end(), x);
+                break;
+            }
+        }
+        return x;
+    }
+
+  private:
+    /// One layer and its parameters
+    struct Layer
+    {
+        uint32_t type{0};      //!< Ns3AiNnLayerType
+        uint32_t in{0};        //!< input size
+        uint32_t out{0};       //!< output size (hidden size of recurrent layers)
+        std::vector<float> w;  //!< input weights
+        std::vector<float> u;  //!< recurrent weights
+        std::vector<float> b;  //!< bias (input bias of GRU)
+        std::vector<float> b2; //!< recurrent bias of GRU
+    };
+
+    void LstmStep(const Layer& layer, const float* x, float* h, float* c)
+    {
+        const uint32_t n = layer.out;
+        float* g = m_gates.data();
+        Ns3AiNnKernels::MatVec(layer.w.data(), x, layer.b.data(), 4 * n, layer.in, g);
+        Ns3AiNnKernels::MatVecAdd(layer.u.data(), h, 4 * n, n, g);
+        Ns3AiNnKernels::Sigmoid(g, 2 * n);     // input and forget gates
+        Ns3AiNnKernels::Tanh(g + 2 * n, n);    // cell candidate
+        Ns3AiNnKernels::Sigmoid(g + 3 * n, n); // output gate
+        for (uint32_t i = 0; i < n; i++)
+        {
+            c[i] = g[n + i] * c[i] + g[i] * g[2 * n + i];
+            h[i] = g[3 * n + i] * std::tanh(c[i]);
+        }
+    }
+
+    void GruStep(const Layer& layer, const float* x, float* h)
+    {
+        const uint32_t n = layer.out;
+        float* gi = m_gates.data();
+        float* gh = m_gatesH.data();
+        Ns3AiNnKernels::MatVec(layer.w.data(), x, layer.b.data(), 3 * n, layer.in, gi);
+        Ns3AiNnKernels::MatVec(layer.u.data(), h, layer.b2.data(), 3 * n, n, gh);
+        for (uint32_t i = 0; i < 2 * n; i++)
+        {
+            gi[i] += gh[i];
+        }
+        Ns3AiNnKernels::Sigmoid(gi, 2 * n); // reset and update gates
+        for (uint32_t i = 0; i < n; i++)
+        {
+            float cand = std::tanh(gi[2 * n + i] + gi[i] * gh[2 * n + i]);
+            float z = gi[n + i];
+            h[i] = (1 - z) * cand + z * h[i];
+        }
+    }
+
+    static uint32_t ReadU32(std::istream& is)
+    {
+        uint32_t v;
+        is.read(reinterpret_cast<char*>(&v), sizeof(v));
+        NS_ABORT_MSG_IF(!is, "Truncated weight file");
+        return v;
+    }
+
+    static void ReadFloats(std::istream& is, std::vector<float>& v, uint64_t n)
+    {
+        v.resize(n);
+        is.read(reinterpret_cast<char*>(v.data()), n * sizeof(float));
+        NS_ABORT_MSG_IF(!is, "Truncated weight file");
+    }
+
+    std::vector<Layer> m_layers; //!< layers in order
+    uint32_t m_inputSize{0};     //!< input size of the first layer
+    std::vector<float> m_bufIn;  //!< activation buffer
+    std::vector<float> m_bufOut; //!< activation buffer
+    std::vector<float> m_gates;  //!< gate buffer of recurrent layers
+    std::vector<float> m_gatesH; //!< recurrent gate buffer of GRU layers
+    Ns3AiNnState m_state;        //!< default recurrent state
+};
+
+} // namespace ns3
+
+#endif // NS3_AI_NN_H